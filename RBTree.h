@@ -31,19 +31,150 @@ Kingston Chan
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstring>
+#include <climits>
 #include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <cstdint>
+#include <utility>
+#include <iterator>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <cerrno>
+#include <cstdio>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX	// keep min and max for std, as SyncedFile and BinaryIn call them
+#endif
 #include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////Tree Node//////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////
 class NULLT {};
+class InPlace {};	// picks the constructors that build the ID and the record from their arguments
 
 inline int MAX(int a, int b) {
 	return a > b ? a : b;
 }
 
+class ConsoleColor {	// prints in the color of a node, black or red on white, while it lives
+private:
+#ifdef _WIN32
+	HANDLE hstdout;
+	WORD saved;	// the colors to go back to
+#endif
+public:
+	ConsoleColor(int color);
+	~ConsoleColor();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: ConsoleColor
+// DESCRIPTION: Constructor of ConsoleColor class: the console attributes on
+//				Windows, ANSI escapes elsewhere.
+//   ARGUMENTS: int color - 0 for black, 1 for red
+// USES GLOBAL: none
+// MODIFIES GL: the console
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline ConsoleColor::ConsoleColor(int color) {
+#ifdef _WIN32
+	CONSOLE_SCREEN_BUFFER_INFO csbi;
+	hstdout = GetStdHandle(STD_OUTPUT_HANDLE);
+	GetConsoleScreenBufferInfo(hstdout, &csbi);
+	saved = csbi.wAttributes;
+	SetConsoleTextAttribute(hstdout, (color == 0) ? 0xF0 : 0xFC);
+#else
+	cout << ((color == 0) ? "\033[30;47m" : "\033[31;47m");
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: ~ConsoleColor
+// DESCRIPTION: Destructor of ConsoleColor class, putting the colors back.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: the console
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline ConsoleColor::~ConsoleColor() {
+#ifdef _WIN32
+	SetConsoleTextAttribute(hstdout, saved);
+#else
+	cout << "\033[0m";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: walkSubtree
+// DESCRIPTION: To count the nodes of a subtree and find its height in one
+//				in-order walk that climbs back through the fathers, so it
+//				takes no stack however deep the subtree is.
+//   ARGUMENTS: const N *top - the root of the subtree, not NULL
+//				int &height - set to the height of the subtree, 0 for a leaf
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int - the number of nodes
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class N>
+int walkSubtree(const N *top, int &height) {
+	int cnt = 0, depth = 0;
+	const N *X = top;
+	height = 0;
+	while (X->getLft() != NULL) {
+		X = X->getLft();
+		++depth;
+	}
+	while (true) {
+		++cnt;
+		height = MAX(height, depth);
+		if (X->getRgt() != NULL) {	// the next one is the first of the right subtree
+			X = X->getRgt();
+			++depth;
+			while (X->getLft() != NULL) {
+				X = X->getLft();
+				++depth;
+			}
+			continue;
+		}
+		while ((X != top) && (X->getFather()->getRgt() == X)) {	// or the first father we are left of
+			X = X->getFather();
+			--depth;
+		}
+		if (X == top)
+			break;
+		X = X->getFather();
+		--depth;
+	}
+	return cnt;
+}
+
 class NodeERR {	// used to throw out when error occurs
 public :
 	std::string error;
@@ -53,43 +184,270 @@ public :
 	}
 };
 
-template<class T1, class T2 = NULLT>
-class Node {
+// storage policies of the record
+class RcdInline {};	// the record lives inside the node
+class RcdCold {};	// the node only points at its record, so keys and links stay dense
+
+template<class T2, class S, bool Empty = is_empty<T2>::value>
+class RcdStore;
+
+template<class T2, class S>
+class RcdStore<T2, S, true> : private T2 {	// an empty record (NULLT) takes no space at all
+public:
+	static const bool cold = false;
+	RcdStore() : T2() {}
+	RcdStore(const T2 * const rcd, void * /*slot*/ = NULL) : T2(rcd != NULL ? *rcd : T2()) {}
+	template<class... Args>
+	RcdStore(InPlace, void * /*slot*/, Args &&...args) : T2(std::forward<Args>(args)...) {}
+	T2 *getRcd() const { return const_cast<T2 *>(static_cast<const T2 *>(this)); }
+	bool setRcd(const T2 * const /*rcd*/) { return true; }
+	T2 *takeRcd() { return NULL; }
+};
+
+template<class T2>
+class RcdStore<T2, RcdInline, false> {
 private:
-	T1 ID;
-	T2 *Rcd;	// record
-	Node *Lft, *Rgt;
+	T2 Rcd;	// record
+public:
+	static const bool cold = false;
+	RcdStore() : Rcd() {}
+	RcdStore(const T2 * const rcd, void * /*slot*/ = NULL) : Rcd(rcd != NULL ? *rcd : T2()) {}
+	template<class... Args>
+	RcdStore(InPlace, void * /*slot*/, Args &&...args) : Rcd(std::forward<Args>(args)...) {}
+	T2 *getRcd() const { return const_cast<T2 *>(&Rcd); }
+	bool setRcd(const T2 * const rcd) {
+		if (rcd != NULL)
+			Rcd = *rcd;
+		return true;
+	}
+	T2 *takeRcd() { return NULL; }
+};
+
+template<class T2>
+class RcdStore<T2, RcdCold, false> {
+private:
+	T2 *Rcd;	// record, NULL once taken away
+	RcdStore(const RcdStore<T2, RcdCold, false> &New);	// the record has one owner
+	RcdStore<T2, RcdCold, false> &operator=(const RcdStore<T2, RcdCold, false> &b);
+public:
+	static const bool cold = true;
+	RcdStore() {
+		Rcd = new T2();
+		if (Rcd == NULL)
+			throw NodeERR("Out of space");
+	}
+	RcdStore(const T2 * const rcd, void *slot = NULL) {	// "slot" is where to build it, NULL to allocate
+		if (slot != NULL)
+			Rcd = (rcd != NULL) ? new (slot) T2(*rcd) : new (slot) T2();
+		else
+			Rcd = (rcd != NULL) ? new T2(*rcd) : new T2();
+		if (Rcd == NULL)
+			throw NodeERR("Out of space");
+	}
+	template<class... Args>
+	RcdStore(InPlace, void *slot, Args &&...args) {	// the record is built from "args" right where it is to stay
+		if (slot != NULL)
+			Rcd = new (slot) T2(std::forward<Args>(args)...);
+		else
+			Rcd = new T2(std::forward<Args>(args)...);
+		if (Rcd == NULL)
+			throw NodeERR("Out of space");
+	}
+	~RcdStore() {
+		if (Rcd != NULL)
+			delete Rcd;
+	}
+	T2 *getRcd() const { return Rcd; }
+	bool setRcd(const T2 * const rcd) {
+		if (rcd == NULL) {
+			if (Rcd != NULL)
+				delete Rcd;
+			Rcd = NULL;
+			return true;
+		}
+		if (Rcd == NULL) {
+			Rcd = new T2(*rcd);
+			if (Rcd == NULL)
+				throw NodeERR("Out of space");
+		}
+		else
+			*Rcd = *rcd;
+		return true;
+	}
+	T2 *takeRcd() {	// hand the record over to the caller, who is to destroy it
+		T2 *Tmp = Rcd;
+		Rcd = NULL;
+		return Tmp;
+	}
+};
+
+// layout policies of the links
+class PlainLinks {};	// the sons, the father, the height and the color each have a field of their own
+class PackedLinks {};	// the sons and the father in 48 bits each, the color in bit 0 of the left son, the height counted on demand
+template<class L>
+class Counted {};	// either layout above plus the number of nodes in the subtree, for select and rank
+
+template<class N, class L>
+class LinkStore;
+
+template<class N>
+class LinkStore<N, PlainLinks> {
+private:
+	N *Lft, *Rgt;
+	N *Par;	// the father, NULL for the root
 	int height;
 	int color;
+public:
+	LinkStore() : Lft(NULL), Rgt(NULL), Par(NULL), height(0), color(0) {}
+	N *lft() const { return Lft; }
+	N *rgt() const { return Rgt; }
+	N *par() const { return Par; }
+	void setLft(N *lft) { Lft = lft; }
+	void setRgt(N *rgt) { Rgt = rgt; }
+	void setPar(N *par) { Par = par; }
+	int clr() const { return color; }
+	void setClr(int clr) { color = clr; }
+	int hgt() const { return height; }
+	void setHgt(int h) { height = h; }
+	void takeHgt(const N *b) { height = b->getHeight(); }
+	void fixHgt() {	// the height after a son has changed
+		height = 0;
+		if (Lft != NULL)
+			height = MAX(height, Lft->getHeight() + 1);
+		if (Rgt != NULL)
+			height = MAX(height, Rgt->getHeight() + 1);
+	}
+	static const bool counted = false;
+	int cnt() const {	// walks the whole subtree
+		int height;
+		return 1 + ((lft() != NULL) ? walkSubtree(lft(), height) : 0) + ((rgt() != NULL) ? walkSubtree(rgt(), height) : 0);
+	}
+	void fixCnt() {}
+};
+
+template<class N>
+class LinkStore<N, PackedLinks> {	// 18 bytes: a Node<int> takes 24 with its father link, as it did without
+private:
+	enum { LFT = 0, RGT = 3, PAR = 6 };	// where each link starts in Lnk
+	unsigned short Lnk[9];	// the left son, the right son and the father, 48 bits each, the color in bit 0 of the left son
+
+	// user space addresses fit in 48 bits on the 64-bit targets, and the targets are little-endian, so a
+	// link is one 8-byte load whose top 16 bits are dropped by ptr; the father is loaded 2 bytes early
+	uint64_t get(int at) const {
+		uint64_t v;
+		if (at == PAR) {
+			memcpy(&v, Lnk + PAR - 1, sizeof(v));
+			return v >> 16;
+		}
+		memcpy(&v, Lnk + at, sizeof(v));
+		return v;
+	}
+	void put(int at, uint64_t v) {
+		Lnk[at] = (unsigned short)v;
+		Lnk[at + 1] = (unsigned short)(v >> 16);
+		Lnk[at + 2] = (unsigned short)(v >> 32);
+	}
+	static N *ptr(uint64_t v) { return (N *)(intptr_t)((int64_t)(v << 16) >> 16); }
+public:
+	LinkStore() : Lnk() {}
+	N *lft() const { return ptr(get(LFT) & ~(uint64_t)1); }
+	N *rgt() const { return ptr(get(RGT)); }
+	N *par() const { return ptr(get(PAR)); }
+	void setLft(N *lft) { put(LFT, (uint64_t)(uintptr_t)lft | (Lnk[LFT] & 1)); }
+	void setRgt(N *rgt) { put(RGT, (uint64_t)(uintptr_t)rgt); }
+	void setPar(N *par) { put(PAR, (uint64_t)(uintptr_t)par); }
+	int clr() const { return Lnk[LFT] & 1; }
+	void setClr(int clr) { Lnk[LFT] = (unsigned short)((Lnk[LFT] & ~1) | (clr & 1)); }
+	int hgt() const {	// walks the whole subtree
+		int height = 0, h;
+		if (lft() != NULL) {
+			walkSubtree(lft(), h);
+			height = MAX(height, h + 1);
+		}
+		if (rgt() != NULL) {
+			walkSubtree(rgt(), h);
+			height = MAX(height, h + 1);
+		}
+		return height;
+	}
+	void setHgt(int /*h*/) {}
+	void takeHgt(const N * /*b*/) {}	// not worth a walk of b's subtree
+	void fixHgt() {}
+	static const bool counted = false;
+	int cnt() const {	// walks the whole subtree
+		int height;
+		return 1 + ((lft() != NULL) ? walkSubtree(lft(), height) : 0) + ((rgt() != NULL) ? walkSubtree(rgt(), height) : 0);
+	}
+	void fixCnt() {}
+};
+
+template<class N, class L>
+class LinkStore<N, Counted<L> > : public LinkStore<N, L> {
+private:
+	int Cnt;	// the nodes in the subtree, this one included
+public:
+	static const bool counted = true;
+	LinkStore() : Cnt(1) {}
+	int cnt() const { return Cnt; }
+	void fixCnt() {	// the count after a son has changed
+		Cnt = 1;
+		if (this->lft() != NULL)
+			Cnt += this->lft()->getCount();
+		if (this->rgt() != NULL)
+			Cnt += this->rgt()->getCount();
+	}
+};
+
+template<class T1>
+class KeyStore {	// the ID, laid out right behind the links and before the record
+protected:
+	T1 ID;
+	KeyStore() : ID() {}
+	template<class K>
+	KeyStore(InPlace, K &&id) : ID(std::forward<K>(id)) {}	// copied or moved, never assigned
+};
 
+template<class T1, class T2 = NULLT, class S = RcdInline, class L = PlainLinks>
+class Node : private LinkStore<Node<T1, T2, S, L>, L>, private KeyStore<T1>, private RcdStore<T2, S> {
 public:
 	// constructor and destructor
 	Node();
-	Node(const T1 &id, const T2 * const rcd = NULL, int clr = 0);
+	Node(const T1 &id, const T2 * const rcd = NULL, int clr = 0, void *rcdSlot = NULL);
 	Node(const T1 &id, const T2 &rcd, int clr = 0);
-	Node(const Node<T1, T2> &New);
+	template<class K, class... Args>
+	Node(InPlace, K &&id, void *rcdSlot, Args &&...args);
+	Node(const Node<T1, T2, S, L> &New);
 	~Node();
 
 	// modify the info of private members
 	bool setID(const T1 &tmp);
 	bool setHeight(int h);
 	bool setColor(int clr);
-	bool operator=(const Node<T1, T2> &b);
+	bool setFather(Node<T1, T2, S, L> *father);
+	bool fixCount();
+	bool operator=(const Node<T1, T2, S, L> &b);
 	bool operator=(const T1 &id);
-	bool copy(const Node<T1, T2> * const b);
-	bool AddLft(Node<T1, T2> *lft);
-	bool AddRgt(Node<T1, T2> *rgt);
+	bool copy(const Node<T1, T2, S, L> * const b);
+	bool AddLft(Node<T1, T2, S, L> *lft);
+	bool AddRgt(Node<T1, T2, S, L> *rgt);
 	bool AddLft(const T1 &lftID, const T2 * const lftRcd = NULL);
 	bool AddRgt(const T1 &rgtID, const T2 * const RgtRcd = NULL);
 
 	// get the info of private members
-	Node<T1, T2> *getLft() const { return Lft; }
-	Node<T1, T2> *getRgt() const { return Rgt; }
-	int getHeight() const { return height; }
-	int getColor() const { return color; }
-	const T1 &getID() const { return ID; }
-	T2 *getRcd() const { return Rcd; }
+	Node<T1, T2, S, L> *getLft() const { return this->lft(); }
+	Node<T1, T2, S, L> *getRgt() const { return this->rgt(); }
+	Node<T1, T2, S, L> *getFather() const { return this->par(); }
+	int getHeight() const { return this->hgt(); }
+	int getColor() const { return this->clr(); }
+	int getCount() const { return this->cnt(); }
+	static const bool counted = LinkStore<Node<T1, T2, S, L>, L>::counted;
+	const T1 &getID() const { return this->ID; }
+	using RcdStore<T2, S>::getRcd;
+	using RcdStore<T2, S>::takeRcd;
 	void print() const;
+	static void destroyTree(Node<T1, T2, S, L> *node);
+private:
+	bool printLine() const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -103,14 +461,8 @@ public:
 // AUTHOR/DATE: KC 2015-02-20
 //							KC 2015-02-20
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>::Node() {
-	color = 0;
-	height = 0;
-	Rcd = new T2;
-	if (Rcd == NULL)
-		throw NodeERR("Out of space");
-	Lft = Rgt = NULL;
+template<class T1, class T2, class S, class L>
+Node<T1, T2, S, L>::Node() {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -119,24 +471,17 @@ Node<T1, T2>::Node() {
 //   ARGUMENTS: const T1 &id - the ID of the node
 //				const T2 * const rcd - the initial record with default value NULL
 //				int clr = 0 - the color of the node
+//				void *rcdSlot = NULL - where to build a cold record, NULL to allocate it
 // USES GLOBAL: none
 // MODIFIES GL: ID, Rcd, height, Lft, Rgt, color
 //     RETURNS: none
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-20
-//							KC 2015-02-20
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>::Node(const T1 &id, const T2 * const rcd, int clr) {
-	ID = id;
-	Rcd = new T2;
-	if (Rcd == NULL)
-		throw NodeERR("Out of space");
-	if (rcd != NULL)
-		*Rcd = *rcd;
-	Lft = Rgt = NULL;	// no sons at first
-	height = 0;
-	color = clr;
+template<class T1, class T2, class S, class L>
+Node<T1, T2, S, L>::Node(const T1 &id, const T2 * const rcd, int clr, void *rcdSlot) : KeyStore<T1>(InPlace(), id), RcdStore<T2, S>(rcd, rcdSlot) {
+	this->setClr(clr);	// no sons at first
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -150,24 +495,38 @@ Node<T1, T2>::Node(const T1 &id, const T2 * const rcd, int clr) {
 //     RETURNS: none
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-20
-//							KC 2015-02-20
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>::Node(const T1 &id, const T2 &rcd, int clr) {
-	ID = id;
-	Rcd = new T2;
-	if (Rcd == NULL)
-		throw NodeERR("Out of space");
-	*Rcd = rcd;
-	Lft = Rgt = NULL;	// no sons at first
-	height = 0;
-	color = clr;
+template<class T1, class T2, class S, class L>
+Node<T1, T2, S, L>::Node(const T1 &id, const T2 &rcd, int clr) : KeyStore<T1>(InPlace(), id), RcdStore<T2, S>(&rcd) {
+	this->setClr(clr);	// no sons at first
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Node
+// DESCRIPTION: Constructor of Node class that builds the ID from "id" and the
+//				record from "args" in place, moving whatever is passed as an rvalue.
+//   ARGUMENTS: InPlace - the tag of this constructor
+//				K &&id - what the ID is built from
+//				void *rcdSlot - where to build a cold record, NULL to allocate it
+//				Args &&...args - what the record is built from, nothing for T2()
+// USES GLOBAL: none
+// MODIFIES GL: ID, Rcd
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L>
+template<class K, class... Args>
+Node<T1, T2, S, L>::Node(InPlace, K &&id, void *rcdSlot, Args &&...args)
+	: KeyStore<T1>(InPlace(), std::forward<K>(id)), RcdStore<T2, S>(InPlace(), rcdSlot, std::forward<Args>(args)...) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //        NAME: Node
 // DESCRIPTION: Copy constructor of Node class.
-//   ARGUMENTS: const Node<T1, T2> &New - the Node that is to be copied
+//   ARGUMENTS: const Node<T1, T2, S, L> &New - the Node that is to be copied
 // USES GLOBAL: none
 // MODIFIES GL: ID, Rcd, height, Lft, Rgt
 //     RETURNS: none
@@ -175,30 +534,59 @@ Node<T1, T2>::Node(const T1 &id, const T2 &rcd, int clr) {
 // AUTHOR/DATE: KC 2015-02-05
 //							KC 2015-02-05
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>::Node(const Node<T1, T2> &New) {
+template<class T1, class T2, class S, class L>
+Node<T1, T2, S, L>::Node(const Node<T1, T2, S, L> &New) {
 	copy(&New);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //        NAME: ~Node
-// DESCRIPTION: Destructor of Node class.
+// DESCRIPTION: Destructor of Node class. The sons are deleted with it, without
+//				recursion.
 //   ARGUMENTS: none
 // USES GLOBAL: none
 // MODIFIES GL: ID, Rcd, height, Lft, Rgt
 //     RETURNS: none
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-05
-//							KC 2015-02-05
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L>
+Node<T1, T2, S, L>::~Node() {
+	destroyTree(getLft());
+	destroyTree(getRgt());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: destroyTree
+// DESCRIPTION: To delete a subtree of nodes made by new. Whenever the top has a
+//				left son it is rotated right, so the subtree turns into a list
+//				down the right sons that is deleted a node at a time: O(n)
+//				steps and no stack however deep the subtree is.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the root of the subtree, may be NULL
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>::~Node() {
-	if (Rcd != NULL)
-		delete Rcd;
-	if (Lft != NULL)
-		delete Lft;
-	if (Rgt != NULL)
-		delete Rgt;
+template<class T1, class T2, class S, class L>
+void Node<T1, T2, S, L>::destroyTree(Node<T1, T2, S, L> *node) {
+	while (node != NULL) {
+		Node<T1, T2, S, L> *Lft = node->getLft();
+		if (Lft != NULL) {
+			node->setLft(Lft->getRgt());
+			Lft->setRgt(node);
+			node = Lft;
+		}
+		else {
+			Node<T1, T2, S, L> *Rgt = node->getRgt();
+			node->setRgt(NULL);
+			delete node;
+			node = Rgt;
+		}
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -212,9 +600,9 @@ Node<T1, T2>::~Node() {
 // AUTHOR/DATE: KC 2015-02-05
 //							KC 2015-02-05
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::setID(const T1 &tmp) {
-	ID = tmp;
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::setID(const T1 &tmp) {
+	this->ID = tmp;
 	return true;
 }
 
@@ -229,9 +617,9 @@ bool Node<T1, T2>::setID(const T1 &tmp) {
 // AUTHOR/DATE: KC 2015-02-09
 //							KC 2015-02-09
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::setHeight(int h) {
-	height = h;
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::setHeight(int h) {
+	this->setHgt(h);
 	return true;
 }
 
@@ -246,108 +634,139 @@ bool Node<T1, T2>::setHeight(int h) {
 // AUTHOR/DATE: KC 2015-02-20
 //							KC 2015-02-20
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::setColor(int clr) {
-	color = clr;
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::setColor(int clr) {
+	this->setClr(clr);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: setFather
+// DESCRIPTION: To modify the father of a Node. AddLft and AddRgt do it for
+//				the son, so this is only needed for a node becoming the root.
+//   ARGUMENTS: Node<T1, T2, S, L> *father - the new father, NULL for the root
+// USES GLOBAL: none
+// MODIFIES GL: Par
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::setFather(Node<T1, T2, S, L> *father) {
+	this->setPar(father);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: fixCount
+// DESCRIPTION: To count the nodes of the subtree again from the sons' counts.
+//				AddLft and AddRgt do it for this node; the tree calls it on
+//				the fathers above a node that was hung or cut off.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: Cnt
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::fixCount() {
+	this->fixCnt();
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //        NAME: copy
-// DESCRIPTION: To copy the node and their sons.
-//   ARGUMENTS: const Node<T1, T2> * const b - the new node that is to be copied
+// DESCRIPTION: To copy the node and their sons. b's subtree is walked through
+//				the fathers, side by side with the copy being built, so no
+//				stack is taken however deep it is; the old sons are deleted
+//				once the copy is done.
+//   ARGUMENTS: const Node<T1, T2, S, L> * const b - the new node that is to be copied
 // USES GLOBAL: none
-// MODIFIES GL: ID, Rcd, Lft, Rgt, height
+// MODIFIES GL: ID, Rcd, Lft, Rgt, height, Cnt, the sons' Par
 //     RETURNS: bool
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-20
-//							KC 2015-02-20
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::copy(const Node<T1, T2> * const b) {
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::copy(const Node<T1, T2, S, L> * const b) {
 	
 	// avoid self copy after deletion
 	if (b == this)
 		return true;
 
+	// take the old sons off, b may be one of their descendants
+	Node<T1, T2, S, L> *OldLft = getLft(), *OldRgt = getRgt();
+	this->setLft(NULL);
+	this->setRgt(NULL);
+
 	// copy ID, record, color and height
-	ID = b->ID;
-	if (b->Rcd != NULL) {
-		if (Rcd == NULL) {
-			Rcd = new T2;
-			if (Rcd == NULL) {
-				throw NodeERR("Out of space");
-				return false;
-			}
-		}
-		*Rcd = *(b->Rcd);
-	}
-	else {
-		if (Rcd != NULL) {
-			delete Rcd;
-			Rcd = NULL;
-		}
-	}
-	height = b->height;
-	color = b->color;
+	*this = *b;
+	this->setClr(b->getColor());
 
-	// copy the left son
-	if (b->Lft != NULL) {
-		if (Lft == NULL) {
-			Lft = new Node<T1, T2>;
-			if (Lft == NULL) {
+	// copy the sons, a new node has none yet so an empty son is one still to copy
+	const Node<T1, T2, S, L> *X = b;
+	Node<T1, T2, S, L> *Y = this;
+	while (true) {
+		Node<T1, T2, S, L> *Tmp;
+		if ((X->getLft() != NULL) && (Y->getLft() == NULL)) {
+			Tmp = new Node<T1, T2, S, L>;
+			if (Tmp == NULL) {
 				throw NodeERR("Out of space");
 				return false;
 			}
+			Y->setLft(Tmp);
+			X = X->getLft();
 		}
-		Lft->copy(b->Lft);
-	}
-	else {
-		if (Lft != NULL) {
-			delete Lft;
-			Lft = NULL;
-		}
-	}
-
-	// copy the right son
-	if (b->Rgt != NULL) {
-		if (Rgt == NULL) {
-			Rgt = new Node<T1, T2>;
-			if (Rgt == NULL) {
+		else if ((X->getRgt() != NULL) && (Y->getRgt() == NULL)) {
+			Tmp = new Node<T1, T2, S, L>;
+			if (Tmp == NULL) {
 				throw NodeERR("Out of space");
 				return false;
 			}
+			Y->setRgt(Tmp);
+			X = X->getRgt();
 		}
-		Rgt->copy(b->Rgt);
-	}
-	else {
-		if (Rgt != NULL) {
-			delete Rgt;
-			Rgt = NULL;
+		else {	// both sons are done
+			Y->fixCnt();
+			if (X == b)
+				break;
+			X = X->getFather();
+			Y = Y->getFather();
+			continue;
 		}
+		Tmp->setPar(Y);
+		*Tmp = *X;
+		Tmp->setClr(X->getColor());
+		Y = Tmp;
 	}
 
+	destroyTree(OldLft);
+	destroyTree(OldRgt);
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //        NAME: operator=
 // DESCRIPTION: copy the content of a Node.
-//   ARGUMENTS: const Node<T1, T2> &b - the Node that is to be assigned
+//   ARGUMENTS: const Node<T1, T2, S, L> &b - the Node that is to be assigned
 // USES GLOBAL: none
 // MODIFIES GL: ID, Rcd, height
 //     RETURNS: bool
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-09
-//							KC 2015-02-09
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::operator=(const Node<T1, T2> &b) {
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::operator=(const Node<T1, T2, S, L> &b) {
 	if (&b == this)
 		return true;
-	ID = b.getID();
-	*Rcd = *(b.getRcd());
-	height = b.getHeight();
+	this->ID = b.getID();
+	this->setRcd(b.getRcd());
+	this->takeHgt(&b);
 	return true;
 }
 
@@ -362,34 +781,31 @@ bool Node<T1, T2>::operator=(const Node<T1, T2> &b) {
 // AUTHOR/DATE: KC 2015-02-10
 //							KC 2015-02-10
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::operator=(const T1 &id) {
-	ID = id;
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::operator=(const T1 &id) {
+	this->ID = id;
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //        NAME: AddLft
 // DESCRIPTION: Concatenate a left son.
-//   ARGUMENTS: Node<T1, T2> *lft - the left son that is to be concatenated
+//   ARGUMENTS: Node<T1, T2, S, L> *lft - the left son that is to be concatenated
 // USES GLOBAL: none
-// MODIFIES GL: Lft, height
+// MODIFIES GL: Lft, height, Cnt, the son's Par
 //     RETURNS: bool
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-05
-//							KC 2015-02-05
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::AddLft(Node<T1, T2> *lft) {
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::AddLft(Node<T1, T2, S, L> *lft) {
 
-	Lft = lft; // assign the left son
-
-	// update the height
-	height = 0;
-	if (Lft != NULL)
-		height = MAX(height, Lft->height + 1);
-	if (Rgt != NULL)
-		height = MAX(height, Rgt->height + 1);
+	this->setLft(lft); // assign the left son
+	if (lft != NULL)
+		lft->setPar(this);	// and tell it who its father is
+	this->fixHgt();	// update the height
+	this->fixCnt();	// and the count
 
 	return true;
 }
@@ -400,28 +816,24 @@ bool Node<T1, T2>::AddLft(Node<T1, T2> *lft) {
 //   ARGUMENTS: const T1 &lftID - the ID of the left son that is to be concatenated
 //				const T2 * const lftRcd - the record of the left son
 // USES GLOBAL: none
-// MODIFIES GL: Lft, height
+// MODIFIES GL: Lft, height, Cnt, the son's Par
 //     RETURNS: bool
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-05
-//							KC 2015-02-05
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::AddLft(const T1 &lftID, const T2 * const lftRcd) {
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::AddLft(const T1 &lftID, const T2 * const lftRcd) {
 
 	Node *Tmp = new Node(lftID, lftRcd);
 	if (Tmp == NULL) {
 		throw NodeERR("Out of space");
 		return false;
 	}
-	Lft = Tmp;
-
-	// update the height
-	height = 0;
-	if (Lft != NULL)
-		height = MAX(height, Lft->height + 1);
-	if (Rgt != NULL)
-		height = MAX(height, Rgt->height + 1);
+	this->setLft(Tmp);
+	Tmp->setPar(this);
+	this->fixHgt();	// update the height
+	this->fixCnt();	// and the count
 
 	return true;
 }
@@ -429,25 +841,22 @@ bool Node<T1, T2>::AddLft(const T1 &lftID, const T2 * const lftRcd) {
 ////////////////////////////////////////////////////////////////////////////////
 //        NAME: AddRgt
 // DESCRIPTION: Concatenate a right son.
-//   ARGUMENTS: Node<T1, T2> *rgt - the right son that is to be concatenated
+//   ARGUMENTS: Node<T1, T2, S, L> *rgt - the right son that is to be concatenated
 // USES GLOBAL: none
-// MODIFIES GL: Rgt, height
+// MODIFIES GL: Rgt, height, Cnt, the son's Par
 //     RETURNS: bool
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-05
-//							KC 2015-02-05
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::AddRgt(Node<T1, T2> *rgt) {
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::AddRgt(Node<T1, T2, S, L> *rgt) {
 
-	Rgt = rgt; // assign the left son
-
-	// update the height
-	height = 0;
-	if (Lft != NULL)
-		height = MAX(height, Lft->height + 1);
-	if (Rgt != NULL)
-		height = MAX(height, Rgt->height + 1);
+	this->setRgt(rgt); // assign the right son
+	if (rgt != NULL)
+		rgt->setPar(this);	// and tell it who its father is
+	this->fixHgt();	// update the height
+	this->fixCnt();	// and the count
 
 	return true;
 }
@@ -458,1137 +867,8101 @@ bool Node<T1, T2>::AddRgt(Node<T1, T2> *rgt) {
 //   ARGUMENTS: const T1 &rgtID - the ID of the right son that is to be concatenated
 //				const T2 * const RgtRcd - the record of the right son
 // USES GLOBAL: none
-// MODIFIES GL: Rgt, height
+// MODIFIES GL: Rgt, height, Cnt, the son's Par
 //     RETURNS: bool
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-05
-//							KC 2015-02-05
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool Node<T1, T2>::AddRgt(const T1 &rgtID, const T2 * const RgtRcd = NULL) {
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::AddRgt(const T1 &rgtID, const T2 * const RgtRcd) {
 
 	Node *Tmp = new Node(rgtID, RgtRcd);
 	if (Tmp == NULL) {
 		throw NodeERR("Out of space");
 		return false;
 	}
-	Rgt = Tmp;
-
-	// update the height
-	height = 0;
-	if (Lft != NULL)
-		height = MAX(height, Lft->height + 1);
-	if (Rgt != NULL)
-		height = MAX(height, Rgt->height + 1);
+	this->setRgt(Tmp);
+	Tmp->setPar(this);
+	this->fixHgt();	// update the height
+	this->fixCnt();	// and the count
 
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //        NAME: print
-// DESCRIPTION: To print the Node's ID, height and two sons.
+// DESCRIPTION: To print the line of each node in the subtree, in preorder. The
+//				walk climbs back through the fathers instead of recursing.
 //   ARGUMENTS: none
 // USES GLOBAL: none
 // MODIFIES GL: none
 //     RETURNS: void
 //      AUTHOR: Kingston Chan
 // AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-void Node<T1, T2>::print() const{
-	HANDLE hstdin = GetStdHandle( STD_INPUT_HANDLE );
-	HANDLE hstdout = GetStdHandle( STD_OUTPUT_HANDLE );
-	
-	// remember how things were when started
-	CONSOLE_SCREEN_BUFFER_INFO csbi;
-	GetConsoleScreenBufferInfo( hstdout, &csbi );
-	
+template<class T1, class T2, class S, class L>
+void Node<T1, T2, S, L>::print() const{
+	const Node<T1, T2, S, L> *X = this;
+	bool down = printLine();	// the sons are skipped when the line is cut short
+	while (true) {
+		if (down && (X->getLft() != NULL))
+			X = X->getLft();
+		else if (down && (X->getRgt() != NULL))
+			X = X->getRgt();
+		else {	// climb to the first father whose right son is still to print
+			while ((X != this) && ((X->getFather()->getRgt() == X) || (X->getFather()->getRgt() == NULL)))
+				X = X->getFather();
+			if (X == this)
+				break;
+			X = X->getFather()->getRgt();
+		}
+		down = X->printLine();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: printLine
+// DESCRIPTION: To print the Node's ID, height and two sons.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if a color is not a valid one
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L>
+bool Node<T1, T2, S, L>::printLine() const{
 	// print ID
-	if (color == 0)	// set color
-		SetConsoleTextAttribute( hstdout, 0xF0 );
-	else if (color == 1)
-		SetConsoleTextAttribute( hstdout, 0xFC );
-	else
-		return;
-	cout << ID;	// output
-	SetConsoleTextAttribute(hstdout, csbi.wAttributes);	// return color
+	if ((getColor() != 0) && (getColor() != 1))
+		return false;
+	{
+		ConsoleColor Paint(getColor());	// set color, returned at the end of the block
+		cout << this->ID;	// output
+	}
 
 	// print Lft son
-	cout << ": h-" << height << "  l-";
+	cout << ": h-" << getHeight() << "  l-";
 	cout << '(';
-	if (Lft != NULL) {
-		if (Lft->getColor() == 0)	// set color
-			SetConsoleTextAttribute(hstdout, 0xF0);
-		else if (Lft->getColor() == 1)
-			SetConsoleTextAttribute(hstdout, 0xFC);
-		else
-			return;
-		cout << Lft->getID(); // output
-		SetConsoleTextAttribute(hstdout, csbi.wAttributes);	// return color
+	if (getLft() != NULL) {
+		if ((getLft()->getColor() != 0) && (getLft()->getColor() != 1))
+			return false;
+		ConsoleColor Paint(getLft()->getColor());
+		cout << getLft()->getID(); // output
 	}
 	cout << ')';
 
 	// print right son
 	cout << "  r-";
 	cout << '(';
-	if (Rgt != NULL) {
-		if (Rgt->getColor() == 0)	// set color
-			SetConsoleTextAttribute(hstdout, 0xF0);
-		else if (Rgt->getColor() == 1)
-			SetConsoleTextAttribute(hstdout, 0xFC);
-		else
-			return;
-		cout << Rgt->getID(); // output
-		SetConsoleTextAttribute(hstdout, csbi.wAttributes);	// return color
+	if (getRgt() != NULL) {
+		if ((getRgt()->getColor() != 0) && (getRgt()->getColor() != 1))
+			return false;
+		ConsoleColor Paint(getRgt()->getColor());
+		cout << getRgt()->getID(); // output
 	}
 	cout << ')';
 	cout << endl;
-
-	if (Lft != NULL)
-		Lft->print();
-	if (Rgt != NULL)
-		Rgt->print();
+	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////Red-Black Tree////////////////////////////////////////
+/////////////////////////////////////////Node Pool//////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////
 
-template<typename T1>
-int dCmp(const T1 &a, const T1 &b) {	// default compare function
-	if (a > b)
-		return 1;
-	if (a < b)
-		return -1;
-	return 0;
-}
-
-class RBERR {	// used to throw out when error occurs
-public :
-	std::string error;
-	RBERR();
-	RBERR(std::string info) {
-		error = info;
-	}
-};
-
-template<class T1, class T2 = NULLT>
-class RBTree {
-private :
-	Node<T1, T2> *root;
-	int size;
-	int(*cmp)(const T1 &a, const T1 &b);
-
-	static Node<T1, T2> *X, *T, *P, *GP, *GGP;
-
-	int calcSize(const Node<T1, T2> * const node) const;
-	Node<T1, T2>* rotateLL(Node<T1, T2> *N1);
-	Node<T1, T2>* rotateRR(Node<T1, T2> *N1);
-	Node<T1, T2>* rotateLR(Node<T1, T2> *N1);
-	Node<T1, T2>* rotateRL(Node<T1, T2> *N1);
-	Node<T1, T2>* iRotateLL(Node<T1, T2> *N1);
-	Node<T1, T2>* iRotateRR(Node<T1, T2> *N1);
-	Node<T1, T2>* iRotateLR(Node<T1, T2> *N1);
-	Node<T1, T2>* iRotateRL(Node<T1, T2> *N1);
-	Node<T1, T2>* dRotateLL(Node<T1, T2> *N1);
-	Node<T1, T2>* dRotateRR(Node<T1, T2> *N1);
-	Node<T1, T2>* dRotateLR(Node<T1, T2> *N1);
-	Node<T1, T2>* dRotateRL(Node<T1, T2> *N1);
-	bool iHandleReorient();
-	bool dHandleReorient(int dir = 0);
-public :
-	// constructors and destructor
-	RBTree();
-	RBTree(int(*compare)(const T1 &a, const T1 &b));
-	RBTree(const Node<T1, T2> &head, int(*compare)(const T1 &a, const T1 &b) = dCmp);
-	RBTree(const T1 &rootID, const T2 * const rootRcd = NULL, int(*compare)(const T1 &a, const T1 &b) = dCmp);
-	RBTree(const T1 &rootID, const T2 &rootRcd, int(*compare)(const T1 &a, const T1 &b) = dCmp);
-	RBTree(const RBTree<T1, T2> &New);
-	~RBTree();
+template<class N>
+class NodePool {	// slab allocator handing out raw slots for objects of type N
+private:
+	struct Slab {	// header of a slab, followed by the slots
+		Slab *next;
+	};
+	struct Chain {	// slabs shared with other pools, freed with the last of them
+		Slab *slabs;
+		Chain(Slab *s) : slabs(s) {}
+		~Chain() {
+			while (slabs != NULL) {
+				Slab *Tmp = slabs;
+				slabs = slabs->next;
+				::operator delete(Tmp);
+			}
+		}
+	};
 
-	bool setCmp(int(*compare)(const T1 &a, const T1 &b));
-	bool addRoot(const T1 &id, const T2 * const rcd = NULL);
-	bool addRoot(const T1 &id, const T2 &rcd);
-	bool addRoot(const Node<T1, T2> &New);
+	Slab *slabs;	// all the slabs of this pool alone, newest first
+	Slab *slabsTail;	// the oldest of them, so that adopt splices in O(1)
+	vector<shared_ptr<Chain> > shared;	// the slabs shared since a split
+	void *freeList;	// released slots, linked through their first bytes
+	void *freeTail;	// the last of them, likewise
+	char *cur;	// the next untouched slot of the newest slab
+	char *end;	// the end of the newest slab
+	int slabCnt;	// number of slots in the next slab
+	int inUse;	// number of slots handed out, less those passed on by share
 
-	bool Insert(const T1 &id);
-	bool Delete(const T1 &id);
-	bool empty();
+	static size_t slotAlign() { return alignof(N) > alignof(void*) ? alignof(N) : alignof(void*); }
+	static size_t slotSize() { return (MAX(sizeof(N), sizeof(void*)) + slotAlign() - 1) / slotAlign() * slotAlign(); }
+	static size_t headSize() { return (sizeof(Slab) + slotAlign() - 1) / slotAlign() * slotAlign(); }
 
-	int getSize() const { return size; }
-	int getHeight() const { return root->getHeight(); }
-	T2 *find(const T1 &id) const;
-	T1 rootID() const { return root->getID(); }
-	bool print() const;
-};
+	NodePool(const NodePool<N> &New);	// a pool owns its slabs, no copy
+	NodePool<N> &operator=(const NodePool<N> &b);
 
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::X = NULL;
+public:
+	NodePool();
+	~NodePool();
 
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::T = NULL;	// X's sibling
+	void *alloc();
+	void release(void *slot);
+	void reserve(int cnt);
+	void clear();
+	void swap(NodePool<N> &b);
+	void share(NodePool<N> &b, int cnt);
+	void adopt(NodePool<N> &b);
+	void addShared(const vector<shared_ptr<Chain> > &chains);
 
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::P = NULL;	// X's parent
-
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::GP = NULL; // X's grandparent
-
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::GGP = NULL; // X's great-grandparent
+	int getInUse() const { return inUse; }
+};
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: RBTree
-// DESCRIPTION: Constructor of RBTree class.
+//        NAME: NodePool
+// DESCRIPTION: Constructor of NodePool class. No slab is allocated until the
+//				first slot is asked for.
 //   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root, size, cmp;
+// MODIFIES GL: slabs, slabsTail, freeList, freeTail, cur, end, slabCnt, inUse
 //     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-RBTree<T1, T2>::RBTree() {
-	root = NULL;
-	size = 0;
-	cmp = dCmp;
+template<class N>
+NodePool<N>::NodePool() {
+	slabs = slabsTail = NULL;
+	freeList = freeTail = NULL;
+	cur = end = NULL;
+	slabCnt = 32;
+	inUse = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: RBTree
-// DESCRIPTION: Constructor of RBTree class.
-//   ARGUMENTS: int(*compare)(const T1 &a, const T1 &b) = dCmp - the compare function
+//        NAME: ~NodePool
+// DESCRIPTION: Destructor of NodePool class. The objects living in the slots
+//				must have been destroyed by the owner already.
+//   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root, size, cmp;
+// MODIFIES GL: slabs, freeList, cur, end, inUse
 //     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-RBTree<T1, T2>::RBTree(int(*compare)(const T1 &a, const T1 &b)) {
-	root = NULL;
-	size = 0;
-	cmp = compare;
+template<class N>
+NodePool<N>::~NodePool() {
+	clear();
 }
+
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: RBTree
-// DESCRIPTION: Constructor of RBTree class.
-//   ARGUMENTS: const Node<T1, T2> &head - the root node of the RB tree
-//				int(*compare)(const T1 &a, const T1 &b) = dCmp - the compare function
+//        NAME: alloc
+// DESCRIPTION: To hand out a slot big enough for one N. Released slots are
+//				reused first, then the newest slab is carved, and a new slab
+//				(twice as big as the last one, up to 4096 slots) is added
+//				only when both are exhausted.
+//   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root, size, cmp;
-//     RETURNS: none
+// MODIFIES GL: slabs, slabsTail, freeList, freeTail, cur, end, slabCnt, inUse
+//     RETURNS: void*
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-RBTree<T1, T2>::RBTree(const Node<T1, T2> &head, int(*compare)(const T1 &a, const T1 &b)) {
-	root = new Node<T1, T2>(head.getID(), head.getRcd());
-	if (root == NULL)
-		throw RBERR("Out of space");
-	size = calcSize(root);
-	cmp = compare;
+template<class N>
+void *NodePool<N>::alloc() {
+	void *slot;
+
+	// recycle a released slot
+	if (freeList != NULL) {
+		slot = freeList;
+		freeList = *(void **)freeList;
+		if (freeList == NULL)
+			freeTail = NULL;
+		++inUse;
+		return slot;
+	}
+
+	// open a new slab
+	if (cur == end) {
+		Slab *Tmp = (Slab *)::operator new(headSize() + slotSize() * slabCnt, std::nothrow);
+		if (Tmp == NULL)
+			throw NodeERR("Out of space");
+		Tmp->next = slabs;
+		if (slabs == NULL)
+			slabsTail = Tmp;
+		slabs = Tmp;
+		cur = (char *)Tmp + headSize();
+		end = cur + slotSize() * slabCnt;
+		if (slabCnt < 4096)
+			slabCnt <<= 1;
+	}
+
+	slot = cur;
+	cur += slotSize();
+	++inUse;
+	return slot;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: RBTree
-// DESCRIPTION: Constructor of RBTree class.
-//   ARGUMENTS: const T1 &rootID - the ID of the root node
-//				const T2 * const rootRcd = NULL - the initial root record
-//				int(*compare)(const T1 &a, const T1 &b) = dCmp - the compare function
+//        NAME: release
+// DESCRIPTION: To give a slot back to the pool. The object in it must have
+//				been destroyed already.
+//   ARGUMENTS: void *slot - the slot that is to be released
 // USES GLOBAL: none
-// MODIFIES GL: root, size, cmp;
-//     RETURNS: none
+// MODIFIES GL: freeList, freeTail, inUse
+//     RETURNS: void
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-RBTree<T1, T2>::RBTree(const T1 &rootID, const T2 * const rootRcd, int(*compare)(const T1 &a, const T1 &b)) {
-	root = new Node<T1, T2>(rootID, rootRcd);
-	if (root == NULL)
-		throw RBERR("Out of space");
-	size = 1;
-	cmp = compare;
+template<class N>
+void NodePool<N>::release(void *slot) {
+	if (slot == NULL)
+		return;
+	*(void **)slot = freeList;
+	if (freeList == NULL)
+		freeTail = slot;
+	freeList = slot;
+	--inUse;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: RBTree
-// DESCRIPTION: Constructor of RBTree class.
-//   ARGUMENTS: const T1 &rootID - the ID of the root node
-//				const T2 &rootRcd - the initial root record
-//				int(*compare)(const T1 &a, const T1 &b) = dCmp - the compare function
+//        NAME: reserve
+// DESCRIPTION: To make sure that the next "cnt" slots carved out of the pool
+//				are side by side in one slab. What is left of the newest slab
+//				is given up if it is too small. Released slots still go first,
+//				so this only holds while the free list is empty.
+//   ARGUMENTS: int cnt - the number of slots wanted in a row
 // USES GLOBAL: none
-// MODIFIES GL: root, size, cmp;
-//     RETURNS: none
+// MODIFIES GL: slabs, slabsTail, cur, end
+//     RETURNS: void
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-RBTree<T1, T2>::RBTree(const T1 &rootID, const T2 &rootRcd, int(*compare)(const T1 &a, const T1 &b)) {
-	root = new Node<T1, T2>(rootID, rootRcd);
-	if (root == NULL)
-		throw RBERR("Out of space");
-	size = 1;
-	cmp = compare;
+template<class N>
+void NodePool<N>::reserve(int cnt) {
+	if ((cnt <= 0) || ((size_t)(end - cur) >= slotSize() * cnt))
+		return;
+	Slab *Tmp = (Slab *)::operator new(headSize() + slotSize() * cnt, std::nothrow);
+	if (Tmp == NULL)
+		throw NodeERR("Out of space");
+	Tmp->next = slabs;
+	if (slabs == NULL)
+		slabsTail = Tmp;
+	slabs = Tmp;
+	cur = (char *)Tmp + headSize();
+	end = cur + slotSize() * cnt;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: RBTree
-// DESCRIPTION: Copy constructor of RBTree class.
-//   ARGUMENTS: const RBTree<T1, T2> &Old - the RBTree that is to be copied
+//        NAME: clear
+// DESCRIPTION: To give all the slabs back at once, whatever is in them. The
+//				cost only depends on the number of slabs, not of slots. Shared
+//				slabs are only let go of, and freed by the last pool to do so.
+//   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root, size, cmp;
-//     RETURNS: none
+// MODIFIES GL: slabs, slabsTail, shared, freeList, freeTail, cur, end, slabCnt, inUse
+//     RETURNS: void
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-RBTree<T1, T2>::RBTree(const RBTree<T1, T2> &Old) {
-	size = Old.size;
-	cmp = Old.cmp;
-	if (Old.root != NULL) {
-		root = new Node<T1, T2>;
-		if (root == NULL)
-			throw RBERR("Out of space");
-		root->copy(Old.root);
+template<class N>
+void NodePool<N>::clear() {
+	while (slabs != NULL) {
+		Slab *Tmp = slabs;
+		slabs = slabs->next;
+		::operator delete(Tmp);
 	}
+	slabsTail = NULL;
+	shared.clear();
+	freeList = freeTail = NULL;
+	cur = end = NULL;
+	slabCnt = 32;
+	inUse = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: RBTree
-// DESCRIPTION: Destructor of RBTree class.
-//   ARGUMENTS: none
+//        NAME: swap
+// DESCRIPTION: To trade all the slabs with another pool, so that the nodes
+//				of a tree can change hands without being touched.
+//   ARGUMENTS: NodePool<N> &b - the other pool
 // USES GLOBAL: none
-// MODIFIES GL: root, size, cmp;
-//     RETURNS: none
+// MODIFIES GL: slabs, slabsTail, shared, freeList, freeTail, cur, end, slabCnt, inUse
+//     RETURNS: void
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-RBTree<T1, T2>::~RBTree() {
-	if (root != NULL)
-		cout << root->getID();
-	cout << endl;
-	delete root;
+template<class N>
+void NodePool<N>::swap(NodePool<N> &b) {
+	std::swap(slabs, b.slabs);
+	std::swap(slabsTail, b.slabsTail);
+	shared.swap(b.shared);
+	std::swap(freeList, b.freeList);
+	std::swap(freeTail, b.freeTail);
+	std::swap(cur, b.cur);
+	std::swap(end, b.end);
+	std::swap(slabCnt, b.slabCnt);
+	std::swap(inUse, b.inUse);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: calcSize
-// DESCRIPTION: To calculate the size of the tree with the root "node".
-//   ARGUMENTS: const Node<T1, T2> * const node - the root the of tree
+//        NAME: share
+// DESCRIPTION: To share all the slabs with another pool, once some of the
+//				slots have gone over to it with the nodes in them. Either
+//				pool recycles what it releases; the slabs are freed when
+//				neither holds them any more.
+//   ARGUMENTS: NodePool<N> &b - the other pool
+//				int cnt - the number of slots in use that go over to "b"
 // USES GLOBAL: none
-// MODIFIES GL: none
-//     RETURNS: int
+// MODIFIES GL: slabs, slabsTail, shared, inUse
+//     RETURNS: void
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-int RBTree<T1, T2>::calcSize(const Node<T1, T2> * const node) const {
-	if (node == NULL)
-		return 0;
-	else
-		return calcSize(node->getLft()) + calcSize(node->getRgt()) + 1;
+template<class N>
+void NodePool<N>::share(NodePool<N> &b, int cnt) {
+	if (slabs != NULL) {
+		shared.push_back(make_shared<Chain>(slabs));
+		slabs = slabsTail = NULL;
+	}
+	b.addShared(shared);
+	inUse -= cnt;
+	b.inUse += cnt;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: setCmp
-// DESCRIPTION: To assign the compare function to the member function pointer.
-//   ARGUMENTS: int(*compare)(const T1 &a, const T1 &b) - the compare function
+//        NAME: adopt
+// DESCRIPTION: To take over all the slabs and free slots of another pool,
+//				which is left empty. The slab list and the free list of "b"
+//				are spliced in front of ours through their tails, so the cost
+//				only depends on the number of chains shared since a split.
+//   ARGUMENTS: NodePool<N> &b - the other pool
 // USES GLOBAL: none
-// MODIFIES GL: cmp
-//     RETURNS: bool
+// MODIFIES GL: slabs, slabsTail, shared, freeList, freeTail, cur, end, slabCnt, inUse
+//     RETURNS: void
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::setCmp(int(*compare)(const T1 &a, const T1 &b)) {
-	cmp = compare;
-	return true;
+template<class N>
+void NodePool<N>::adopt(NodePool<N> &b) {
+	if (b.slabs != NULL) {
+		b.slabsTail->next = slabs;
+		if (slabs == NULL)
+			slabsTail = b.slabsTail;
+		slabs = b.slabs;
+	}
+	addShared(b.shared);
+	if (b.freeList != NULL) {
+		*(void **)b.freeTail = freeList;
+		if (freeList == NULL)
+			freeTail = b.freeTail;
+		freeList = b.freeList;
+	}
+	if (cur == end) {	// ours is used up, go on with the newest slab of "b"
+		cur = b.cur;
+		end = b.end;
+	}
+	slabCnt = MAX(slabCnt, b.slabCnt);
+	inUse += b.inUse;
+
+	b.slabs = b.slabsTail = NULL;
+	b.shared.clear();
+	b.freeList = b.freeTail = NULL;
+	b.cur = b.end = NULL;
+	b.slabCnt = 32;
+	b.inUse = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: addRoot
-// DESCRIPTION: To add a root for the RB tree.
-//   ARGUMENTS: const T1 &id - the id of the root node
-//				const T2 * const rcd - the record of the root node with default value NULL
+//        NAME: addShared
+// DESCRIPTION: To hold on to more shared slabs, each chain only once, so that
+//				the list does not grow with every split and join.
+//   ARGUMENTS: const vector<shared_ptr<Chain> > &chains - the shared slabs
 // USES GLOBAL: none
-// MODIFIES GL: root, size
-//     RETURNS: bool
+// MODIFIES GL: shared
+//     RETURNS: void
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::addRoot(const T1 &id, const T2 * const rcd) {
-	if (root != NULL) {
-		throw RBERR("root already exists");
+template<class N>
+void NodePool<N>::addShared(const vector<shared_ptr<Chain> > &chains) {
+	for (size_t i = 0; i < chains.size(); i++)
+		if (std::find(shared.begin(), shared.end(), chains[i]) == shared.end())
+			shared.push_back(chains[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////Binary Files/////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class BinaryOut {	// buffered writes of raw bytes to a file, or to memory
+private:
+	ofstream File;
+	vector<char> buf;
+	size_t used;	// bytes waiting in buf
+	bool good;	// false once a write has failed
+	bool inMemory;	// the bytes stay in buf, which grows
+
+	BinaryOut(const BinaryOut &New);	// a file has one writer
+	BinaryOut &operator=(const BinaryOut &b);
+	bool flush();
+	bool putLong(const void *data, size_t len);
+
+public:
+	BinaryOut();
+	BinaryOut(const string &path);
+	~BinaryOut() { close(); }
+
+	bool put(const void *data, size_t len) {	// most writes fit in the buffer
+		if (len > buf.size() - used)
+			return putLong(data, len);
+		memcpy(&buf[used], data, len);
+		used += len;
+		return good;
 	}
-	root = new Node<T1, T2>(id, rcd);
-	if (root == NULL) {
-		throw RBERR("Out of space");
-		return false;
+	bool close();
+
+	// the bytes kept in memory
+	const char *data() const { return &buf[0]; }
+	size_t length() const { return used; }
+	void reset() { used = 0; }
+};
+
+class BinaryIn {	// buffered reads of raw bytes from a file, or from memory
+private:
+	ifstream File;
+	vector<char> buf;
+	size_t pos;	// the next byte of buf to hand out
+	size_t end;	// the end of the bytes read into buf
+	uint64_t unread;	// the bytes of the file not read into buf yet
+	bool good;	// false once a read has come up short
+
+	BinaryIn(const BinaryIn &New);
+	BinaryIn &operator=(const BinaryIn &b);
+	bool getLong(void *data, size_t len);
+
+public:
+	BinaryIn(const string &path);
+	BinaryIn(const char *data, size_t len);
+
+	bool get(void *data, size_t len) {	// most reads are served from the buffer
+		if (len > end - pos)
+			return getLong(data, len);
+		memcpy(data, &buf[pos], len);
+		pos += len;
+		return true;
 	}
-	size = calcSize(root);
-	return true;
-}
+	bool isGood() const { return good; }
+	uint64_t remaining() const { return (end - pos) + unread; }	// the bytes left to read, to check a count against
+};
+
+template<class T>
+class Serializer {	// how save and load write a key or a record: its bytes as they are, unless specialized
+public:
+	static size_t minSize() { return sizeof(T); }	// the fewest bytes an item takes
+	static bool save(BinaryOut &out, const T &x) {
+		static_assert(is_trivially_copyable<T>::value, "specialize Serializer<T> for a type that is not trivially copyable");
+		return out.put(&x, sizeof(T));
+	}
+	static bool load(BinaryIn &in, T &x) {
+		static_assert(is_trivially_copyable<T>::value, "specialize Serializer<T> for a type that is not trivially copyable");
+		return in.get(&x, sizeof(T));
+	}
+};
+
+template<>
+class Serializer<string> {	// the length, then the characters
+public:
+	static size_t minSize() { return sizeof(uint64_t); }
+	static bool save(BinaryOut &out, const string &x) {
+		uint64_t len = x.size();
+		return out.put(&len, sizeof(len)) && out.put(x.data(), x.size());
+	}
+	static bool load(BinaryIn &in, string &x) {
+		uint64_t len;
+		if (!in.get(&len, sizeof(len)))
+			return false;
+		x.clear();
+		while (len > 0) {	// a piece at a time, so a broken length cannot ask for all the memory
+			size_t piece = (size_t)min(len, (uint64_t)1 << 20), old = x.size();
+			x.resize(old + piece);
+			if (!in.get(&x[old], piece))
+				return false;
+			len -= piece;
+		}
+		return true;
+	}
+};
+
+template<class T>
+class SavedSize {	// the fewest bytes Serializer<T> writes for an item, 0 for a specialization without minSize
+private:
+	template<class U>
+	static size_t of(decltype(&Serializer<U>::minSize)) { return Serializer<U>::minSize(); }
+	template<class U>
+	static size_t of(...) { return 0; }
+public:
+	static size_t least() { return of<T>(NULL); }
+};
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: addRoot
-// DESCRIPTION: To add a root for the RB tree.
-//   ARGUMENTS: const T1 &id - the id of the root node
-//				const T2 &rcd - the record of the root node
+//        NAME: BinaryOut
+// DESCRIPTION: Constructor of BinaryOut class, keeping the bytes in memory.
+//   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root, size
-//     RETURNS: bool
+// MODIFIES GL: buf, used, good, inMemory
+//     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::addRoot(const T1 &id, const T2 &rcd) {
-	if (root != NULL) {
-		throw RBERR("root already exists");
-	}
-	root = new Node<T1, T2>(id, rcd);
-	if (root == NULL) {
-		throw RBERR("Out of space");
-		return false;
-	}
-	size = calcSize(root);
-	return true;
+inline BinaryOut::BinaryOut() : buf(256), used(0), good(true), inMemory(true) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: addRoot
-// DESCRIPTION: To add a root for the Red-Black tree.
-//   ARGUMENTS: const Node<T1, T2> &New - the copy of the root node
+//        NAME: BinaryOut
+// DESCRIPTION: Constructor of BinaryOut class. The file is created, or cut
+//				down to nothing if it is there.
+//   ARGUMENTS: const string &path - the file to write
 // USES GLOBAL: none
-// MODIFIES GL: root, size
-//     RETURNS: bool
+// MODIFIES GL: File, buf, used, good, inMemory
+//     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::addRoot(const Node<T1, T2> &New) {
-	if (root != NULL) {
-		throw RBERR("root already exists");
-	}
-	root = new Node<T1, T2>(New);
-	if (root == NULL) {
-		throw RBERR("Out of space");
-		return false;
-	}
-	size = calcSize(root);
-	return true;
+inline BinaryOut::BinaryOut(const string &path) : File(path.c_str(), ios::out | ios::binary | ios::trunc), buf(1 << 20), used(0), inMemory(false) {
+	good = File.is_open();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: empty
-// DESCRIPTION: To delete all the nodes in the Red-Black tree.
+//        NAME: flush
+// DESCRIPTION: To write out the bytes waiting in the buffer.
 //   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root, size
-//     RETURNS: bool
+// MODIFIES GL: File, used, good
+//     RETURNS: bool - false if a write has failed
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-10
-//							KC 2015-02-10
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::empty() {
-	if (root == NULL)
-		return true;
-	delete root;
-	root = NULL;
-	size = 0;
-	return true;
+inline bool BinaryOut::flush() {
+	if (inMemory)
+		return good;
+	if (good && (used > 0))
+		good = (bool)File.write(&buf[0], used);
+	used = 0;
+	return good;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: find
-// DESCRIPTION: To find a node of a certain ID in Red-Black tree.
-//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+//        NAME: putLong
+// DESCRIPTION: To write what does not fit in the buffer: the buffer goes out
+//				first, then "data" is either buffered or, if it is as big as
+//				the buffer, written straight away. In memory the buffer grows.
+//   ARGUMENTS: const void *data - the bytes to write
+//				size_t len - the number of bytes
 // USES GLOBAL: none
-// MODIFIES GL: none
-//     RETURNS: T2*
+// MODIFIES GL: File, buf, used, good
+//     RETURNS: bool - false if a write has failed
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-24
-//							KC 2015-02-24
-////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-T2 *RBTree<T1, T2>::find(const T1 &id) const {
-	X = P = GP = GGP = root;
-	while ((X != NULL) && (cmp(X->getID(), id) != 0)) {
-		GGP = GP;
-		GP = P;
-		P = X;
-		if (cmp(id, X->getID()) > 0)
-			X = X->getRgt();
-		else
-			X = X->getLft();
-		flag = false;
-		if (((X->getLft() != NULL) && (X->getLft()->getColor() == 1)) && ((X->getRgt() != NULL) && (X->getRgt()->getColor() == 1)))
-			iHandleReorient();
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool BinaryOut::putLong(const void *data, size_t len) {
+	if (inMemory) {
+		buf.resize(max(2 * buf.size(), used + len));
+		memcpy(&buf[used], data, len);
+		used += len;
+		return true;
 	}
-	if (X == NULL)
-		return NULL;
-	return X->getRcd();
+	if (!flush())
+		return false;
+	if (len >= buf.size())
+		return good = (bool)File.write((const char *)data, len);
+	memcpy(&buf[0], data, len);
+	used = len;
+	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: rotateLL
-// DESCRIPTION: The single rotation LL of Red-Black tree.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: close
+// DESCRIPTION: To write out the buffer and close the file.
+//   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: File, used, good
+//     RETURNS: bool - true if every byte has reached the file
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-21
-//							KC 2015-02-21
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::rotateLL(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getLft();
-	N1->AddLft(N2->getRgt());
-	N2->AddRgt(N1);
-	return N2;
+inline bool BinaryOut::close() {
+	if (!File.is_open())
+		return good;
+	flush();
+	File.close();
+	if (File.fail())
+		good = false;
+	return good;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: rotateRR
-// DESCRIPTION: The single rotation RR of Red-Black tree.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: BinaryIn
+// DESCRIPTION: Constructor of BinaryIn class.
+//   ARGUMENTS: const string &path - the file to read
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: File, buf, pos, end, unread, good
+//     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-21
-//							KC 2015-02-21
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::rotateRR(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getRgt();
-	N1->AddRgt(N2->getLft());
-	N2->AddLft(N1);
-	return N2;
+inline BinaryIn::BinaryIn(const string &path) : File(path.c_str(), ios::in | ios::binary), buf(1 << 20), pos(0), end(0), unread(0) {
+	good = File.is_open();
+	if (good) {
+		File.seekg(0, ios::end);
+		streamoff Len = File.tellg();
+		File.seekg(0, ios::beg);
+		unread = (Len > 0) ? (uint64_t)Len : 0;
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: rotateLR
-// DESCRIPTION: The double rotation LR of Red-Black tree.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: BinaryIn
+// DESCRIPTION: Constructor of BinaryIn class, reading a copy of "data".
+//   ARGUMENTS: const char *data - the bytes to read
+//				size_t len - the number of bytes
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: buf, pos, end, good
+//     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-21
-//							KC 2015-02-21
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::rotateLR(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getLft();
-	Node<T1, T2> *N3 = N2->getRgt();
-	N2->AddRgt(N3->getLft());
-	N1->AddLft(N3->getRgt());
-	N3->AddLft(N2);
-	N3->AddRgt(N1);
-	return N3;
+inline BinaryIn::BinaryIn(const char *data, size_t len) : buf(data, data + len), pos(0), end(len), unread(0), good(true) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: rotateRL
-// DESCRIPTION: The double rotation RL of RB tree.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: getLong
+// DESCRIPTION: To read what the buffer does not hold: the rest of the buffer
+//				is handed out first, then a big read goes straight into
+//				"data" and a small one refills the buffer.
+//   ARGUMENTS: void *data - where to put the bytes
+//				size_t len - the number of bytes
+// USES GLOBAL: none
+// MODIFIES GL: File, buf, pos, end, unread, good
+//     RETURNS: bool - false if the file ended or a read failed first
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool BinaryIn::getLong(void *data, size_t len) {
+	size_t have = end - pos;
+	if (have > 0)
+		memcpy(data, &buf[pos], have);
+	data = (char *)data + have;
+	len -= have;
+	pos = end = 0;
+	if (!File.is_open())	// memory, or a file that would not open
+		good = false;
+	if (!good)
+		return false;
+	if (len >= buf.size()) {
+		File.read((char *)data, len);
+		unread -= min(unread, (uint64_t)File.gcount());
+		good = ((size_t)File.gcount() == len);
+		return good;
+	}
+	File.read(&buf[0], buf.size());
+	end = (size_t)File.gcount();
+	unread -= min(unread, (uint64_t)end);
+	if (end < len)
+		return good = false;
+	memcpy(data, &buf[0], len);
+	pos = len;
+	return true;
+}
+
+class SyncedFile {	// an unbuffered file that is only added to, and forced to the disk on request
+private:
+#ifdef _WIN32
+	HANDLE File;
+#else
+	int fd;
+#endif
+
+	SyncedFile(const SyncedFile &New);	// a file has one owner
+	SyncedFile &operator=(const SyncedFile &b);
+
+public:
+	SyncedFile();
+	~SyncedFile() { close(); }
+
+	bool open(const string &path, bool create);
+	bool append(const void *data, size_t len);
+	bool sync();
+	bool truncate(uint64_t len);
+	void close();
+	bool isOpen() const;
+
+	static bool syncPath(const string &path);
+	static bool replaceFile(const string &from, const string &to);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: SyncedFile
+// DESCRIPTION: Constructor of SyncedFile class. No file is open yet.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: the handle
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline SyncedFile::SyncedFile() {
+#ifdef _WIN32
+	File = INVALID_HANDLE_VALUE;
+#else
+	fd = -1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: open
+// DESCRIPTION: To open a file for appending, closing the one open before.
+//   ARGUMENTS: const string &path - the file
+//				bool create - true to create it anew, or cut it down to
+//				nothing; false to open it as it is
+// USES GLOBAL: none
+// MODIFIES GL: the handle
+//     RETURNS: bool - false if it could not be opened
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool SyncedFile::open(const string &path, bool create) {
+	close();
+#ifdef _WIN32
+	File = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+		create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+	fd = ::open(path.c_str(), O_RDWR | O_APPEND | (create ? O_CREAT | O_TRUNC : 0), 0644);
+#endif
+	return isOpen();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: append
+// DESCRIPTION: To write "data" at the end of the file. It is with the system
+//				when this returns, and on the disk only after sync.
+//   ARGUMENTS: const void *data - the bytes to write
+//				size_t len - the number of bytes
+// USES GLOBAL: none
+// MODIFIES GL: the file
+//     RETURNS: bool - false if a write failed
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool SyncedFile::append(const void *data, size_t len) {
+	if (!isOpen())
+		return false;
+#ifdef _WIN32
+	LARGE_INTEGER Zero;
+	Zero.QuadPart = 0;
+	if (!SetFilePointerEx(File, Zero, NULL, FILE_END))
+		return false;
+#endif
+	const char *p = (const char *)data;
+	while (len > 0) {	// a write may take only part of it
+#ifdef _WIN32
+		DWORD done;
+		if (!WriteFile(File, p, (DWORD)min(len, (size_t)1 << 30), &done, NULL))
+			return false;
+#else
+		ssize_t done = ::write(fd, p, len);
+		if (done < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+#endif
+		p += done;
+		len -= (size_t)done;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: sync
+// DESCRIPTION: To wait until what has been written is on the disk.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if it could not be written
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool SyncedFile::sync() {
+	if (!isOpen())
+		return false;
+#ifdef _WIN32
+	return FlushFileBuffers(File) != 0;
+#else
+	return fsync(fd) == 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: truncate
+// DESCRIPTION: To cut the file down to its first "len" bytes. The next append
+//				goes after them.
+//   ARGUMENTS: uint64_t len - the bytes to keep
+// USES GLOBAL: none
+// MODIFIES GL: the file
+//     RETURNS: bool - false if it could not be cut
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool SyncedFile::truncate(uint64_t len) {
+	if (!isOpen())
+		return false;
+#ifdef _WIN32
+	LARGE_INTEGER To;
+	To.QuadPart = (LONGLONG)len;
+	return SetFilePointerEx(File, To, NULL, FILE_BEGIN) && SetEndOfFile(File);
+#else
+	return ftruncate(fd, (off_t)len) == 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: close
+// DESCRIPTION: To close the file, if one is open.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: the handle
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline void SyncedFile::close() {
+#ifdef _WIN32
+	if (File != INVALID_HANDLE_VALUE)
+		CloseHandle(File);
+	File = INVALID_HANDLE_VALUE;
+#else
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: isOpen
+// DESCRIPTION: To tell whether a file is open.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool SyncedFile::isOpen() const {
+#ifdef _WIN32
+	return File != INVALID_HANDLE_VALUE;
+#else
+	return fd >= 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: syncPath
+// DESCRIPTION: To force a file, or on POSIX a directory, to the disk. A new or
+//				renamed file is only sure to be found after a crash once the
+//				directory holding it has been synced.
+//   ARGUMENTS: const string &path - the file or directory
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if it could not be opened or synced
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool SyncedFile::syncPath(const string &path) {
+#ifdef _WIN32
+	HANDLE Tmp = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (Tmp == INVALID_HANDLE_VALUE)
+		return false;
+	bool good = FlushFileBuffers(Tmp) != 0;
+	CloseHandle(Tmp);
+#else
+	int Tmp = ::open(path.c_str(), O_RDONLY);
+	if (Tmp < 0)
+		return false;
+	bool good = (fsync(Tmp) == 0);
+	::close(Tmp);
+#endif
+	return good;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: replaceFile
+// DESCRIPTION: To rename "from" to "to" in one step, replacing "to" if it is
+//				there: after a crash "to" is either the old file or the new.
+//				On POSIX the directory is synced too, so the rename holds.
+//   ARGUMENTS: const string &from - the new file
+//				const string &to - the file it replaces
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if it could not be renamed
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool SyncedFile::replaceFile(const string &from, const string &to) {
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	if (rename(from.c_str(), to.c_str()) != 0)
+		return false;
+	size_t cut = to.rfind('/');
+	return syncPath((cut == string::npos) ? string(".") : (cut == 0) ? string("/") : to.substr(0, cut));
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////Red-Black Tree////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+template<typename T1>
+int dCmp(const T1 &a, const T1 &b) {	// default compare function
+	if (a > b)
+		return 1;
+	if (a < b)
+		return -1;
+	return 0;
+}
+
+template<typename T1>
+class CmpPtr {	// a compare function picked at run time, dCmp unless told otherwise
+private:
+	int(*func)(const T1 &a, const T1 &b);
+public:
+	CmpPtr(int(*compare)(const T1 &a, const T1 &b) = dCmp) : func(compare) {}
+	int operator()(const T1 &a, const T1 &b) const {
+		if (func == &dCmp<T1>)	// the usual case, let the compiler inline it
+			return dCmp(a, b);
+		return func(a, b);
+	}
+};
+
+template<typename T1>
+class DCmp {	// dCmp as a functor, for trees that never change their compare function
+public:
+	int operator()(const T1 &a, const T1 &b) const { return dCmp(a, b); }
+};
+
+// turns any compare functor into a three-way one: negative, zero or positive
+template<class Compare, class T1, bool Less = is_same<decltype(declval<const Compare &>()(declval<const T1 &>(), declval<const T1 &>())), bool>::value>
+class CmpTraits {
+public:
+	static int threeWay(const Compare &cmp, const T1 &a, const T1 &b) { return cmp(a, b); }
+	template<class K>
+	static int threeWay(const Compare &cmp, const K &a, const T1 &b) { return cmp(a, b); }	// a key of another type, for a transparent Compare
+};
+
+template<class Compare, class T1>
+class CmpTraits<Compare, T1, true> {	// std::less-style, the second call is only made on "not less"
+public:
+	static int threeWay(const Compare &cmp, const T1 &a, const T1 &b) {
+		if (cmp(a, b))
+			return -1;
+		return cmp(b, a) ? 1 : 0;
+	}
+	template<class K>
+	static int threeWay(const Compare &cmp, const K &a, const T1 &b) {
+		if (cmp(a, b))
+			return -1;
+		return cmp(b, a) ? 1 : 0;
+	}
+};
+
+class RBERR {	// used to throw out when error occurs
+public :
+	std::string error;
+	RBERR();
+	RBERR(std::string info) {
+		error = info;
+	}
+};
+
+class OpStats {	// what a tree counts as it works, under the I parameter; a counting tree must be used by one thread at a time, and does its batch updates on that thread
+public:
+	enum Rotation { I_LL, I_RR, I_LR, I_RL, D_LL, D_RR, D_LR, D_RL, ROTATIONS };	// iRotateLL to dRotateRL
+	enum Case { INS_FLIP, INS_SINGLE, INS_DOUBLE, DEL_2B, DEL_ROOT, DEL_2A1, DEL_2A_OUTER, DEL_2A_INNER, CASES };	// how iHandleReorient and dHandleReorient went
+	enum Op { FIND, INSERT, DELETE, OPS };
+
+	mutable uint64_t compares;	// three-way compares of IDs
+	mutable uint64_t recolors;	// colors set by the rebalancing
+	mutable uint64_t allocs;	// nodes made one at a time
+	mutable uint64_t frees;	// nodes freed one at a time
+	mutable uint64_t rotations[ROTATIONS];
+	mutable uint64_t cases[CASES];
+	mutable uint64_t ops[OPS];	// finds, insertions and deletions
+	mutable uint64_t visited[OPS];	// nodes they passed on the way down
+
+	OpStats() { resetStats(); }
+	void resetStats() {
+		compares = recolors = allocs = frees = 0;
+		fill(rotations, rotations + ROTATIONS, 0);
+		fill(cases, cases + CASES, 0);
+		fill(ops, ops + OPS, 0);
+		fill(visited, visited + OPS, 0);
+	}
+	string statsReport(const string &name = "rbtree") const;
+
+	// the hooks the tree calls
+	void onCompare() const { compares++; }
+	void onRecolor(int cnt) const { recolors += cnt; }
+	void onAlloc() const { allocs++; }
+	void onFree() const { frees++; }
+	void onRotate(Rotation kind) const { rotations[kind]++; }
+	void onCase(Case kind) const { cases[kind]++; }
+	void onOp(Op kind) const { ops[kind]++; }
+	void onVisit(Op kind) const { visited[kind]++; }
+};
+
+class NoStats {	// counts nothing: the hooks are empty and compile away, and the tree does not grow
+public:
+	void resetStats() {}
+	string statsReport(const string & /*name*/ = "rbtree") const { return string(); }
+
+	void onCompare() const {}
+	void onRecolor(int /*cnt*/) const {}
+	void onAlloc() const {}
+	void onFree() const {}
+	void onRotate(OpStats::Rotation /*kind*/) const {}
+	void onCase(OpStats::Case /*kind*/) const {}
+	void onOp(OpStats::Op /*kind*/) const {}
+	void onVisit(OpStats::Op /*kind*/) const {}
+};
+
+class TreeShape {	// the shape of a tree, as RBTree::shape finds it
+public:
+	int size;
+	int height;	// the nodes on the longest path from the root
+	int blackHeight;	// the black nodes on every path from the root
+	double avgPath;	// the nodes on the path from the root to a node, on average
+	vector<int> depths;	// depths[d] is the number of nodes d links below the root
+
+	string report(const string &name = "rbtree") const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: statsReport
+// DESCRIPTION: The counters as lines of "name value", in the text format of
+//				Prometheus, so that a service can hand them to a scraper.
+//   ARGUMENTS: const string &name - what the names start with
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: string
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline string OpStats::statsReport(const string &name) const {
+	static const char *rotationNames[ROTATIONS] = { "iRotateLL", "iRotateRR", "iRotateLR", "iRotateRL", "dRotateLL", "dRotateRR", "dRotateLR", "dRotateRL" };
+	static const char *caseNames[CASES] = { "insert_flip", "insert_single", "insert_double", "delete_2B", "delete_root", "delete_2A1", "delete_2A_outer", "delete_2A_inner" };
+	static const char *opNames[OPS] = { "find", "insert", "delete" };
+	string Out;
+	Out += name + "_compares_total " + to_string(compares) + "\n";
+	Out += name + "_recolors_total " + to_string(recolors) + "\n";
+	Out += name + "_allocs_total " + to_string(allocs) + "\n";
+	Out += name + "_frees_total " + to_string(frees) + "\n";
+	for (int i = 0; i < ROTATIONS; i++)
+		Out += name + "_rotations_total{kind=\"" + rotationNames[i] + "\"} " + to_string(rotations[i]) + "\n";
+	for (int i = 0; i < CASES; i++)
+		Out += name + "_reorient_total{case=\"" + caseNames[i] + "\"} " + to_string(cases[i]) + "\n";
+	for (int i = 0; i < OPS; i++) {
+		Out += name + "_ops_total{op=\"" + opNames[i] + "\"} " + to_string(ops[i]) + "\n";
+		Out += name + "_visited_total{op=\"" + opNames[i] + "\"} " + to_string(visited[i]) + "\n";
+	}
+	return Out;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: report
+// DESCRIPTION: The shape as lines of "name value", as OpStats::statsReport.
+//   ARGUMENTS: const string &name - what the names start with
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: string
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline string TreeShape::report(const string &name) const {
+	string Out;
+	Out += name + "_size " + to_string(size) + "\n";
+	Out += name + "_height " + to_string(height) + "\n";
+	Out += name + "_black_height " + to_string(blackHeight) + "\n";
+	Out += name + "_avg_path " + to_string(avgPath) + "\n";
+	for (size_t d = 0; d < depths.size(); d++)
+		Out += name + "_depth_nodes{depth=\"" + to_string(d) + "\"} " + to_string(depths[d]) + "\n";
+	return Out;
+}
+
+template<class T1, class T2 = NULLT, class S = RcdInline, class L = PlainLinks, class Compare = CmpPtr<T1>, class I = NoStats>
+class RBTree : private I {	// I counts what the tree does, and takes no space when it counts nothing
+private :
+	Node<T1, T2, S, L> *root;
+	int size;
+	Compare cmp;
+
+	NodePool<Node<T1, T2, S, L> > pool;	// where all the nodes of the tree live
+	NodePool<T2> rcdPool;	// where the records live under RcdCold
+
+	class Cursor {	// where a descent is; every operation has its own, so trees share nothing
+	public:
+		Node<T1, T2, S, L> *X, *T, *P, *GP, *GGP;
+	};
+
+	Node<T1, T2, S, L> *newNode(const T1 &id, const T2 * const rcd = NULL);
+	template<class K, class... Args>
+	Node<T1, T2, S, L> *emplaceNode(K &&id, Args &&...args);
+	void freeNode(Node<T1, T2, S, L> *node);
+	void freeTree(Node<T1, T2, S, L> *node);
+	void freeAll();
+	Node<T1, T2, S, L> *cloneTree(const Node<T1, T2, S, L> * const node);
+	static bool isRed(const Node<T1, T2, S, L> * const node) { return (node != NULL) && (node->getColor() == 1); }
+	int compareID(const T1 &a, const T1 &b) const { I::onCompare(); return CmpTraits<Compare, T1>::threeWay(cmp, a, b); }
+	template<class K>
+	int compareID(const K &a, const T1 &b) const { I::onCompare(); return CmpTraits<Compare, T1>::threeWay(cmp, a, b); }
+	template<class K>
+	T2 *findKey(const K &id) const;
+	template<class K>
+	const Node<T1, T2, S, L> *lowerKey(const K &id) const;
+	template<class K>
+	bool deleteKey(const K &id);
+	bool relink(Node<T1, T2, S, L> *father, Node<T1, T2, S, L> *oldSon, Node<T1, T2, S, L> *newSon);
+	int calcSize(const Node<T1, T2, S, L> * const node) const;
+	void fixCounts(Node<T1, T2, S, L> *node);
+	Node<T1, T2, S, L>* rotateLL(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* rotateRR(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* rotateLR(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* rotateRL(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* iRotateLL(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* iRotateRR(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* iRotateLR(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* iRotateRL(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* dRotateLL(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* dRotateRR(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* dRotateLR(Node<T1, T2, S, L> *N1);
+	Node<T1, T2, S, L>* dRotateRL(Node<T1, T2, S, L> *N1);
+	bool iHandleReorient(Cursor &C);
+	bool dHandleReorient(Cursor &C, int dir = 0);
+	template<class Make>
+	pair<Node<T1, T2, S, L> *, bool> insertNode(const T1 &id, Make make);
+	template<class It, class IsID>
+	Node<T1, T2, S, L> *buildSorted(It &it, int n, int depth, int redDepth, IsID isID);
+	template<class It>
+	static bool itemsGood(const It &) { return true; }
+
+	// what buildFromSorted makes of an item: a plain ID, or a pair of an ID and a record
+	template<class V>
+	Node<T1, T2, S, L> *sortedNode(V &&item, true_type) { return emplaceNode(std::forward<V>(item)); }
+	template<class V>
+	Node<T1, T2, S, L> *sortedNode(V &&item, false_type) { return emplaceNode(std::forward<V>(item).first, std::forward<V>(item).second); }
+	template<class V>
+	bool sortedLess(const V &a, const V &b, true_type) const { return compareID(a, b) < 0; }
+	template<class V>
+	bool sortedLess(const V &a, const V &b, false_type) const { return compareID(a.first, b.first) < 0; }
+	template<class V>
+	void sortedInsert(const V &item, true_type) { Insert(item); }
+	template<class V>
+	void sortedInsert(const V &item, false_type) { try_emplace(item.first, item.second); }
+	static int redDepthOf(int n);
+	Node<T1, T2, S, L> *linkSorted(Node<T1, T2, S, L> **nodes, int n, int depth, int redDepth);
+
+	// join-based batch updates: subtrees are updated on their own, then joined back
+	static int blackHeight(const Node<T1, T2, S, L> *node);
+	Node<T1, T2, S, L> *join(Node<T1, T2, S, L> *TL, Node<T1, T2, S, L> *K, Node<T1, T2, S, L> *TR);
+	Node<T1, T2, S, L> *joinRight(Node<T1, T2, S, L> *TL, int bhL, Node<T1, T2, S, L> *K, Node<T1, T2, S, L> *TR, int bhR);
+	Node<T1, T2, S, L> *joinLeft(Node<T1, T2, S, L> *TL, int bhL, Node<T1, T2, S, L> *K, Node<T1, T2, S, L> *TR, int bhR);
+	Node<T1, T2, S, L> *joinTwo(Node<T1, T2, S, L> *TL, Node<T1, T2, S, L> *TR);
+	Node<T1, T2, S, L> *splitLast(Node<T1, T2, S, L> *node, Node<T1, T2, S, L> *&last);
+	Node<T1, T2, S, L> *splitAt(Node<T1, T2, S, L> *node, const T1 &key, Node<T1, T2, S, L> *&TL, Node<T1, T2, S, L> *&TR);
+	enum SetOp { UNION, INTERSECT, DIFFERENCE };
+	bool setOp(SetOp op, RBTree<T1, T2, S, L, Compare, I> &b, int threads);
+	Node<T1, T2, S, L> *setOpAt(SetOp op, Node<T1, T2, S, L> *A, Node<T1, T2, S, L> *B, int &matches, vector<Node<T1, T2, S, L> *> &dead, int forks);
+	void releaseTree(Node<T1, T2, S, L> *node);
+	Node<T1, T2, S, L> *insertBatchAt(Node<T1, T2, S, L> *node, Node<T1, T2, S, L> **batch, int m, char *used, int forks);
+	Node<T1, T2, S, L> *deleteBatchAt(Node<T1, T2, S, L> *node, const T1 *batch, int m, Node<T1, T2, S, L> **dead, int forks);
+	static int batchForks(int threads);
+
+	// what save writes ahead of the items
+	struct SavedHead {
+		char magic[4];	// "RBTB"
+		uint32_t version;
+		uint32_t idSize;	// sizeof(T1), to catch a file saved from another type of tree
+		uint32_t rcdSize;	// sizeof(T2), 0 if the tree keeps no records
+		uint64_t cnt;	// the number of items
+	};
+	static const uint32_t savedVersion = 1;
+	static SavedHead savedHead(uint64_t cnt);
+	class Loader {	// the items of a saved file as an input iterator, read one at a time as buildSorted asks
+	public:
+		typedef input_iterator_tag iterator_category;
+		typedef typename conditional<is_empty<T2>::value, T1, pair<T1, T2> >::type value_type;
+		typedef ptrdiff_t difference_type;
+		typedef value_type *pointer;
+		typedef value_type &reference;
+
+		Loader(const RBTree<T1, T2, S, L, Compare, I> *tree, BinaryIn &in, int cnt) : Tree(tree), In(&in), left(cnt), cnt(cnt), good(true), Item(), Last() { read(); }
+		reference operator*() const { return Item; }
+		Loader &operator++() { read(); return *this; }
+		bool isGood() const { return good && In->isGood(); }
+	private:
+		const RBTree<T1, T2, S, L, Compare, I> *Tree;	// whose order the IDs must be in
+		BinaryIn *In;
+		int left;	// the items still to read
+		int cnt;	// the items in the file
+		bool good;	// false once a serializer has failed or an ID is out of order
+		mutable value_type Item;	// the item under the iterator, moved out by buildSorted
+		T1 Last;	// the ID read before, kept to check the order
+
+		void read() {
+			if (left-- <= 0)
+				return;
+			good = good && readItem(Item, is_empty<T2>());
+			const T1 &id = idOf(Item, is_empty<T2>());
+			if (good && (left < cnt - 1) && (Tree->compareID(Last, id) >= 0))
+				good = false;
+			Last = id;
+		}
+		bool readItem(T1 &id, true_type) { return Serializer<T1>::load(*In, id); }
+		bool readItem(pair<T1, T2> &item, false_type) { return Serializer<T1>::load(*In, item.first) && Serializer<T2>::load(*In, item.second); }
+		static const T1 &idOf(const T1 &id, true_type) { return id; }
+		static const T1 &idOf(const pair<T1, T2> &item, false_type) { return item.first; }
+	};
+	static bool itemsGood(const move_iterator<Loader> &it) { return it.base().isGood(); }	// a file stops the build at its first bad item
+public :
+	class iterator {	// in-order, steps through the fathers, so a full scan touches every link twice
+	public:
+		typedef bidirectional_iterator_tag iterator_category;
+		typedef Node<T1, T2, S, L> value_type;
+		typedef ptrdiff_t difference_type;
+		typedef const Node<T1, T2, S, L> *pointer;	// the ID stays put; the record can be changed through getRcd()
+		typedef const Node<T1, T2, S, L> &reference;
+
+		iterator() : tree(NULL), node(NULL) {}
+		reference operator*() const { return *node; }
+		pointer operator->() const { return node; }
+		iterator &operator++() { node = next(node); return *this; }
+		iterator operator++(int) { iterator Tmp = *this; node = next(node); return Tmp; }
+		iterator &operator--() { node = (node == NULL) ? last(tree->root) : prev(node); return *this; }
+		iterator operator--(int) { iterator Tmp = *this; --*this; return Tmp; }
+		bool operator==(const iterator &b) const { return node == b.node; }
+		bool operator!=(const iterator &b) const { return node != b.node; }
+	private:
+		friend class RBTree<T1, T2, S, L, Compare, I>;
+		const RBTree<T1, T2, S, L, Compare, I> *tree;	// for stepping back from end()
+		const Node<T1, T2, S, L> *node;	// NULL at end()
+
+		iterator(const RBTree<T1, T2, S, L, Compare, I> *t, const Node<T1, T2, S, L> *n) : tree(t), node(n) {}
+		static const Node<T1, T2, S, L> *first(const Node<T1, T2, S, L> *N) {
+			if (N != NULL)
+				while (N->getLft() != NULL)
+					N = N->getLft();
+			return N;
+		}
+		static const Node<T1, T2, S, L> *last(const Node<T1, T2, S, L> *N) {
+			if (N != NULL)
+				while (N->getRgt() != NULL)
+					N = N->getRgt();
+			return N;
+		}
+		static const Node<T1, T2, S, L> *next(const Node<T1, T2, S, L> *N) {
+			if (N->getRgt() != NULL)
+				return first(N->getRgt());
+			while ((N->getFather() != NULL) && (N->getFather()->getRgt() == N))
+				N = N->getFather();
+			return N->getFather();
+		}
+		static const Node<T1, T2, S, L> *prev(const Node<T1, T2, S, L> *N) {
+			if (N->getLft() != NULL)
+				return last(N->getLft());
+			while ((N->getFather() != NULL) && (N->getFather()->getLft() == N))
+				N = N->getFather();
+			return N->getFather();
+		}
+	};
+	typedef iterator const_iterator;
+	typedef std::reverse_iterator<iterator> reverse_iterator;
+	typedef reverse_iterator const_reverse_iterator;
+
+	// constructors and destructor
+	RBTree();
+	RBTree(const Compare &compare);
+	RBTree(const Node<T1, T2, S, L> &head, const Compare &compare = Compare());
+	RBTree(const T1 &rootID, const T2 * const rootRcd = NULL, const Compare &compare = Compare());
+	RBTree(const T1 &rootID, const T2 &rootRcd, const Compare &compare = Compare());
+	RBTree(const RBTree<T1, T2, S, L, Compare, I> &New);
+	RBTree(RBTree<T1, T2, S, L, Compare, I> &&Old);
+	~RBTree();
+
+	bool operator=(const RBTree<T1, T2, S, L, Compare, I> &b);
+	bool operator=(RBTree<T1, T2, S, L, Compare, I> &&b);
+
+	bool setCmp(const Compare &compare);
+	bool addRoot(const T1 &id, const T2 * const rcd = NULL);
+	bool addRoot(const T1 &id, const T2 &rcd);
+	bool addRoot(const Node<T1, T2, S, L> &New);
+	template<class It>
+	bool buildFromSorted(It first, It last);
+
+	bool Insert(const T1 &id);
+	pair<T2 *, bool> insert(const T1 &id, const T2 &rcd);
+	pair<T2 *, bool> insert(T1 &&id, T2 &&rcd);
+	template<class K, class... Args>
+	pair<T2 *, bool> emplace(K &&id, Args &&...args);
+	template<class... Args>
+	pair<T2 *, bool> try_emplace(const T1 &id, Args &&...args);
+	template<class... Args>
+	pair<T2 *, bool> try_emplace(T1 &&id, Args &&...args);
+	template<class R>
+	pair<T2 *, bool> insert_or_assign(const T1 &id, R &&rcd);
+	template<class R>
+	pair<T2 *, bool> insert_or_assign(T1 &&id, R &&rcd);
+	bool Delete(const T1 &id) { return deleteKey(id); }
+	bool empty();
+
+	// batch updates, in parallel on up to "threads" threads (0 for all the cores)
+	template<class It>
+	int insertBatch(It first, It last, int threads = 0);
+	template<class It>
+	int deleteBatch(It first, It last, int threads = 0);
+
+	// split and join in O(log n), moving the nodes instead of copying them
+	bool split(const T1 &key, RBTree<T1, T2, S, L, Compare, I> &left, RBTree<T1, T2, S, L, Compare, I> &right);
+	bool join(RBTree<T1, T2, S, L, Compare, I> &left, const T1 &pivot, RBTree<T1, T2, S, L, Compare, I> &right);
+	bool join(RBTree<T1, T2, S, L, Compare, I> &left, RBTree<T1, T2, S, L, Compare, I> &right);
+
+	// set algebra with another tree, whose nodes are taken over or freed
+	bool unionWith(RBTree<T1, T2, S, L, Compare, I> &b, int threads = 0);
+	bool intersect(RBTree<T1, T2, S, L, Compare, I> &b, int threads = 0);
+	bool difference(RBTree<T1, T2, S, L, Compare, I> &b, int threads = 0);
+
+	int getSize() const { return size; }
+	int getHeight() const { return root->getHeight(); }
+	T2 *find(const T1 &id) const { return findKey(id); }
+	bool contains(const T1 &id) const { return findKey(id) != NULL; }
+	T1 rootID() const { return root->getID(); }
+	bool print() const;
+
+	// what the tree has done, counted under I = OpStats, and its shape
+	const I &stats() const { return *this; }
+	void resetStats() { I::resetStats(); }
+	TreeShape shape() const;
+
+	// in-order traversal
+	iterator begin() const { return iterator(this, iterator::first(root)); }
+	iterator end() const { return iterator(this, NULL); }
+	reverse_iterator rbegin() const { return reverse_iterator(end()); }
+	reverse_iterator rend() const { return reverse_iterator(begin()); }
+	iterator lower_bound(const T1 &id) const { return iterator(this, lowerKey(id)); }
+	iterator upper_bound(const T1 &id) const;
+	pair<iterator, iterator> equal_range(const T1 &id) const;
+
+	// lookups by any key that a transparent Compare (one with is_transparent, like less<>) takes in place of a T1,
+	// such as a string_view for a string ID, so that no T1 is made for them
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	T2 *find(const K &key) const { return findKey(key); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K &key) const { return findKey(key) != NULL; }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	iterator lower_bound(const K &key) const { return iterator(this, lowerKey(key)); }
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool Delete(const K &key) { return deleteKey(key); }
+
+	// range queries over [lo, hi)
+	template<class Visitor>
+	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+	int countInRange(const T1 &lo, const T1 &hi) const;
+
+	// order statistics, under Counted<L> links only
+	iterator select(int k) const;
+	int rank(const T1 &id) const;
+	int countRange(const T1 &lo, const T1 &hi) const;
+
+	// a binary file of the items in ID order
+	bool save(const string &path) const;
+	bool load(const string &path);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: RBTree
+// DESCRIPTION: Constructor of RBTree class.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp;
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+RBTree<T1, T2, S, L, Compare, I>::RBTree() : cmp() {
+	root = NULL;
+	size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: RBTree
+// DESCRIPTION: Constructor of RBTree class.
+//   ARGUMENTS: const Compare &compare = Compare() - the compare function
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp;
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+RBTree<T1, T2, S, L, Compare, I>::RBTree(const Compare &compare) : cmp(compare) {
+	root = NULL;
+	size = 0;
+}
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: RBTree
+// DESCRIPTION: Constructor of RBTree class.
+//   ARGUMENTS: const Node<T1, T2, S, L> &head - the root node of the RB tree
+//				const Compare &compare = Compare() - the compare function
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp;
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+RBTree<T1, T2, S, L, Compare, I>::RBTree(const Node<T1, T2, S, L> &head, const Compare &compare) : cmp(compare) {
+	root = newNode(head.getID(), head.getRcd());
+	size = calcSize(root);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: RBTree
+// DESCRIPTION: Constructor of RBTree class.
+//   ARGUMENTS: const T1 &rootID - the ID of the root node
+//				const T2 * const rootRcd = NULL - the initial root record
+//				const Compare &compare = Compare() - the compare function
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp;
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+RBTree<T1, T2, S, L, Compare, I>::RBTree(const T1 &rootID, const T2 * const rootRcd, const Compare &compare) : cmp(compare) {
+	root = newNode(rootID, rootRcd);
+	size = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: RBTree
+// DESCRIPTION: Constructor of RBTree class.
+//   ARGUMENTS: const T1 &rootID - the ID of the root node
+//				const T2 &rootRcd - the initial root record
+//				const Compare &compare = Compare() - the compare function
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp;
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+RBTree<T1, T2, S, L, Compare, I>::RBTree(const T1 &rootID, const T2 &rootRcd, const Compare &compare) : cmp(compare) {
+	root = newNode(rootID, &rootRcd);
+	size = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: RBTree
+// DESCRIPTION: Copy constructor of RBTree class.
+//   ARGUMENTS: const RBTree<T1, T2, S, L, Compare, I> &Old - the RBTree that is to be copied
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp;
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+RBTree<T1, T2, S, L, Compare, I>::RBTree(const RBTree<T1, T2, S, L, Compare, I> &Old) : cmp(Old.cmp) {
+	size = Old.size;
+	root = cloneTree(Old.root);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: RBTree
+// DESCRIPTION: Move constructor of RBTree class. The nodes and the pools they live
+//				in change hands as they are, "Old" is left empty.
+//   ARGUMENTS: RBTree<T1, T2, S, L, Compare, I> &&Old - the tree that is to be moved from
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp, pool, rcdPool
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+RBTree<T1, T2, S, L, Compare, I>::RBTree(RBTree<T1, T2, S, L, Compare, I> &&Old) : cmp(std::move(Old.cmp)) {
+	root = Old.root;
+	size = Old.size;
+	pool.swap(Old.pool);
+	rcdPool.swap(Old.rcdPool);
+	Old.root = NULL;
+	Old.size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: operator=
+// DESCRIPTION: To make the tree a deep copy of another one.
+//   ARGUMENTS: const RBTree<T1, T2, S, L, Compare, I> &b - the tree that is to be copied
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp, pool, rcdPool
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::operator=(const RBTree<T1, T2, S, L, Compare, I> &b) {
+	if (&b == this)
+		return true;
+	freeAll();
+	size = 0;
+	cmp = b.cmp;
+	root = cloneTree(b.root);
+	size = b.size;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: operator=
+// DESCRIPTION: To take over the nodes of another tree, leaving "b" empty. The
+//				nodes of this tree are released first.
+//   ARGUMENTS: RBTree<T1, T2, S, L, Compare, I> &&b - the tree that is to be moved from
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp, pool, rcdPool
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::operator=(RBTree<T1, T2, S, L, Compare, I> &&b) {
+	if (&b == this)
+		return true;
+	freeAll();
+	cmp = std::move(b.cmp);
+	pool.swap(b.pool);
+	rcdPool.swap(b.rcdPool);
+	root = b.root;
+	size = b.size;
+	b.root = NULL;
+	b.size = 0;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: RBTree
+// DESCRIPTION: Destructor of RBTree class.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: root, size, cmp;
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+RBTree<T1, T2, S, L, Compare, I>::~RBTree() {
+	freeAll();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: calcSize
+// DESCRIPTION: To calculate the size of the tree with the root "node".
+//   ARGUMENTS: const Node<T1, T2, S, L> * const node - the root the of tree
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+int RBTree<T1, T2, S, L, Compare, I>::calcSize(const Node<T1, T2, S, L> * const node) const {
+	if (node == NULL)
+		return 0;
+	else
+		return node->getCount();	// O(1) under Counted<L>, a walk otherwise
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: fixCounts
+// DESCRIPTION: To count the nodes again from "node" up to the root, after a son
+//				was hung or cut off below it. Nothing to do without Counted<L>.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the lowest node whose count is off
+// USES GLOBAL: none
+// MODIFIES GL: the Cnt of node and its fathers
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+void RBTree<T1, T2, S, L, Compare, I>::fixCounts(Node<T1, T2, S, L> *node) {
+	if (!Node<T1, T2, S, L>::counted)
+		return;
+	for (; node != NULL; node = node->getFather())
+		node->fixCount();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: newNode
+// DESCRIPTION: To build a new node in a slot taken from the tree's pool.
+//   ARGUMENTS: const T1 &id - the ID of the new node
+//				const T2 * const rcd - the initial record with default value NULL
+// USES GLOBAL: none
+// MODIFIES GL: pool
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::newNode(const T1 &id, const T2 * const rcd) {
+	void *slot = pool.alloc();
+	void *rcdSlot = RcdStore<T2, S>::cold ? rcdPool.alloc() : NULL;
+	I::onAlloc();
+	try {
+		return new (slot) Node<T1, T2, S, L>(id, rcd, 0, rcdSlot);
+	}
+	catch (...) {
+		rcdPool.release(rcdSlot);
+		pool.release(slot);
+		throw;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: emplaceNode
+// DESCRIPTION: To build a new node in a slot taken from the tree's pool, the ID
+//				from "id" and the record from "args", both in place.
+//   ARGUMENTS: K &&id - what the ID is built from
+//				Args &&...args - what the record is built from
+// USES GLOBAL: none
+// MODIFIES GL: pool, rcdPool
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class K, class... Args>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::emplaceNode(K &&id, Args &&...args) {
+	void *slot = pool.alloc();
+	void *rcdSlot = RcdStore<T2, S>::cold ? rcdPool.alloc() : NULL;
+	I::onAlloc();
+	try {
+		return new (slot) Node<T1, T2, S, L>(InPlace(), std::forward<K>(id), rcdSlot, std::forward<Args>(args)...);
+	}
+	catch (...) {
+		rcdPool.release(rcdSlot);
+		pool.release(slot);
+		throw;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: freeNode
+// DESCRIPTION: To destroy a single node and give its slot back to the pool.
+//				The sons and a cold record are detached first so that ~Node
+//				leaves them alone.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the node that is to be released
+// USES GLOBAL: none
+// MODIFIES GL: pool, rcdPool
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+void RBTree<T1, T2, S, L, Compare, I>::freeNode(Node<T1, T2, S, L> *node) {
+	I::onFree();
+	T2 *Rcd = node->takeRcd();
+	if (Rcd != NULL) {
+		Rcd->~T2();
+		rcdPool.release(Rcd);
+	}
+	node->AddLft((Node<T1, T2, S, L> *)NULL);
+	node->AddRgt((Node<T1, T2, S, L> *)NULL);
+	node->~Node();
+	pool.release(node);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: freeTree
+// DESCRIPTION: To destroy all the nodes under "node". The slots are not put
+//				on the free list; the caller gives the slabs back at once.
+//				The nodes go in postorder, climbing back through the
+//				fathers, so no stack is taken however deep the subtree is.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the root of the subtree
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+void RBTree<T1, T2, S, L, Compare, I>::freeTree(Node<T1, T2, S, L> *node) {
+	Node<T1, T2, S, L> *X = node;
+	while (X != NULL) {
+		while ((X->getLft() != NULL) || (X->getRgt() != NULL))	// down to the first node in postorder
+			X = (X->getLft() != NULL) ? X->getLft() : X->getRgt();
+		while (true) {	// destroy it and the fathers it is the last son of
+			Node<T1, T2, S, L> *Father = (X == node) ? NULL : X->getFather();
+			bool lastSon = (Father == NULL) || (Father->getRgt() == X) || (Father->getRgt() == NULL);
+			T2 *Rcd = X->takeRcd();
+			if (Rcd != NULL)
+				Rcd->~T2();
+			X->AddLft((Node<T1, T2, S, L> *)NULL);
+			X->AddRgt((Node<T1, T2, S, L> *)NULL);
+			X->~Node();
+			if (!lastSon) {
+				X = Father->getRgt();
+				break;
+			}
+			X = Father;
+			if (X == NULL)
+				break;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: freeAll
+// DESCRIPTION: To release every node of the tree. When neither the IDs nor the
+//				records need a destructor the tree is not even walked, and the
+//				cost only depends on the number of slabs.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: root, pool, rcdPool
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+void RBTree<T1, T2, S, L, Compare, I>::freeAll() {
+	if (!(is_trivially_destructible<T1>::value && is_trivially_destructible<T2>::value))
+		freeTree(root);
+	pool.clear();
+	rcdPool.clear();
+	root = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: cloneTree
+// DESCRIPTION: To copy the subtree under "node" into nodes of this tree's pool.
+//				The subtree is walked through the fathers, side by side with
+//				the copy, so no stack is taken however deep it is.
+//   ARGUMENTS: const Node<T1, T2, S, L> * const node - the root of the subtree
+// USES GLOBAL: none
+// MODIFIES GL: pool
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::cloneTree(const Node<T1, T2, S, L> * const node) {
+	if (node == NULL)
+		return NULL;
+	Node<T1, T2, S, L> *Top = newNode(node->getID(), node->getRcd());
+	Top->setColor(node->getColor());
+
+	// a new node has no sons yet, so an empty son is one still to copy
+	const Node<T1, T2, S, L> *X = node;
+	Node<T1, T2, S, L> *Y = Top, *Tmp;
+	while (true) {
+		if ((X->getLft() != NULL) && (Y->getLft() == NULL)) {
+			X = X->getLft();
+			Tmp = newNode(X->getID(), X->getRcd());
+			Y->AddLft(Tmp);
+		}
+		else if ((X->getRgt() != NULL) && (Y->getRgt() == NULL)) {
+			X = X->getRgt();
+			Tmp = newNode(X->getID(), X->getRcd());
+			Y->AddRgt(Tmp);
+		}
+		else {	// both sons are done
+			Y->fixCount();
+			if (X == node)
+				break;
+			X = X->getFather();
+			Y = Y->getFather();
+			continue;
+		}
+		Tmp->setColor(X->getColor());
+		Y = Tmp;
+	}
+	return Top;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: relink
+// DESCRIPTION: To hang "newSon" where "oldSon" was under "father". A NULL
+//				father means "oldSon" was the root.
+//   ARGUMENTS: Node<T1, T2, S, L> *father - the father of oldSon, or NULL
+//				Node<T1, T2, S, L> *oldSon - the son that is to be replaced
+//				Node<T1, T2, S, L> *newSon - the son that takes its place
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::relink(Node<T1, T2, S, L> *father, Node<T1, T2, S, L> *oldSon, Node<T1, T2, S, L> *newSon) {
+	if (father == NULL) {
+		root = newSon;
+		if (newSon != NULL)
+			newSon->setFather(NULL);
+	}
+	else if (father->getLft() == oldSon)
+		father->AddLft(newSon);
+	else
+		father->AddRgt(newSon);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: setCmp
+// DESCRIPTION: To assign the compare function to the member function pointer.
+//   ARGUMENTS: const Compare &compare - the compare function
+// USES GLOBAL: none
+// MODIFIES GL: cmp
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::setCmp(const Compare &compare) {
+	cmp = compare;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: addRoot
+// DESCRIPTION: To add a root for the RB tree.
+//   ARGUMENTS: const T1 &id - the id of the root node
+//				const T2 * const rcd - the record of the root node with default value NULL
+// USES GLOBAL: none
+// MODIFIES GL: root, size
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::addRoot(const T1 &id, const T2 * const rcd) {
+	if (root != NULL) {
+		throw RBERR("root already exists");
+	}
+	root = newNode(id, rcd);
+	size = calcSize(root);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: addRoot
+// DESCRIPTION: To add a root for the RB tree.
+//   ARGUMENTS: const T1 &id - the id of the root node
+//				const T2 &rcd - the record of the root node
+// USES GLOBAL: none
+// MODIFIES GL: root, size
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::addRoot(const T1 &id, const T2 &rcd) {
+	if (root != NULL) {
+		throw RBERR("root already exists");
+	}
+	root = newNode(id, &rcd);
+	size = calcSize(root);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: addRoot
+// DESCRIPTION: To add a root for the Red-Black tree.
+//   ARGUMENTS: const Node<T1, T2, S, L> &New - the copy of the root node
+// USES GLOBAL: none
+// MODIFIES GL: root, size
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::addRoot(const Node<T1, T2, S, L> &New) {
+	if (root != NULL) {
+		throw RBERR("root already exists");
+	}
+	root = cloneTree(&New);
+	size = calcSize(root);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: empty
+// DESCRIPTION: To delete all the nodes in the Red-Black tree.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: root, size
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-10
+//							KC 2015-02-10
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::empty() {
+	if (root == NULL)
+		return true;
+	freeAll();
+	size = 0;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: findKey
+// DESCRIPTION: To find a node of a certain ID in Red-Black tree. The descent
+//				only reads the tree (no recoloring, no rotation), so any
+//				number of finds may run at the same time.
+//   ARGUMENTS: const K &id - the ID of the node that we want to find, a T1 or
+//				a key that a transparent Compare takes in its place
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: T2*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-24
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class K>
+T2 *RBTree<T1, T2, S, L, Compare, I>::findKey(const K &id) const {
+	const Node<T1, T2, S, L> *X = root;
+	int dir;
+	I::onOp(OpStats::FIND);
+	while (X != NULL) {
+		I::onVisit(OpStats::FIND);
+		if ((dir = compareID(id, X->getID())) == 0)
+			break;
+		if (dir > 0)
+			X = X->getRgt();
+		else
+			X = X->getLft();
+	}
+	if (X == NULL)
+		return NULL;
+	return X->getRcd();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateLL
+// DESCRIPTION: The single rotation LL of Red-Black tree.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-21
+//							KC 2015-02-21
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::rotateLL(Node<T1, T2, S, L> *N1) {
+	Node<T1, T2, S, L> *N2 = N1->getLft();
+	N1->AddLft(N2->getRgt());
+	N2->AddRgt(N1);
+	return N2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateRR
+// DESCRIPTION: The single rotation RR of Red-Black tree.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-21
+//							KC 2015-02-21
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::rotateRR(Node<T1, T2, S, L> *N1) {
+	Node<T1, T2, S, L> *N2 = N1->getRgt();
+	N1->AddRgt(N2->getLft());
+	N2->AddLft(N1);
+	return N2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateLR
+// DESCRIPTION: The double rotation LR of Red-Black tree.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-21
+//							KC 2015-02-21
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::rotateLR(Node<T1, T2, S, L> *N1) {
+	Node<T1, T2, S, L> *N2 = N1->getLft();
+	Node<T1, T2, S, L> *N3 = N2->getRgt();
+	N2->AddRgt(N3->getLft());
+	N1->AddLft(N3->getRgt());
+	N3->AddLft(N2);
+	N3->AddRgt(N1);
+	return N3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateRL
+// DESCRIPTION: The double rotation RL of RB tree.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-21
+//							KC 2015-02-21
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::rotateRL(Node<T1, T2, S, L> *N1) {
+	Node<T1, T2, S, L> *N2 = N1->getRgt();
+	Node<T1, T2, S, L> *N3 = N2->getLft();
+	N2->AddLft(N3->getRgt());
+	N1->AddRgt(N3->getLft());
+	N3->AddLft(N1);
+	N3->AddRgt(N2);
+	return N3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: iRotateLL
+// DESCRIPTION: The single rotation LL and recoloring of RB tree used for Insertion.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2015-02-28
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::iRotateLL(Node<T1, T2, S, L> *N1) {
+	Node<T1, T2, S, L> *N2 = N1->getLft();
+	N1->setColor(1 - N1->getColor());
+	N2->setColor(1 - N2->getColor());
+	I::onRotate(OpStats::I_LL);
+	I::onRecolor(2);
+	return rotateLL(N1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: iRotateRR
+// DESCRIPTION: The single rotation RR and recoloring of RB tree used for Insertion.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2015-02-28
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::iRotateRR(Node<T1, T2, S, L> *N1) {
+	Node<T1, T2, S, L> *N2 = N1->getRgt();
+	N1->setColor(1 - N1->getColor());
+	N2->setColor(1 - N2->getColor());
+	I::onRotate(OpStats::I_RR);
+	I::onRecolor(2);
+	return rotateRR(N1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: iRotateLR
+// DESCRIPTION: The double rotation LR and recoloring of RB tree used for Insertion.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2015-02-28
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::iRotateLR(Node<T1, T2, S, L> *N1) {
+	I::onRotate(OpStats::I_LR);
+	I::onRecolor(2);
+	Node<T1, T2, S, L> *N2 = N1->getLft();
+	Node<T1, T2, S, L> *N3 = N2->getRgt();
+	N1->setColor(1 - N1->getColor());
+	N3->setColor(1 - N3->getColor());
+	return rotateLR(N1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: iRotateRL
+// DESCRIPTION: The double rotation RL and recoloring of RB tree used for Insertion.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2015-02-28
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::iRotateRL(Node<T1, T2, S, L> *N1) {
+	I::onRotate(OpStats::I_RL);
+	I::onRecolor(2);
+	Node<T1, T2, S, L> *N2 = N1->getRgt();
+	Node<T1, T2, S, L> *N3 = N2->getLft();
+	N1->setColor(1 - N1->getColor());
+	N3->setColor(1 - N3->getColor());
+	return rotateRL(N1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: dRotateLL
+// DESCRIPTION: The single rotation LL and recoloring of RB tree used for Deletion.
+//				The new top of the subtree is red and both its sons are black.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::dRotateLL(Node<T1, T2, S, L> *N1) {
+	I::onRotate(OpStats::D_LL);
+	I::onRecolor(3);
+	Node<T1, T2, S, L> *N2 = rotateLL(N1);
+	N2->setColor(1);
+	N2->getLft()->setColor(0);
+	N2->getRgt()->setColor(0);
+	return N2;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: dRotateRR
+// DESCRIPTION: The single rotation RR and recoloring of RB tree used for Deletion.
+//				The new top of the subtree is red and both its sons are black.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::dRotateRR(Node<T1, T2, S, L> *N1) {
+	I::onRotate(OpStats::D_RR);
+	I::onRecolor(3);
+	Node<T1, T2, S, L> *N2 = rotateRR(N1);
+	N2->setColor(1);
+	N2->getLft()->setColor(0);
+	N2->getRgt()->setColor(0);
+	return N2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: dRotateLR
+// DESCRIPTION: The double rotation LR and recoloring of RB tree used for Deletion.
+//				The new top of the subtree is red and both its sons are black.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::dRotateLR(Node<T1, T2, S, L> *N1) {
+	I::onRotate(OpStats::D_LR);
+	I::onRecolor(3);
+	Node<T1, T2, S, L> *N3 = rotateLR(N1);
+	N3->setColor(1);
+	N3->getLft()->setColor(0);
+	N3->getRgt()->setColor(0);
+	return N3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: dRotateRL
+// DESCRIPTION: The double rotation RL and recoloring of RB tree used for Deletion.
+//				The new top of the subtree is red and both its sons are black.
+//   ARGUMENTS: Node<T1, T2, S, L> *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-28
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L>* RBTree<T1, T2, S, L, Compare, I>::dRotateRL(Node<T1, T2, S, L> *N1) {
+	I::onRotate(OpStats::D_RL);
+	I::onRecolor(3);
+	Node<T1, T2, S, L> *N3 = rotateRL(N1);
+	N3->setColor(1);
+	N3->getLft()->setColor(0);
+	N3->getRgt()->setColor(0);
+	return N3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: iHandleReorient
+// DESCRIPTION: handle the reorientation including recoloring and rotation for insertion.
+//				After a rotation the cursor is moved so that the descent
+//				can go on from C.X with the right fathers.
+//   ARGUMENTS: Cursor &C - where the descent is
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: Node<T1, T2, S, L>*
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-23
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::iHandleReorient(Cursor &C) {
+
+	// recoloring
+	C.X->setColor(1);
+	if (C.X->getLft() != NULL)
+		C.X->getLft()->setColor(0);
+	if (C.X->getRgt() != NULL)
+		C.X->getRgt()->setColor(0);
+	I::onRecolor(1 + (C.X->getLft() != NULL) + (C.X->getRgt() != NULL));
+
+	if ((C.P != NULL) && (C.P->getColor() == 1)) {	// rotation
+		// the sides are read off the links, so no ID is compared again
+		int Case = (C.P->getLft() == C.X) + ((C.GP->getLft() == C.P) << 1);
+		I::onCase(((Case == 0) || (Case == 3)) ? OpStats::INS_SINGLE : OpStats::INS_DOUBLE);
+		switch(Case) {
+		case 0:	// single rotate with right
+			relink(C.GGP, C.GP, iRotateRR(C.GP));
+			C.GP = C.GGP;
+			break;
+		case 1:	// double rotate right-left
+			relink(C.GGP, C.GP, iRotateRL(C.GP));
+			C.P = C.GGP;
+			break;
+		case 2: // double rotate left-right
+			relink(C.GGP, C.GP, iRotateLR(C.GP));
+			C.P = C.GGP;
+			break;
+		case 3: // single rotate with left
+			relink(C.GGP, C.GP, iRotateLL(C.GP));
+			C.GP = C.GGP;
+			break;
+		default:
+			throw RBERR("Case out of range");
+			return false;
+		}
+	}
+	else
+		I::onCase(OpStats::INS_FLIP);
+
+	root->setColor(0);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: buildFromSorted
+// DESCRIPTION: To replace the whole tree with the items in [first, last), which
+//				are IDs or pairs of an ID and a record, in increasing ID order.
+//				The tree is built in O(n) with no rotation: every subtree is
+//				split in halves, so all the leaves are on the last two levels,
+//				and only the nodes on an incomplete last level are red. The
+//				nodes are carved in ID order out of one slab. Input that is not
+//				strictly increasing is inserted one by one instead.
+//   ARGUMENTS: It first - the first item
+//				It last - one past the last item
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool - true if built in O(n), false if it fell back on insertion
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class It>
+bool RBTree<T1, T2, S, L, Compare, I>::buildFromSorted(It first, It last) {
+	typedef typename iterator_traits<It>::value_type V;
+	typedef integral_constant<bool, is_convertible<V, T1>::value> IsID;
+	freeAll();
+	size = 0;
+
+	// count the items and check their order
+	int n = 0;
+	bool sorted = true;
+	for (It Prev = first, Cur = first; Cur != last; Prev = Cur++, n++)
+		if ((n > 0) && !sortedLess(*Prev, *Cur, IsID())) {
+			sorted = false;
+			break;
+		}
+
+	if (!sorted) {
+		for (; first != last; ++first)
+			sortedInsert(*first, IsID());
+		return false;
+	}
+	if (n == 0)
+		return true;
+
+	pool.reserve(n);
+	if (RcdStore<T2, S>::cold)
+		rcdPool.reserve(n);
+	root = buildSorted(first, n, 0, redDepthOf(n), IsID());
+	size = n;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: buildSorted
+// DESCRIPTION: To build a balanced subtree of the next "n" items, the left half
+//				first so that the nodes are made in ID order. Once the items go
+//				bad (a short or broken file under load) no more nodes are made,
+//				and the caller throws the tree away.
+//   ARGUMENTS: It &it - the next item, moved past the subtree
+//				int n - the number of items in the subtree
+//				int depth - the depth of the subtree's root
+//				int redDepth - the depth whose nodes are red, -1 for none
+//				IsID isID - true_type for plain IDs, false_type for pairs
+// USES GLOBAL: none
+// MODIFIES GL: pool, rcdPool
+//     RETURNS: Node<T1, T2, S, L>* - the root of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class It, class IsID>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::buildSorted(It &it, int n, int depth, int redDepth, IsID isID) {
+	if ((n == 0) || !itemsGood(it))
+		return NULL;
+	Node<T1, T2, S, L> *Lft = buildSorted(it, (n - 1) / 2, depth + 1, redDepth, isID);
+	if (!itemsGood(it))
+		return Lft;
+	Node<T1, T2, S, L> *X = sortedNode(*it, isID);
+	++it;
+	X->setColor(depth == redDepth ? 1 : 0);
+	X->AddLft(Lft);
+	X->AddRgt(buildSorted(it, n - 1 - (n - 1) / 2, depth + 1, redDepth, isID));
+	return X;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: redDepthOf
+// DESCRIPTION: The depth of the red nodes in a balanced tree of "n" nodes: all
+//				the levels are full but maybe the last one, whose nodes are red.
+//   ARGUMENTS: int n - the number of nodes
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int - the depth of the last level, -1 if it is full
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+int RBTree<T1, T2, S, L, Compare, I>::redDepthOf(int n) {
+	int levels = 0;
+	while ((1LL << levels) - 1 < n)	// (1 << levels) - 1 nodes fill "levels" levels
+		++levels;
+	return ((1LL << levels) - 1 == n) ? -1 : levels - 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: linkSorted
+// DESCRIPTION: As buildSorted, but out of nodes that are already made.
+//   ARGUMENTS: Node<T1, T2, S, L> **nodes - the nodes, in increasing ID order
+//				int n - the number of nodes
+//				int depth - the depth of the subtree's root
+//				int redDepth - the depth whose nodes are red, -1 for none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the root of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::linkSorted(Node<T1, T2, S, L> **nodes, int n, int depth, int redDepth) {
+	if (n == 0)
+		return NULL;
+	int mid = (n - 1) / 2;
+	Node<T1, T2, S, L> *X = nodes[mid];
+	X->setColor(depth == redDepth ? 1 : 0);
+	X->AddLft(linkSorted(nodes, mid, depth + 1, redDepth));
+	X->AddRgt(linkSorted(nodes + mid + 1, n - 1 - mid, depth + 1, redDepth));
+	X->setFather(NULL);
+	return X;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: blackHeight
+// DESCRIPTION: The number of black nodes on the leftmost path of a subtree.
+//   ARGUMENTS: const Node<T1, T2, S, L> *node - the root of the subtree
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int - 0 for an empty subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+int RBTree<T1, T2, S, L, Compare, I>::blackHeight(const Node<T1, T2, S, L> *node) {
+	int bh = 0;
+	for (; node != NULL; node = node->getLft())
+		if (!isRed(node))
+			++bh;
+	return bh;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: join
+// DESCRIPTION: To join two red-black subtrees and a node whose ID lies between
+//				them: every ID of "TL" is less than K's, every ID of "TR"
+//				greater. Both roots are made black, then K is hung on the
+//				spine of the taller one where the black heights meet, and the
+//				red-red link that may leave is fixed on the way back up. It
+//				costs O(|bh(TL) - bh(TR)| + 1) after the black heights.
+//   ARGUMENTS: Node<T1, T2, S, L> *TL - the left subtree, may be NULL
+//				Node<T1, T2, S, L> *K - the middle node, its old links dropped
+//				Node<T1, T2, S, L> *TR - the right subtree, may be NULL
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the root of the joined subtree, maybe red
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::join(Node<T1, T2, S, L> *TL, Node<T1, T2, S, L> *K, Node<T1, T2, S, L> *TR) {
+	if (isRed(TL))
+		TL->setColor(0);
+	if (isRed(TR))
+		TR->setColor(0);
+	int bhL = blackHeight(TL), bhR = blackHeight(TR);
+	Node<T1, T2, S, L> *X;
+	if (bhL > bhR) {
+		X = joinRight(TL, bhL, K, TR, bhR);
+		if (isRed(X) && isRed(X->getRgt()))
+			X->setColor(0);
+	}
+	else if (bhL < bhR) {
+		X = joinLeft(TL, bhL, K, TR, bhR);
+		if (isRed(X) && isRed(X->getLft()))
+			X->setColor(0);
+	}
+	else {
+		K->setColor(1);
+		K->AddLft(TL);
+		K->AddRgt(TR);
+		X = K;
+	}
+	X->setFather(NULL);
+	return X;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: joinRight
+// DESCRIPTION: The half of join where "TL" is the taller: down its right spine
+//				to the first black node of black height bh(TR), which becomes
+//				K's left son, and a left rotation wherever a black node is left
+//				with a red son and a red grandson on the right.
+//   ARGUMENTS: Node<T1, T2, S, L> *TL - the left subtree
+//				int bhL - the black height of "TL"
+//				Node<T1, T2, S, L> *K - the middle node
+//				Node<T1, T2, S, L> *TR - the right subtree, with a black root
+//				int bhR - the black height of "TR"
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the new root of "TL"
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::joinRight(Node<T1, T2, S, L> *TL, int bhL, Node<T1, T2, S, L> *K, Node<T1, T2, S, L> *TR, int bhR) {
+	if (!isRed(TL) && (bhL == bhR)) {
+		K->setColor(1);
+		K->AddLft(TL);
+		K->AddRgt(TR);
+		return K;
+	}
+	Node<T1, T2, S, L> *X = joinRight(TL->getRgt(), bhL - (isRed(TL) ? 0 : 1), K, TR, bhR);
+	TL->AddRgt(X);
+	if (!isRed(TL) && isRed(X) && isRed(X->getRgt())) {
+		X->getRgt()->setColor(0);
+		return rotateRR(TL);
+	}
+	return TL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: joinLeft
+// DESCRIPTION: The mirror of joinRight, for a taller "TR".
+//   ARGUMENTS: Node<T1, T2, S, L> *TL - the left subtree, with a black root
+//				int bhL - the black height of "TL"
+//				Node<T1, T2, S, L> *K - the middle node
+//				Node<T1, T2, S, L> *TR - the right subtree
+//				int bhR - the black height of "TR"
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the new root of "TR"
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::joinLeft(Node<T1, T2, S, L> *TL, int bhL, Node<T1, T2, S, L> *K, Node<T1, T2, S, L> *TR, int bhR) {
+	if (!isRed(TR) && (bhL == bhR)) {
+		K->setColor(1);
+		K->AddLft(TL);
+		K->AddRgt(TR);
+		return K;
+	}
+	Node<T1, T2, S, L> *X = joinLeft(TL, bhL, K, TR->getLft(), bhR - (isRed(TR) ? 0 : 1));
+	TR->AddLft(X);
+	if (!isRed(TR) && isRed(X) && isRed(X->getLft())) {
+		X->getLft()->setColor(0);
+		return rotateLL(TR);
+	}
+	return TR;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: joinTwo
+// DESCRIPTION: To join two subtrees with no node between them: the last node
+//				of "TL" is split off and used as the middle node.
+//   ARGUMENTS: Node<T1, T2, S, L> *TL - the left subtree, may be NULL
+//				Node<T1, T2, S, L> *TR - the right subtree, may be NULL
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the root of the joined subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::joinTwo(Node<T1, T2, S, L> *TL, Node<T1, T2, S, L> *TR) {
+	if (TL == NULL) {
+		if (TR != NULL)
+			TR->setFather(NULL);
+		return TR;
+	}
+	Node<T1, T2, S, L> *K;
+	TL = splitLast(TL, K);
+	return join(TL, K, TR);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: splitLast
+// DESCRIPTION: To take the last node out of a subtree, joining the rest back
+//				on the way up the right spine.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the root of the subtree, not NULL
+//				Node<T1, T2, S, L> *&last - set to the node taken out
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the root of the rest, may be NULL
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::splitLast(Node<T1, T2, S, L> *node, Node<T1, T2, S, L> *&last) {
+	if (node->getRgt() == NULL) {
+		last = node;
+		Node<T1, T2, S, L> *Lft = node->getLft();
+		if (Lft != NULL)
+			Lft->setFather(NULL);
+		return Lft;
+	}
+	Node<T1, T2, S, L> *Rest = splitLast(node->getRgt(), last);
+	return join(node->getLft(), node, Rest);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: splitAt
+// DESCRIPTION: To split a subtree at "key": down the search path, every node
+//				is joined to the side it belongs to with its other subtree, so
+//				the pieces of each side are joined from the shortest up and it
+//				costs O(log n) in all.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the root of the subtree, may be NULL
+//				const T1 &key - where to split
+//				Node<T1, T2, S, L> *&TL - set to the subtree of the IDs < key
+//				Node<T1, T2, S, L> *&TR - set to the subtree of the IDs > key
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the node of "key" taken out, NULL if none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::splitAt(Node<T1, T2, S, L> *node, const T1 &key, Node<T1, T2, S, L> *&TL, Node<T1, T2, S, L> *&TR) {
+	if (node == NULL) {
+		TL = TR = NULL;
+		return NULL;
+	}
+	Node<T1, T2, S, L> *Lft = node->getLft(), *Rgt = node->getRgt(), *Mid, *Tmp;
+	int dir = compareID(node->getID(), key);
+	if (dir == 0) {
+		TL = Lft;
+		TR = Rgt;
+		Mid = node;
+	}
+	else if (dir < 0) {
+		Mid = splitAt(Rgt, key, Tmp, TR);
+		TL = join(Lft, node, Tmp);
+	}
+	else {
+		Mid = splitAt(Lft, key, TL, Tmp);
+		TR = join(Tmp, node, Rgt);
+	}
+	if (TL != NULL)
+		TL->setFather(NULL);
+	if (TR != NULL)
+		TR->setFather(NULL);
+	return Mid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: split
+// DESCRIPTION: To move the nodes of this tree into two trees: the IDs less
+//				than "key" into "left", the others into "right". Nothing is
+//				copied or allocated, and the two trees share the slabs that
+//				the nodes live in until both are gone. It costs O(log n) under
+//				Counted<L>; otherwise the size of "right" takes a walk. Either
+//				of the two may be this tree.
+//   ARGUMENTS: const T1 &key - the least ID of "right"
+//				RBTree<T1, T2, S, L, Compare, I> &left - emptied, then filled
+//				RBTree<T1, T2, S, L, Compare, I> &right - emptied, then filled
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool - false if "left" and "right" are the same tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::split(const T1 &key, RBTree<T1, T2, S, L, Compare, I> &left, RBTree<T1, T2, S, L, Compare, I> &right) {
+	if (&left == &right)
+		return false;
+	Node<T1, T2, S, L> *TL, *TR;
+	Node<T1, T2, S, L> *Mid = splitAt(root, key, TL, TR);
+	if (Mid != NULL)
+		TR = join((Node<T1, T2, S, L> *)NULL, Mid, TR);
+	int rightSize = calcSize(TR), leftSize = size - rightSize;
+
+	// the slabs go to "left", and are shared with "right"
+	NodePool<Node<T1, T2, S, L> > Nodes, NodesR;
+	NodePool<T2> Rcds, RcdsR;
+	Nodes.swap(pool);
+	Rcds.swap(rcdPool);
+	Nodes.share(NodesR, rightSize);
+	Rcds.share(RcdsR, 0);
+	Compare compare = cmp;
+	root = NULL;
+	size = 0;
+
+	left.freeAll();
+	left.pool.swap(Nodes);
+	left.rcdPool.swap(Rcds);
+	left.cmp = compare;
+	left.root = TL;
+	left.size = leftSize;
+	if (TL != NULL)
+		TL->setColor(0);
+
+	right.freeAll();
+	right.pool.swap(NodesR);
+	right.rcdPool.swap(RcdsR);
+	right.cmp = compare;
+	right.root = TR;
+	right.size = rightSize;
+	if (TR != NULL)
+		TR->setColor(0);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: join
+// DESCRIPTION: To replace this tree with "left", a new node "pivot" and
+//				"right", whose IDs must be less than "pivot" and greater than
+//				it. The nodes and slabs of both trees are taken over, which
+//				leaves them empty; only the pivot is allocated. It costs
+//				O(log n). Either of the two may be this tree.
+//   ARGUMENTS: RBTree<T1, T2, S, L, Compare, I> &left - the lower IDs
+//				const T1 &pivot - the ID between them
+//				RBTree<T1, T2, S, L, Compare, I> &right - the higher IDs
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool - false if the IDs are out of order, with nothing moved
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::join(RBTree<T1, T2, S, L, Compare, I> &left, const T1 &pivot, RBTree<T1, T2, S, L, Compare, I> &right) {
+	if (&left == &right)
+		return false;
+	if ((left.root != NULL) && (compareID(iterator::last(left.root)->getID(), pivot) >= 0))
+		return false;
+	if ((right.root != NULL) && (compareID(pivot, iterator::first(right.root)->getID()) >= 0))
+		return false;
+
+	Node<T1, T2, S, L> *TL = left.root, *TR = right.root;
+	int n = left.size + right.size;
+	NodePool<Node<T1, T2, S, L> > Nodes;
+	NodePool<T2> Rcds;
+	Nodes.adopt(left.pool);
+	Nodes.adopt(right.pool);
+	Rcds.adopt(left.rcdPool);
+	Rcds.adopt(right.rcdPool);
+	left.root = right.root = NULL;
+	left.size = right.size = 0;
+
+	freeAll();
+	pool.swap(Nodes);
+	rcdPool.swap(Rcds);
+	root = join(TL, newNode(pivot), TR);
+	root->setColor(0);
+	size = n + 1;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: join
+// DESCRIPTION: To replace this tree with "left" and "right", whose IDs must
+//				all be less than those of "right". The last node of "left"
+//				is taken out and used as the pivot, so nothing is allocated.
+//   ARGUMENTS: RBTree<T1, T2, S, L, Compare, I> &left - the lower IDs
+//				RBTree<T1, T2, S, L, Compare, I> &right - the higher IDs
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool - false if the IDs are out of order, with nothing moved
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::join(RBTree<T1, T2, S, L, Compare, I> &left, RBTree<T1, T2, S, L, Compare, I> &right) {
+	if (&left == &right)
+		return false;
+	if ((left.root != NULL) && (right.root != NULL) && (compareID(iterator::last(left.root)->getID(), iterator::first(right.root)->getID()) >= 0))
+		return false;
+
+	Node<T1, T2, S, L> *TL = left.root, *TR = right.root;
+	int n = left.size + right.size;
+	NodePool<Node<T1, T2, S, L> > Nodes;
+	NodePool<T2> Rcds;
+	Nodes.adopt(left.pool);
+	Nodes.adopt(right.pool);
+	Rcds.adopt(left.rcdPool);
+	Rcds.adopt(right.rcdPool);
+	left.root = right.root = NULL;
+	left.size = right.size = 0;
+
+	freeAll();
+	pool.swap(Nodes);
+	rcdPool.swap(Rcds);
+	root = joinTwo(TL, TR);
+	if (root != NULL)
+		root->setColor(0);
+	size = n;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: unionWith
+// DESCRIPTION: To add the nodes of "b" to this tree. The nodes are moved,
+//				not copied, and an ID in both trees keeps this tree's node and
+//				record. "b" is left empty.
+//   ARGUMENTS: RBTree<T1, T2, S, L, Compare, I> &b - the other tree
+//				int threads - the number of threads, 0 for all the cores
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::unionWith(RBTree<T1, T2, S, L, Compare, I> &b, int threads) {
+	return setOp(UNION, b, threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: intersect
+// DESCRIPTION: To keep only the nodes whose IDs are also in "b", with this
+//				tree's records. "b" is left empty.
+//   ARGUMENTS: RBTree<T1, T2, S, L, Compare, I> &b - the other tree
+//				int threads - the number of threads, 0 for all the cores
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::intersect(RBTree<T1, T2, S, L, Compare, I> &b, int threads) {
+	return setOp(INTERSECT, b, threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: difference
+// DESCRIPTION: To delete the nodes whose IDs are in "b". "b" is left empty.
+//   ARGUMENTS: RBTree<T1, T2, S, L, Compare, I> &b - the other tree
+//				int threads - the number of threads, 0 for all the cores
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::difference(RBTree<T1, T2, S, L, Compare, I> &b, int threads) {
+	return setOp(DIFFERENCE, b, threads);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: setOp
+// DESCRIPTION: The common part of unionWith, intersect and difference: the
+//				slabs of "b" are taken over, the two trees are merged by
+//				setOpAt, and the nodes left out are freed once all the
+//				threads are done.
+//   ARGUMENTS: SetOp op - UNION, INTERSECT or DIFFERENCE
+//				RBTree<T1, T2, S, L, Compare, I> &b - the other tree
+//				int threads - the number of threads, 0 for all the cores
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::setOp(SetOp op, RBTree<T1, T2, S, L, Compare, I> &b, int threads) {
+	if (&b == this) {	// A | A == A & A == A, A - A is empty
+		if (op == DIFFERENCE)
+			empty();
+		return true;
+	}
+	pool.adopt(b.pool);
+	rcdPool.adopt(b.rcdPool);
+	Node<T1, T2, S, L> *B = b.root;
+	int sizeB = b.size;
+	b.root = NULL;
+	b.size = 0;
+
+	int matches = 0;
+	vector<Node<T1, T2, S, L> *> Dead;
+	root = setOpAt(op, root, B, matches, Dead, batchForks(threads));
+	if (root != NULL) {
+		root->setFather(NULL);
+		root->setColor(0);
+	}
+	for (size_t i = 0; i < Dead.size(); i++)
+		releaseTree(Dead[i]);
+
+	if (op == UNION)
+		size += sizeB - matches;
+	else if (op == INTERSECT)
+		size = matches;
+	else
+		size -= matches;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: setOpAt
+// DESCRIPTION: To merge two subtrees: "B" is split at the ID of A's root, the
+//				halves are merged with A's subtrees, on two threads near the
+//				top, and joined back with or without A's root. It costs
+//				O(m log(n / m + 1)) for subtrees of m <= n nodes. Nodes left
+//				out are cut loose and put on "dead", to be freed later.
+//   ARGUMENTS: SetOp op - UNION, INTERSECT or DIFFERENCE
+//				Node<T1, T2, S, L> *A - the subtree of this tree, may be NULL
+//				Node<T1, T2, S, L> *B - the subtree of the other, may be NULL
+//				int &matches - increased by the number of IDs in both
+//				vector<Node<T1, T2, S, L> *> &dead - the nodes left out
+//				int forks - how many more levels fork a thread
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the root of the merged subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::setOpAt(SetOp op, Node<T1, T2, S, L> *A, Node<T1, T2, S, L> *B, int &matches, vector<Node<T1, T2, S, L> *> &dead, int forks) {
+	if ((A == NULL) || (B == NULL)) {
+		if ((B != NULL) && (op == UNION))
+			return B;
+		if (B != NULL)
+			dead.push_back(B);
+		if ((A != NULL) && (op == INTERSECT)) {
+			dead.push_back(A);
+			return NULL;
+		}
+		return A;
+	}
+
+	Node<T1, T2, S, L> *Lft = A->getLft(), *Rgt = A->getRgt(), *LB, *RB;
+	Node<T1, T2, S, L> *Mid = splitAt(B, A->getID(), LB, RB);
+	if ((forks > 0) && (blackHeight(A) >= 8)) {	// about 256 nodes or more
+		int matchesL = 0;
+		vector<Node<T1, T2, S, L> *> DeadL;
+		thread Left([&]() { Lft = setOpAt(op, Lft, LB, matchesL, DeadL, forks - 1); });
+		Rgt = setOpAt(op, Rgt, RB, matches, dead, forks - 1);
+		Left.join();
+		matches += matchesL;
+		dead.insert(dead.end(), DeadL.begin(), DeadL.end());
+	}
+	else {
+		Lft = setOpAt(op, Lft, LB, matches, dead, 0);
+		Rgt = setOpAt(op, Rgt, RB, matches, dead, 0);
+	}
+
+	if (Mid != NULL) {	// the ID is in both, the node of "B" goes
+		++matches;
+		Mid->AddLft((Node<T1, T2, S, L> *)NULL);
+		Mid->AddRgt((Node<T1, T2, S, L> *)NULL);
+		dead.push_back(Mid);
+	}
+	if ((op == UNION) || ((op == INTERSECT) == (Mid != NULL)))
+		return join(Lft, A, Rgt);
+	A->AddLft((Node<T1, T2, S, L> *)NULL);
+	A->AddRgt((Node<T1, T2, S, L> *)NULL);
+	dead.push_back(A);
+	return joinTwo(Lft, Rgt);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: releaseTree
+// DESCRIPTION: To give every node of a subtree cut loose from the tree back
+//				to the pool. A left son is rotated up until there is none,
+//				so no stack is taken however deep the subtree is.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the root of the subtree
+// USES GLOBAL: none
+// MODIFIES GL: pool, rcdPool
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+void RBTree<T1, T2, S, L, Compare, I>::releaseTree(Node<T1, T2, S, L> *node) {
+	while (node != NULL) {
+		Node<T1, T2, S, L> *Lft = node->getLft();
+		if (Lft != NULL) {
+			node->AddLft(Lft->getRgt());
+			Lft->AddRgt(node);
+			node = Lft;
+			continue;
+		}
+		Node<T1, T2, S, L> *Rgt = node->getRgt();
+		freeNode(node);
+		node = Rgt;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: batchForks
+// DESCRIPTION: How many levels of the batch recursion fork a thread, so that
+//				about "threads" threads work at once. None under a counting I,
+//				as its counters are plain and the forks would race on them.
+//   ARGUMENTS: int threads - the number of threads, 0 for all the cores
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int - the number of levels that fork
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+int RBTree<T1, T2, S, L, Compare, I>::batchForks(int threads) {
+	if (!is_same<I, NoStats>::value)
+		return 0;
+	if (threads <= 0)
+		threads = (int)thread::hardware_concurrency();
+	int forks = 0;
+	while ((1 << forks) < threads)
+		++forks;
+	return forks;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insertBatch
+// DESCRIPTION: To insert the items in [first, last), which are IDs or pairs of
+//				an ID and a record, in any order. The batch is sorted and its
+//				nodes are made up front, since the pool is not shared between
+//				threads. Then the batch is split at the ID of the root, the
+//				two halves go into the two subtrees, on two threads near the
+//				top, and the subtrees are joined back at the root. An empty
+//				subtree is built straight from its part of the batch. The
+//				work is O(m log(n / m + 1)) for m items into n nodes. IDs that
+//				are already in the tree, or repeated in the batch, keep their
+//				first node and record.
+//   ARGUMENTS: It first - the first item
+//				It last - one past the last item
+//				int threads - the number of threads, 0 for all the cores
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: int - the number of nodes inserted
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class It>
+int RBTree<T1, T2, S, L, Compare, I>::insertBatch(It first, It last, int threads) {
+	typedef typename iterator_traits<It>::value_type V;
+	typedef integral_constant<bool, is_convertible<V, T1>::value> IsID;
+	vector<V> Items(first, last);
+	stable_sort(Items.begin(), Items.end(), [this](const V &a, const V &b) { return sortedLess(a, b, IsID()); });
+	Items.erase(unique(Items.begin(), Items.end(), [this](const V &a, const V &b) { return !sortedLess(a, b, IsID()); }), Items.end());
+	int m = (int)Items.size();
+	if (m == 0)
+		return 0;
+
+	vector<Node<T1, T2, S, L> *> Batch(m);
+	vector<char> Used(m, 0);
+	for (int i = 0; i < m; i++)
+		Batch[i] = sortedNode(Items[i], IsID());
+	root = insertBatchAt(root, Batch.data(), m, Used.data(), batchForks(threads));
+	root->setFather(NULL);
+	root->setColor(0);
+
+	int inserted = 0;
+	for (int i = 0; i < m; i++)
+		if (Used[i])
+			++inserted;
+		else
+			freeNode(Batch[i]);
+	size += inserted;
+	return inserted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insertBatchAt
+// DESCRIPTION: To insert a sorted run of made nodes into a subtree.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the root of the subtree, may be NULL
+//				Node<T1, T2, S, L> **batch - the nodes, in increasing ID order
+//				int m - the number of nodes
+//				char *used - set for each node that goes into the tree
+//				int forks - how many more levels fork a thread
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the new root of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::insertBatchAt(Node<T1, T2, S, L> *node, Node<T1, T2, S, L> **batch, int m, char *used, int forks) {
+	if (m == 0)
+		return node;
+	if (node == NULL) {
+		for (int i = 0; i < m; i++)
+			used[i] = 1;
+		return linkSorted(batch, m, 0, redDepthOf(m));
+	}
+
+	// batch[0, lo) goes left, batch[hi, m) right, and batch[lo] is a repeat if lo < hi
+	int lo = 0, hi = m;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (compareID(batch[mid]->getID(), node->getID()) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	hi = ((lo < m) && (compareID(batch[lo]->getID(), node->getID()) == 0)) ? lo + 1 : lo;
+
+	Node<T1, T2, S, L> *Lft = node->getLft(), *Rgt = node->getRgt();
+	if ((forks > 0) && (m >= 1024)) {
+		thread Left([&]() { Lft = insertBatchAt(Lft, batch, lo, used, forks - 1); });
+		Rgt = insertBatchAt(Rgt, batch + hi, m - hi, used + hi, forks - 1);
+		Left.join();
+	}
+	else {
+		Lft = insertBatchAt(Lft, batch, lo, used, 0);
+		Rgt = insertBatchAt(Rgt, batch + hi, m - hi, used + hi, 0);
+	}
+	return join(Lft, node, Rgt);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: deleteBatch
+// DESCRIPTION: To delete the IDs in [first, last), in any order. The batch is
+//				sorted and split at the ID of the root as in insertBatch; a
+//				root that is in the batch is dropped and its two subtrees are
+//				joined without it. The nodes are given back to the pool only
+//				after all the threads are done.
+//   ARGUMENTS: It first - the first ID
+//				It last - one past the last ID
+//				int threads - the number of threads, 0 for all the cores
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: int - the number of nodes deleted
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class It>
+int RBTree<T1, T2, S, L, Compare, I>::deleteBatch(It first, It last, int threads) {
+	vector<T1> Keys(first, last);
+	sort(Keys.begin(), Keys.end(), [this](const T1 &a, const T1 &b) { return compareID(a, b) < 0; });
+	Keys.erase(unique(Keys.begin(), Keys.end(), [this](const T1 &a, const T1 &b) { return compareID(a, b) == 0; }), Keys.end());
+	int m = (int)Keys.size();
+	if ((m == 0) || (root == NULL))
+		return 0;
+
+	vector<Node<T1, T2, S, L> *> Dead(m, (Node<T1, T2, S, L> *)NULL);
+	root = deleteBatchAt(root, Keys.data(), m, Dead.data(), batchForks(threads));
+	if (root != NULL) {
+		root->setFather(NULL);
+		root->setColor(0);
+	}
+
+	int deleted = 0;
+	for (int i = 0; i < m; i++)
+		if (Dead[i] != NULL) {
+			freeNode(Dead[i]);
+			++deleted;
+		}
+	size -= deleted;
+	return deleted;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: deleteBatchAt
+// DESCRIPTION: To delete a sorted run of IDs from a subtree.
+//   ARGUMENTS: Node<T1, T2, S, L> *node - the root of the subtree, may be NULL
+//				const T1 *batch - the IDs, in increasing order
+//				int m - the number of IDs
+//				Node<T1, T2, S, L> **dead - set to the node of each ID found
+//				int forks - how many more levels fork a thread
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Node<T1, T2, S, L>* - the new root of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::deleteBatchAt(Node<T1, T2, S, L> *node, const T1 *batch, int m, Node<T1, T2, S, L> **dead, int forks) {
+	if ((m == 0) || (node == NULL))
+		return node;
+
+	int lo = 0, hi = m;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (compareID(batch[mid], node->getID()) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	bool found = (lo < m) && (compareID(batch[lo], node->getID()) == 0);
+	hi = found ? lo + 1 : lo;
+
+	Node<T1, T2, S, L> *Lft = node->getLft(), *Rgt = node->getRgt();
+	if ((forks > 0) && (m >= 1024)) {
+		thread Left([&]() { Lft = deleteBatchAt(Lft, batch, lo, dead, forks - 1); });
+		Rgt = deleteBatchAt(Rgt, batch + hi, m - hi, dead + hi, forks - 1);
+		Left.join();
+	}
+	else {
+		Lft = deleteBatchAt(Lft, batch, lo, dead, 0);
+		Rgt = deleteBatchAt(Rgt, batch + hi, m - hi, dead + hi, 0);
+	}
+	if (!found)
+		return join(Lft, node, Rgt);
+	dead[lo] = node;
+	return joinTwo(Lft, Rgt);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Insert
+// DESCRIPTION: Inserting a node into the RB tree.
+//   ARGUMENTS: const T1 &id - the id of the new node that is to be inserted
+// USES GLOBAL: none
+// MODIFIES GL: root (possible)
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-23
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::Insert(const T1 &id) {
+	insertNode(id, [this, &id]() { return newNode(id); });
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insertNode
+// DESCRIPTION: The top-down insertion: one descent that reorients on the way,
+//				compares once per level and, if "id" is not there yet, hangs
+//				the node built by "make" at the bottom. Nothing is built when
+//				the ID already exists.
+//   ARGUMENTS: const T1 &id - the ID to look for
+//				Make make - called with no arguments to build the new node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: pair<Node<T1, T2, S, L>*, bool> - the node with ID "id" and whether it is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class Make>
+pair<Node<T1, T2, S, L> *, bool> RBTree<T1, T2, S, L, Compare, I>::insertNode(const T1 &id, Make make) {
+	// find the right place to insert, one comparison per level
+	Cursor C;
+	C.X = root;
+	C.P = C.GP = C.GGP = NULL;
+	int dir = 0;
+	I::onOp(OpStats::INSERT);
+	while (C.X != NULL) {
+		I::onVisit(OpStats::INSERT);
+		dir = compareID(id, C.X->getID());
+		if (dir == 0)	// if the Node already exists
+			return pair<Node<T1, T2, S, L> *, bool>(C.X, false);
+		if (isRed(C.X->getLft()) && isRed(C.X->getRgt()))
+			iHandleReorient(C);
+		C.GGP = C.GP;
+		C.GP = C.P;
+		C.P = C.X;
+		C.X = (dir < 0) ? C.X->getLft() : C.X->getRgt();
+	}
+
+	// create a new Node and concatenate it on the tree
+	Node<T1, T2, S, L> *New = make();
+	C.X = New;
+	C.X->setColor(1);
+	++size;
+	if (C.P == NULL)
+		root = C.X;
+	else if (dir < 0)
+		C.P->AddLft(C.X);
+	else
+		C.P->AddRgt(C.X);
+	fixCounts(C.P);
+	if (isRed(C.P))
+		iHandleReorient(C);
+
+	root->setColor(0);
+	return pair<Node<T1, T2, S, L> *, bool>(New, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert
+// DESCRIPTION: To insert a node with a record. Nothing changes if the ID is
+//				already in the tree.
+//   ARGUMENTS: const T1 &id - the ID of the new node
+//				const T2 &rcd - the record of the new node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: pair<T2*, bool> - the record under "id" and whether it is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+pair<T2 *, bool> RBTree<T1, T2, S, L, Compare, I>::insert(const T1 &id, const T2 &rcd) {
+	return try_emplace(id, rcd);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert
+// DESCRIPTION: To insert a node with a record, moving both into the node. Nothing
+//				is moved if the ID is already in the tree.
+//   ARGUMENTS: T1 &&id - the ID of the new node
+//				T2 &&rcd - the record of the new node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: pair<T2*, bool> - the record under "id" and whether it is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+pair<T2 *, bool> RBTree<T1, T2, S, L, Compare, I>::insert(T1 &&id, T2 &&rcd) {
+	return try_emplace(std::move(id), std::move(rcd));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: emplace
+// DESCRIPTION: To build a node from its arguments and insert it, as std::map does:
+//				the ID has to be built before it can be looked for, so the node
+//				is thrown away again if the ID is already in the tree.
+//   ARGUMENTS: K &&id - what the ID is built from
+//				Args &&...args - what the record is built from
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: pair<T2*, bool> - the record under the ID and whether it is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class K, class... Args>
+pair<T2 *, bool> RBTree<T1, T2, S, L, Compare, I>::emplace(K &&id, Args &&...args) {
+	Node<T1, T2, S, L> *New = emplaceNode(std::forward<K>(id), std::forward<Args>(args)...);
+	pair<Node<T1, T2, S, L> *, bool> Res;
+	try {
+		Res = insertNode(New->getID(), [New]() { return New; });
+	}
+	catch (...) {
+		freeNode(New);
+		throw;
+	}
+	if (!Res.second)
+		freeNode(New);
+	return pair<T2 *, bool>(Res.first->getRcd(), Res.second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: try_emplace
+// DESCRIPTION: To insert a node whose record is built from "args" in place. If
+//				the ID is already in the tree nothing is built and "args" are
+//				left untouched.
+//   ARGUMENTS: const T1 &id - the ID of the new node
+//				Args &&...args - what the record is built from
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: pair<T2*, bool> - the record under "id" and whether it is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class... Args>
+pair<T2 *, bool> RBTree<T1, T2, S, L, Compare, I>::try_emplace(const T1 &id, Args &&...args) {
+	pair<Node<T1, T2, S, L> *, bool> Res = insertNode(id, [&]() { return emplaceNode(id, std::forward<Args>(args)...); });
+	return pair<T2 *, bool>(Res.first->getRcd(), Res.second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: try_emplace
+// DESCRIPTION: As above, with the ID moved into the new node.
+//   ARGUMENTS: T1 &&id - the ID of the new node
+//				Args &&...args - what the record is built from
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: pair<T2*, bool> - the record under "id" and whether it is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class... Args>
+pair<T2 *, bool> RBTree<T1, T2, S, L, Compare, I>::try_emplace(T1 &&id, Args &&...args) {
+	pair<Node<T1, T2, S, L> *, bool> Res = insertNode(id, [&]() { return emplaceNode(std::move(id), std::forward<Args>(args)...); });
+	return pair<T2 *, bool>(Res.first->getRcd(), Res.second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert_or_assign
+// DESCRIPTION: To insert a node with a record, or to assign the record if the ID
+//				is already in the tree. Either way it takes one descent.
+//   ARGUMENTS: const T1 &id - the ID of the node
+//				R &&rcd - the record, moved if it is an rvalue
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size, the record under "id"
+//     RETURNS: pair<T2*, bool> - the record under "id" and whether it is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class R>
+pair<T2 *, bool> RBTree<T1, T2, S, L, Compare, I>::insert_or_assign(const T1 &id, R &&rcd) {
+	pair<T2 *, bool> Res = try_emplace(id, std::forward<R>(rcd));
+	if (!Res.second)
+		*Res.first = std::forward<R>(rcd);
+	return Res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert_or_assign
+// DESCRIPTION: As above, with the ID moved into the node if it is new.
+//   ARGUMENTS: T1 &&id - the ID of the node
+//				R &&rcd - the record, moved if it is an rvalue
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size, the record under "id"
+//     RETURNS: pair<T2*, bool> - the record under "id" and whether it is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class R>
+pair<T2 *, bool> RBTree<T1, T2, S, L, Compare, I>::insert_or_assign(T1 &&id, R &&rcd) {
+	pair<T2 *, bool> Res = try_emplace(std::move(id), std::forward<R>(rcd));
+	if (!Res.second)
+		*Res.first = std::forward<R>(rcd);
+	return Res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: dHandleReorient
+// DESCRIPTION: handle the reorientation including recoloring and rotation for deletion.
+//				X is black, and so is its son on the way down; X leaves red.
+//   ARGUMENTS: Cursor &C - where the descent is
+//				int dir - indicate the direction X is moving towards (-1 left, 1 right)
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), C
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-26
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::dHandleReorient(Cursor &C, int dir) {
+	Node<T1, T2, S, L> *Top;
+
+	// case 2B: the other son of X is red, turn it into X's father
+	if (isRed(dir < 0 ? C.X->getRgt() : C.X->getLft())) {
+		I::onCase(OpStats::DEL_2B);
+		Top = (dir < 0) ? iRotateRR(C.X) : iRotateLL(C.X);
+		relink(C.P, C.X, Top);
+		C.GP = C.P;
+		C.P = Top;
+		C.T = (dir < 0) ? Top->getRgt() : Top->getLft();
+		return true;
+	}
+
+	// X is the root
+	if (C.T == NULL) {
+		I::onCase(OpStats::DEL_ROOT);
+		return true;
+	}
+
+	// case 2A1: both sons of T are black, flip the colors
+	if (!isRed(C.T->getLft()) && !isRed(C.T->getRgt())) {
+		I::onCase(OpStats::DEL_2A1);
+		I::onRecolor(3);
+		C.P->setColor(0);
+		C.X->setColor(1);
+		C.T->setColor(1);
+		return true;
+	}
+
+	// case 2A2 and 2A3: T has a red son, rotate at P
+	bool outer = isRed((C.P->getLft() == C.X) ? C.T->getRgt() : C.T->getLft());
+	I::onCase(outer ? OpStats::DEL_2A_OUTER : OpStats::DEL_2A_INNER);
+	if (C.P->getLft() == C.X)	// T is on the right
+		Top = outer ? dRotateRR(C.P) : dRotateRL(C.P);
+	else	// T is on the left
+		Top = outer ? dRotateLL(C.P) : dRotateLR(C.P);
+	relink(C.GP, C.P, Top);
+	C.X->setColor(1);
+	I::onRecolor(1);
+	C.GP = Top;
+	C.T = (C.P->getLft() == C.X) ? C.P->getRgt() : C.P->getLft();
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: deleteKey
+// DESCRIPTION: Deleting a node from the RB tree. The descent keeps the current
+//				node red, so the node that is finally cut off (the target or its
+//				in-order predecessor) is red or the root. A predecessor cut off
+//				is hung in the target's place, so no other node changes its ID or
+//				record, and iterators to them stay valid.
+//   ARGUMENTS: const K &id - the id of the node that is to be deleted, a T1 or
+//				a key that a transparent Compare takes in its place
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-27
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class K>
+bool RBTree<T1, T2, S, L, Compare, I>::deleteKey(const K &id) {
+	int dir = 0;
+	Cursor C;
+	Node<T1, T2, S, L> *dp = NULL; // pointer to the target node
+	Node<T1, T2, S, L> *Son;
+
+	if (root == NULL)
+		return true;
+
+	// find the Node, then its in-order predecessor
+	C.X = root;
+	C.T = C.P = C.GP = NULL;
+	I::onOp(OpStats::DELETE);
+	while (true) {
+		I::onVisit(OpStats::DELETE);
+		if (dp == NULL) {
+			dir = compareID(id, C.X->getID());
+			if (dir == 0) {
+				dp = C.X;
+				dir = -1;
+			}
+		}
+		else
+			dir = 1;
+		dir = (dir < 0) ? -1 : 1;
+
+		// reorientation
+		if (!isRed(C.X) && !isRed(dir < 0 ? C.X->getLft() : C.X->getRgt()))
+			dHandleReorient(C, dir);
+
+		Son = (dir < 0) ? C.X->getLft() : C.X->getRgt();
+		if (Son == NULL)
+			break;
+		C.GP = C.P;
+		C.P = C.X;
+		C.X = Son;
+		C.T = (dir < 0) ? C.P->getRgt() : C.P->getLft();
+	}
+
+	// delete
+	if (dp != NULL) {
+		relink(C.P, C.X, (C.X->getLft() != NULL) ? C.X->getLft() : C.X->getRgt());
+		fixCounts(C.P);
+		if (dp != C.X) {	// the predecessor takes the place of the target, nothing is copied
+			C.X->setColor(dp->getColor());
+			C.X->AddLft(dp->getLft());
+			C.X->AddRgt(dp->getRgt());
+			relink(dp->getFather(), dp, C.X);
+		}
+		freeNode(dp);
+		C.X = NULL;
+		--size;
+	}
+
+	if (root != NULL)
+		root->setColor(0);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: lowerKey
+// DESCRIPTION: To find the first node whose ID is not less than "id", for
+//				lower_bound.
+//   ARGUMENTS: const K &id - the ID to look for, a T1 or a key that a
+//				transparent Compare takes in its place
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: const Node<T1, T2, S, L>* - NULL if every ID is less than "id"
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class K>
+const Node<T1, T2, S, L> *RBTree<T1, T2, S, L, Compare, I>::lowerKey(const K &id) const {
+	const Node<T1, T2, S, L> *X = root, *Res = NULL;
+	while (X != NULL) {
+		if (compareID(id, X->getID()) <= 0) {
+			Res = X;
+			X = X->getLft();
+		}
+		else
+			X = X->getRgt();
+	}
+	return Res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: upper_bound
+// DESCRIPTION: To find the first node whose ID is greater than "id".
+//   ARGUMENTS: const T1 &id - the ID to look for
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: iterator - end() if no ID is greater than "id"
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+typename RBTree<T1, T2, S, L, Compare, I>::iterator RBTree<T1, T2, S, L, Compare, I>::upper_bound(const T1 &id) const {
+	const Node<T1, T2, S, L> *X = root, *Res = NULL;
+	while (X != NULL) {
+		if (compareID(id, X->getID()) < 0) {
+			Res = X;
+			X = X->getLft();
+		}
+		else
+			X = X->getRgt();
+	}
+	return iterator(this, Res);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: equal_range
+// DESCRIPTION: To find the nodes whose ID equals "id", as [lower_bound, upper_bound).
+//				The IDs are unique, so the range holds at most one node and one
+//				descent is enough.
+//   ARGUMENTS: const T1 &id - the ID to look for
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: pair<iterator, iterator>
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+pair<typename RBTree<T1, T2, S, L, Compare, I>::iterator, typename RBTree<T1, T2, S, L, Compare, I>::iterator> RBTree<T1, T2, S, L, Compare, I>::equal_range(const T1 &id) const {
+	const Node<T1, T2, S, L> *X = root, *Upper = NULL;
+	int dir;
+	while (X != NULL) {
+		dir = compareID(id, X->getID());
+		if (dir == 0)
+			return pair<iterator, iterator>(iterator(this, X), iterator(this, iterator::next(X)));
+		if (dir < 0) {
+			Upper = X;
+			X = X->getLft();
+		}
+		else
+			X = X->getRgt();
+	}
+	return pair<iterator, iterator>(iterator(this, Upper), iterator(this, Upper));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: forEachInRange
+// DESCRIPTION: To call "visitor" on every node with lo <= ID < hi, in ID order.
+//				The descent to lo skips every subtree left of the range and the
+//				walk stops at the first ID not less than hi, so it costs
+//				O(log n + k) for k nodes in range.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor visitor - called as visitor(const T1 &id, T2 &rcd), returns
+//				false to stop
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - true if the whole range was visited, false if stopped
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+template<class Visitor>
+bool RBTree<T1, T2, S, L, Compare, I>::forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const {
+	for (iterator it = lower_bound(lo); (it != end()) && (compareID(it->getID(), hi) < 0); ++it)
+		if (!visitor(it->getID(), *it->getRcd()))
+			return false;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: countInRange
+// DESCRIPTION: To count the nodes with lo <= ID < hi, in O(log n + k).
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+int RBTree<T1, T2, S, L, Compare, I>::countInRange(const T1 &lo, const T1 &hi) const {
+	int cnt = 0;
+	for (iterator it = lower_bound(lo); (it != end()) && (compareID(it->getID(), hi) < 0); ++it)
+		++cnt;
+	return cnt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: select
+// DESCRIPTION: To find the node with the k-th smallest ID, counting from 0, in
+//				O(log n). It needs the subtree counts of Counted<L> links.
+//   ARGUMENTS: int k - how many IDs are to be smaller than the one found
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: iterator - end() if k is out of [0, size)
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+typename RBTree<T1, T2, S, L, Compare, I>::iterator RBTree<T1, T2, S, L, Compare, I>::select(int k) const {
+	static_assert(Node<T1, T2, S, L>::counted, "select needs Counted<L> links");
+	if ((k < 0) || (k >= size))
+		return end();
+	const Node<T1, T2, S, L> *X = root;
+	while (X != NULL) {
+		int lftCnt = calcSize(X->getLft());
+		if (k < lftCnt)
+			X = X->getLft();
+		else if (k == lftCnt)
+			break;
+		else {
+			k -= lftCnt + 1;
+			X = X->getRgt();
+		}
+	}
+	return iterator(this, X);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rank
+// DESCRIPTION: To count the IDs smaller than "id", in O(log n), whether "id" is in
+//				the tree or not. It needs the subtree counts of Counted<L> links.
+//   ARGUMENTS: const T1 &id - the ID to rank
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+int RBTree<T1, T2, S, L, Compare, I>::rank(const T1 &id) const {
+	static_assert(Node<T1, T2, S, L>::counted, "rank needs Counted<L> links");
+	const Node<T1, T2, S, L> *X = root;
+	int res = 0, dir;
+	while (X != NULL) {
+		dir = compareID(id, X->getID());
+		if (dir == 0)
+			return res + calcSize(X->getLft());
+		if (dir < 0)
+			X = X->getLft();
+		else {
+			res += calcSize(X->getLft()) + 1;
+			X = X->getRgt();
+		}
+	}
+	return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: countRange
+// DESCRIPTION: To count the nodes with lo <= ID < hi, in O(log n) whatever the
+//				width of the range. It needs the subtree counts of Counted<L> links.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+int RBTree<T1, T2, S, L, Compare, I>::countRange(const T1 &lo, const T1 &hi) const {
+	if (compareID(lo, hi) >= 0)
+		return 0;
+	return rank(hi) - rank(lo);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: print
+// DESCRIPTION: print a tree with inorder traversal.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2015-02-11
+//							KC 2015-02-11
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::print() const {
+	if (root != NULL) {
+		root->print();
+		return true;
+	}
+	else
+		return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: shape
+// DESCRIPTION: To measure the shape of the tree: how many nodes are at each
+//				depth, the height, the black height and the average length
+//				of a path from the root. The walk is preorder through the
+//				fathers, so it needs no stack however deep the tree is.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: TreeShape
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+TreeShape RBTree<T1, T2, S, L, Compare, I>::shape() const {
+	TreeShape Shape;
+	Shape.size = size;
+	Shape.blackHeight = 0;
+	for (const Node<T1, T2, S, L> *X = root; X != NULL; X = X->getLft())
+		Shape.blackHeight += (X->getColor() == 0);
+
+	long long paths = 0;
+	int depth = 0;
+	const Node<T1, T2, S, L> *X = root, *F;
+	while (X != NULL) {
+		if ((int)Shape.depths.size() <= depth)
+			Shape.depths.push_back(0);
+		Shape.depths[depth]++;
+		paths += depth + 1;
+		if ((X->getLft() != NULL) || (X->getRgt() != NULL)) {	// down to the first son
+			X = (X->getLft() != NULL) ? X->getLft() : X->getRgt();
+			depth++;
+			continue;
+		}
+		// up to the first father we are left of that has a right son, then over to it
+		while (((F = X->getFather()) != NULL) && ((F->getRgt() == X) || (F->getRgt() == NULL))) {
+			X = F;
+			depth--;
+		}
+		X = (F == NULL) ? NULL : F->getRgt();
+	}
+	Shape.height = (int)Shape.depths.size();
+	Shape.avgPath = (size > 0) ? (double)paths / size : 0;
+	return Shape;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: savedHead
+// DESCRIPTION: The head of a saved file of this type of tree.
+//   ARGUMENTS: uint64_t cnt - the number of items in the file
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: SavedHead
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+typename RBTree<T1, T2, S, L, Compare, I>::SavedHead RBTree<T1, T2, S, L, Compare, I>::savedHead(uint64_t cnt) {
+	SavedHead Head;
+	memcpy(Head.magic, "RBTB", 4);
+	Head.version = savedVersion;
+	Head.idSize = sizeof(T1);
+	Head.rcdSize = is_empty<T2>::value ? 0 : sizeof(T2);
+	Head.cnt = cnt;
+	return Head;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: save
+// DESCRIPTION: To write the tree to a binary file: a head with the version
+//				and the number of items, then each ID and its record in ID
+//				order. Each is written by Serializer<T>, as its bytes unless
+//				Serializer has been specialized for the type. The numbers
+//				are written in the byte order of the machine.
+//   ARGUMENTS: const string &path - the file, replaced if it is there
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if the file could not be written
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::save(const string &path) const {
+	BinaryOut Out(path);
+	SavedHead Head = savedHead(size);
+	bool good = Out.put(&Head, sizeof(Head));
+	for (iterator it = begin(); good && (it != end()); ++it) {
+		good = Serializer<T1>::save(Out, it->getID());
+		if (good && !is_empty<T2>::value)
+			good = Serializer<T2>::save(Out, *it->getRcd());
+	}
+	return Out.close() && good;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: load
+// DESCRIPTION: To replace the whole tree with the items of a file written by
+//				save. The file is read once, front to back through a buffer,
+//				and the tree is built as in buildFromSorted: O(n), with no
+//				rotation, and the items are moved into their nodes. T1 and T2
+//				need a default constructor to be read into.
+//   ARGUMENTS: const string &path - the file
+// USES GLOBAL: none
+// MODIFIES GL: root, size, pool, rcdPool
+//     RETURNS: bool - false, with the tree left empty, if the file could not
+//				be read, is not of this type of tree, is not in ID order or
+//				is shorter than its head says
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class I>
+bool RBTree<T1, T2, S, L, Compare, I>::load(const string &path) {
+	freeAll();
+	size = 0;
+
+	// check the head
+	BinaryIn In(path);
+	SavedHead Head, Want = savedHead(0);
+	if (!In.get(&Head, sizeof(Head)) || (memcmp(Head.magic, Want.magic, 4) != 0) || (Head.version != Want.version)
+		|| (Head.idSize != Want.idSize) || (Head.rcdSize != Want.rcdSize) || (Head.cnt > (uint64_t)INT_MAX))
+		return false;
+	int n = (int)Head.cnt;
+	if (n == 0)
+		return true;
+
+	// each item takes at least its smallest serialized size, and at least a byte as the IDs all differ,
+	// so a count the rest of the file is too short for is refused before anything is made
+	uint64_t Least = SavedSize<T1>::least() + (is_empty<T2>::value ? 0 : SavedSize<T2>::least());
+	if (Head.cnt > In.remaining() / max(Least, (uint64_t)1))
+		return false;
+
+	// build the tree straight from the file
+	pool.reserve(n);
+	if (RcdStore<T2, S>::cold)
+		rcdPool.reserve(n);
+	move_iterator<Loader> it = make_move_iterator(Loader(this, In, n));
+	root = buildSorted(it, n, 0, redDepthOf(n), integral_constant<bool, is_empty<T2>::value>());
+	size = n;
+
+	// a short or broken file, or one saved with another order, is thrown away
+	if (!it.base().isGood()) {
+		freeAll();
+		size = 0;
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////Concurrent Red-Black Tree//////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class T1, class T2 = NULLT, class S = RcdInline, class L = PlainLinks, class Compare = CmpPtr<T1> >
+class ConcurrentRBTree {	// an RBTree behind a reader-writer lock: finds share it, Insert and Delete own it
+private :
+	RBTree<T1, T2, S, L, Compare> tree;
+	mutable shared_mutex lock;
+
+	ConcurrentRBTree(const ConcurrentRBTree<T1, T2, S, L, Compare> &b);
+	ConcurrentRBTree<T1, T2, S, L, Compare> &operator=(const ConcurrentRBTree<T1, T2, S, L, Compare> &b);
+public :
+	ConcurrentRBTree() {}
+	ConcurrentRBTree(const Compare &compare) : tree(compare) {}
+
+	bool Insert(const T1 &id);
+	bool insert(const T1 &id, const T2 &rcd);
+	bool insert_or_assign(const T1 &id, const T2 &rcd);
+	bool Delete(const T1 &id);
+	bool empty();
+
+	int getSize() const;
+	bool contains(const T1 &id) const;
+	bool find(const T1 &id, T2 &rcd) const;
+	template<class Visitor>
+	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+	int countInRange(const T1 &lo, const T1 &hi) const;
+
+	// as in RBTree, by any key that a transparent Compare takes in place of a T1
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool Delete(const K &key);
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool contains(const K &key) const;
+	template<class K, class C = Compare, class = typename C::is_transparent>
+	bool find(const K &key, T2 &rcd) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Insert
+// DESCRIPTION: Inserting a node into the tree, with the lock held exclusively.
+//   ARGUMENTS: const T1 &id - the id of the new node that is to be inserted
+// USES GLOBAL: none
+// MODIFIES GL: tree
+//     RETURNS: bool - false if the ID is already in the tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::Insert(const T1 &id) {
+	unique_lock<shared_mutex> guard(lock);
+	int Before = tree.getSize();
+	tree.Insert(id);
+	return tree.getSize() != Before;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert
+// DESCRIPTION: Inserting a node with its record, with the lock held
+//				exclusively. An existing record is left as it is.
+//   ARGUMENTS: const T1 &id - the id of the new node
+//				const T2 &rcd - its record
+// USES GLOBAL: none
+// MODIFIES GL: tree
+//     RETURNS: bool - whether the node is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::insert(const T1 &id, const T2 &rcd) {
+	unique_lock<shared_mutex> guard(lock);
+	return tree.insert(id, rcd).second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert_or_assign
+// DESCRIPTION: Inserting a node with its record, or setting the record of the
+//				node that has the ID, with the lock held exclusively.
+//   ARGUMENTS: const T1 &id - the id of the node
+//				const T2 &rcd - its record
+// USES GLOBAL: none
+// MODIFIES GL: tree
+//     RETURNS: bool - true if a node was inserted, false if one was set
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::insert_or_assign(const T1 &id, const T2 &rcd) {
+	unique_lock<shared_mutex> guard(lock);
+	return tree.insert_or_assign(id, rcd).second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Delete
+// DESCRIPTION: Deleting a node from the tree, with the lock held exclusively.
+//   ARGUMENTS: const T1 &id - the id of the node that is to be deleted
+// USES GLOBAL: none
+// MODIFIES GL: tree
+//     RETURNS: bool - false if the ID is not in the tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::Delete(const T1 &id) {
+	unique_lock<shared_mutex> guard(lock);
+	int Before = tree.getSize();
+	tree.Delete(id);
+	return tree.getSize() != Before;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: empty
+// DESCRIPTION: To delete all the nodes, with the lock held exclusively.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: tree
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::empty() {
+	unique_lock<shared_mutex> guard(lock);
+	return tree.empty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: getSize
+// DESCRIPTION: To get the number of nodes, with the lock shared.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+int ConcurrentRBTree<T1, T2, S, L, Compare>::getSize() const {
+	shared_lock<shared_mutex> guard(lock);
+	return tree.getSize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: contains
+// DESCRIPTION: To tell whether a node of a certain ID is in the tree, with the
+//				lock shared.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::contains(const T1 &id) const {
+	shared_lock<shared_mutex> guard(lock);
+	return tree.find(id) != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: find
+// DESCRIPTION: To copy out the record of a node of a certain ID, with the lock
+//				shared. The record is copied before the lock is let go, as a
+//				pointer into the tree may be freed by the next Delete.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+//				T2 &rcd - where the record is copied to
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::find(const T1 &id, T2 &rcd) const {
+	shared_lock<shared_mutex> guard(lock);
+	const T2 *Tmp = tree.find(id);
+	if (Tmp == NULL)
+		return false;
+	rcd = *Tmp;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Delete
+// DESCRIPTION: Deleting the node of a key that is not a T1, with the lock held
+//				exclusively.
+//   ARGUMENTS: const K &key - a key that the transparent Compare takes in
+//				place of the ID of the node that is to be deleted
+// USES GLOBAL: none
+// MODIFIES GL: tree
+//     RETURNS: bool - false if the key is not in the tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+template<class K, class C, class>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::Delete(const K &key) {
+	unique_lock<shared_mutex> guard(lock);
+	int Before = tree.getSize();
+	tree.Delete(key);
+	return tree.getSize() != Before;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: contains
+// DESCRIPTION: To tell whether the node of a key that is not a T1 is in the
+//				tree, with the lock shared.
+//   ARGUMENTS: const K &key - a key that the transparent Compare takes in
+//				place of the ID of the node that we want to find
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+template<class K, class C, class>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::contains(const K &key) const {
+	shared_lock<shared_mutex> guard(lock);
+	return tree.contains(key);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: find
+// DESCRIPTION: To copy out the record of the node of a key that is not a T1,
+//				with the lock shared.
+//   ARGUMENTS: const K &key - a key that the transparent Compare takes in
+//				place of the ID of the node that we want to find
+//				T2 &rcd - where the record is copied to
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if not found
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+template<class K, class C, class>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::find(const K &key, T2 &rcd) const {
+	shared_lock<shared_mutex> guard(lock);
+	const T2 *Tmp = tree.find(key);
+	if (Tmp == NULL)
+		return false;
+	rcd = *Tmp;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: forEachInRange
+// DESCRIPTION: To call "visitor" on every node with lo <= ID < hi, with the lock
+//				shared. The visitor must not call back into the tree.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor visitor - called as visitor(const T1 &id, T2 &rcd), returns
+//				false to stop
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - true if the whole range was visited, false if stopped
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+template<class Visitor>
+bool ConcurrentRBTree<T1, T2, S, L, Compare>::forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const {
+	shared_lock<shared_mutex> guard(lock);
+	return tree.forEachInRange(lo, hi, visitor);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: countInRange
+// DESCRIPTION: To count the nodes with lo <= ID < hi, with the lock shared.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+int ConcurrentRBTree<T1, T2, S, L, Compare>::countInRange(const T1 &lo, const T1 &hi) const {
+	shared_lock<shared_mutex> guard(lock);
+	return tree.countInRange(lo, hi);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////////Persistent Red-Black Tree//////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+template<class T1, class T2 = NULLT, class Compare = CmpPtr<T1> >
+class PersistentRBTree {	// versions that share their nodes: a copy is O(1), a change copies one path
+private :
+	class PNode;
+	class Link {	// a counted reference to a node, the last one frees it
+	public:
+		Link() : p(NULL) {}
+		explicit Link(PNode *node) : p(node) {}	// takes over a new node
+		Link(const Link &b) : p(b.p) { if (p != NULL) p->refs.fetch_add(1, memory_order_relaxed); }
+		Link(Link &&b) : p(b.p) { b.p = NULL; }
+		~Link() { if ((p != NULL) && (p->refs.fetch_sub(1, memory_order_acq_rel) == 1)) delete p; }
+		Link &operator=(Link b) { std::swap(p, b.p); return *this; }
+		const PNode *operator->() const { return p; }
+		const PNode *get() const { return p; }
+	private:
+		PNode *p;
+	};
+	class PNode {	// never changed once made, so any number of versions and threads may share it
+	public:
+		PNode(const T1 &id, const T2 &rcd, int c, const Link &l, const Link &r) : ID(id), Rcd(rcd), Lft(l), Rgt(r), refs(1), color((char)c) {}
+		const T1 ID;
+		const T2 Rcd;
+		const Link Lft, Rgt;
+		atomic<int> refs;	// the Links to this node
+		const char color;	// 0 for black, 1 for red
+	};
+
+	Link root;
+	int size;
+	int bh;	// the black height of the root
+	Compare cmp;
+
+	int compareID(const T1 &a, const T1 &b) const { return CmpTraits<Compare, T1>::threeWay(cmp, a, b); }
+	static bool isRed(const Link &node) { return (node.get() != NULL) && (node->color == 1); }
+	static Link make(const T1 &id, const T2 &rcd, int color, const Link &lft, const Link &rgt);
+	static Link join(Link TL, int bhL, const PNode *K, Link TR, int bhR, int &bhX);
+	static Link joinRight(const Link &TL, int bhL, const PNode *K, const Link &TR, int bhR);
+	static Link joinLeft(const Link &TL, int bhL, const PNode *K, const Link &TR, int bhR);
+	static Link joinTwo(const Link &TL, int bhL, const Link &TR, int bhR, int &bhX);
+	static Link splitLast(const Link &node, int bhN, Link &last, int &bhX);
+	static Link balance(const PNode *K, const Link &lft, const Link &rgt);
+	Link insertAt(const Link &node, const T1 &id, const T2 &rcd, bool &done) const;
+	Link deleteAt(const Link &node, int bhN, const T1 &id, bool &done, int &bhX) const;
+	template<class Visitor>
+	bool visitRange(const PNode *node, const T1 &lo, const T1 &hi, Visitor &visitor) const;
+public :
+	PersistentRBTree() : size(0), bh(0) {}
+	PersistentRBTree(const Compare &compare) : size(0), bh(0), cmp(compare) {}
+
+	PersistentRBTree<T1, T2, Compare> snapshot() const { return *this; }	// the copy constructor shares the nodes too
+	bool Insert(const T1 &id);
+	bool insert(const T1 &id, const T2 &rcd);
+	bool Delete(const T1 &id);
+	bool empty();
+
+	int getSize() const { return size; }
+	const T2 *find(const T1 &id) const;
+	template<class Visitor>
+	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: make
+// DESCRIPTION: To make a new node with a count of 1.
+//   ARGUMENTS: const T1 &id - the ID of the node
+//				const T2 &rcd - the record of the node
+//				int color - 0 for black, 1 for red
+//				const Link &lft - the left son
+//				const Link &rgt - the right son
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::make(const T1 &id, const T2 &rcd, int color, const Link &lft, const Link &rgt) {
+	PNode *Tmp = new (std::nothrow) PNode(id, rcd, color, lft, rgt);
+	if (Tmp == NULL)
+		throw NodeERR("Out of space");
+	return Link(Tmp);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: join
+// DESCRIPTION: As RBTree::join, but the nodes on the way are copied instead of
+//				changed, and the black heights are passed along instead of
+//				counted, so that a change costs O(log n) in all.
+//   ARGUMENTS: Link TL - the left subtree
+//				int bhL - the black height of "TL"
+//				const PNode *K - the ID and record of the middle node
+//				Link TR - the right subtree
+//				int bhR - the black height of "TR"
+//				int &bhX - set to the black height of the result
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link - the root of the joined subtree, maybe red
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::join(Link TL, int bhL, const PNode *K, Link TR, int bhR, int &bhX) {
+	if (isRed(TL)) {
+		TL = make(TL->ID, TL->Rcd, 0, TL->Lft, TL->Rgt);
+		++bhL;
+	}
+	if (isRed(TR)) {
+		TR = make(TR->ID, TR->Rcd, 0, TR->Lft, TR->Rgt);
+		++bhR;
+	}
+	Link X;
+	if (bhL > bhR) {
+		X = joinRight(TL, bhL, K, TR, bhR);
+		bhX = bhL;
+		if (isRed(X) && isRed(X->Rgt)) {
+			X = make(X->ID, X->Rcd, 0, X->Lft, X->Rgt);
+			++bhX;
+		}
+	}
+	else if (bhL < bhR) {
+		X = joinLeft(TL, bhL, K, TR, bhR);
+		bhX = bhR;
+		if (isRed(X) && isRed(X->Lft)) {
+			X = make(X->ID, X->Rcd, 0, X->Lft, X->Rgt);
+			++bhX;
+		}
+	}
+	else {
+		X = make(K->ID, K->Rcd, 1, TL, TR);
+		bhX = bhL;
+	}
+	return X;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: joinRight
+// DESCRIPTION: As RBTree::joinRight, copying the right spine of "TL".
+//   ARGUMENTS: const Link &TL - the left subtree
+//				int bhL - the black height of "TL"
+//				const PNode *K - the ID and record of the middle node
+//				const Link &TR - the right subtree, with a black root
+//				int bhR - the black height of "TR"
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link - the new root of "TL"
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::joinRight(const Link &TL, int bhL, const PNode *K, const Link &TR, int bhR) {
+	if (!isRed(TL) && (bhL == bhR))
+		return make(K->ID, K->Rcd, 1, TL, TR);
+	Link X = joinRight(TL->Rgt, bhL - (isRed(TL) ? 0 : 1), K, TR, bhR);
+	if (!isRed(TL) && isRed(X) && isRed(X->Rgt))	// rotate left, the red grandson turns black
+		return make(X->ID, X->Rcd, X->color, make(TL->ID, TL->Rcd, TL->color, TL->Lft, X->Lft),
+			make(X->Rgt->ID, X->Rgt->Rcd, 0, X->Rgt->Lft, X->Rgt->Rgt));
+	return make(TL->ID, TL->Rcd, TL->color, TL->Lft, X);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: joinLeft
+// DESCRIPTION: The mirror of joinRight, for a taller "TR".
+//   ARGUMENTS: const Link &TL - the left subtree, with a black root
+//				int bhL - the black height of "TL"
+//				const PNode *K - the ID and record of the middle node
+//				const Link &TR - the right subtree
+//				int bhR - the black height of "TR"
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link - the new root of "TR"
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::joinLeft(const Link &TL, int bhL, const PNode *K, const Link &TR, int bhR) {
+	if (!isRed(TR) && (bhL == bhR))
+		return make(K->ID, K->Rcd, 1, TL, TR);
+	Link X = joinLeft(TL, bhL, K, TR->Lft, bhR - (isRed(TR) ? 0 : 1));
+	if (!isRed(TR) && isRed(X) && isRed(X->Lft))	// rotate right, the red grandson turns black
+		return make(X->ID, X->Rcd, X->color, make(X->Lft->ID, X->Lft->Rcd, 0, X->Lft->Lft, X->Lft->Rgt),
+			make(TR->ID, TR->Rcd, TR->color, X->Rgt, TR->Rgt));
+	return make(TR->ID, TR->Rcd, TR->color, X, TR->Rgt);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: joinTwo
+// DESCRIPTION: To join two subtrees with no node between them, the last node
+//				of "TL" standing in for one.
+//   ARGUMENTS: const Link &TL - the left subtree
+//				int bhL - the black height of "TL"
+//				const Link &TR - the right subtree
+//				int bhR - the black height of "TR"
+//				int &bhX - set to the black height of the result
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link - the root of the joined subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::joinTwo(const Link &TL, int bhL, const Link &TR, int bhR, int &bhX) {
+	if (TL.get() == NULL) {
+		bhX = bhR;
+		return TR;
+	}
+	Link Last;
+	int bhRest;
+	Link Rest = splitLast(TL, bhL, Last, bhRest);
+	return join(Rest, bhRest, Last.get(), TR, bhR, bhX);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: splitLast
+// DESCRIPTION: To copy a subtree without its last node.
+//   ARGUMENTS: const Link &node - the root of the subtree, not NULL
+//				int bhN - the black height of "node"
+//				Link &last - set to the last node
+//				int &bhX - set to the black height of the rest
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link - the root of the rest
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::splitLast(const Link &node, int bhN, Link &last, int &bhX) {
+	int bhSon = bhN - (isRed(node) ? 0 : 1);
+	if (node->Rgt.get() == NULL) {
+		last = node;
+		bhX = bhSon;
+		return node->Lft;
+	}
+	int bhRest;
+	Link Rest = splitLast(node->Rgt, bhSon, last, bhRest);
+	return join(node->Lft, bhSon, node.get(), Rest, bhRest, bhX);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: balance
+// DESCRIPTION: To make a copy of a black node "K" with new sons, rotating if
+//				one of them is red with a red son: the three nodes become a
+//				red node over two black ones, and the black height is kept.
+//				A red "K" is copied as it is, its red son left to the father.
+//   ARGUMENTS: const PNode *K - the node to copy
+//				const Link &lft - the new left son
+//				const Link &rgt - the new right son
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link - the root of the new subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::balance(const PNode *K, const Link &lft, const Link &rgt) {
+	if (K->color == 0) {
+		if (isRed(lft) && isRed(lft->Lft))
+			return make(lft->ID, lft->Rcd, 1, make(lft->Lft->ID, lft->Lft->Rcd, 0, lft->Lft->Lft, lft->Lft->Rgt),
+				make(K->ID, K->Rcd, 0, lft->Rgt, rgt));
+		if (isRed(lft) && isRed(lft->Rgt))
+			return make(lft->Rgt->ID, lft->Rgt->Rcd, 1, make(lft->ID, lft->Rcd, 0, lft->Lft, lft->Rgt->Lft),
+				make(K->ID, K->Rcd, 0, lft->Rgt->Rgt, rgt));
+		if (isRed(rgt) && isRed(rgt->Lft))
+			return make(rgt->Lft->ID, rgt->Lft->Rcd, 1, make(K->ID, K->Rcd, 0, lft, rgt->Lft->Lft),
+				make(rgt->ID, rgt->Rcd, 0, rgt->Lft->Rgt, rgt->Rgt));
+		if (isRed(rgt) && isRed(rgt->Rgt))
+			return make(rgt->ID, rgt->Rcd, 1, make(K->ID, K->Rcd, 0, lft, rgt->Lft),
+				make(rgt->Rgt->ID, rgt->Rgt->Rcd, 0, rgt->Rgt->Lft, rgt->Rgt->Rgt));
+	}
+	return make(K->ID, K->Rcd, K->color, lft, rgt);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insertAt
+// DESCRIPTION: To insert into a subtree, copying the search path only: the
+//				new node is red, and a red-red link is rotated away by the
+//				first black node above it. The black height is kept, so the
+//				root of the result may be red with a red son. Nothing is
+//				copied if "id" is already there.
+//   ARGUMENTS: const Link &node - the root of the subtree
+//				const T1 &id - the ID of the new node
+//				const T2 &rcd - the record of the new node
+//				bool &done - set to whether the node is new
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link - the root of the new subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::insertAt(const Link &node, const T1 &id, const T2 &rcd, bool &done) const {
+	if (node.get() == NULL) {
+		done = true;
+		return make(id, rcd, 1, Link(), Link());
+	}
+	int dir = compareID(id, node->ID);
+	if (dir == 0) {
+		done = false;
+		return node;
+	}
+	if (dir < 0) {
+		Link X = insertAt(node->Lft, id, rcd, done);
+		return done ? balance(node.get(), X, node->Rgt) : node;
+	}
+	Link X = insertAt(node->Rgt, id, rcd, done);
+	return done ? balance(node.get(), node->Lft, X) : node;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: deleteAt
+// DESCRIPTION: To delete from a subtree, copying the search path only.
+//   ARGUMENTS: const Link &node - the root of the subtree
+//				int bhN - the black height of "node"
+//				const T1 &id - the ID of the node to delete
+//				bool &done - set to whether the node was there
+//				int &bhX - set to the black height of the result
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: Link - the root of the new subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename PersistentRBTree<T1, T2, Compare>::Link PersistentRBTree<T1, T2, Compare>::deleteAt(const Link &node, int bhN, const T1 &id, bool &done, int &bhX) const {
+	if (node.get() == NULL) {
+		done = false;
+		bhX = bhN;
+		return node;
+	}
+	int dir = compareID(id, node->ID);
+	int bhSon = bhN - (isRed(node) ? 0 : 1), bhNew;
+	if (dir == 0) {
+		done = true;
+		return joinTwo(node->Lft, bhSon, node->Rgt, bhSon, bhX);
+	}
+
+	Link X = deleteAt((dir < 0) ? node->Lft : node->Rgt, bhSon, id, done, bhNew);
+	if (!done) {
+		bhX = bhN;
+		return node;
+	}
+	if (dir < 0)
+		return join(X, bhNew, node.get(), node->Rgt, bhSon, bhX);
+	return join(node->Lft, bhSon, node.get(), X, bhNew, bhX);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Insert
+// DESCRIPTION: Inserting a node into this version. Other versions that share
+//				the nodes do not see it.
+//   ARGUMENTS: const T1 &id - the id of the new node that is to be inserted
+// USES GLOBAL: none
+// MODIFIES GL: root, size, bh
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool PersistentRBTree<T1, T2, Compare>::Insert(const T1 &id) {
+	insert(id, T2());
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert
+// DESCRIPTION: Inserting a node with a record into this version. An existing
+//				record is left as it is.
+//   ARGUMENTS: const T1 &id - the id of the new node
+//				const T2 &rcd - the record of the new node
+// USES GLOBAL: none
+// MODIFIES GL: root, size, bh
+//     RETURNS: bool - whether the node is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool PersistentRBTree<T1, T2, Compare>::insert(const T1 &id, const T2 &rcd) {
+	bool done;
+	Link X = insertAt(root, id, rcd, done);
+	if (!done)
+		return false;
+	if (isRed(X) && (isRed(X->Lft) || isRed(X->Rgt))) {	// the one red-red link left, at the top
+		X = make(X->ID, X->Rcd, 0, X->Lft, X->Rgt);
+		++bh;
+	}
+	root = X;
+	++size;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Delete
+// DESCRIPTION: Deleting a node from this version. The node itself is freed
+//				with the last version that holds it.
+//   ARGUMENTS: const T1 &id - the id of the node that is to be deleted
+// USES GLOBAL: none
+// MODIFIES GL: root, size, bh
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool PersistentRBTree<T1, T2, Compare>::Delete(const T1 &id) {
+	bool done;
+	int bhX;
+	Link X = deleteAt(root, bh, id, done, bhX);
+	if (done) {
+		root = X;
+		bh = bhX;
+		--size;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: empty
+// DESCRIPTION: To let go of all the nodes of this version.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: root, size, bh
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool PersistentRBTree<T1, T2, Compare>::empty() {
+	root = Link();
+	size = 0;
+	bh = 0;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: find
+// DESCRIPTION: To get the record of the node with ID "id". The pointer stays
+//				good as long as this version, or another one with that node,
+//				is kept.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: const T2* - NULL if not found
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+const T2 *PersistentRBTree<T1, T2, Compare>::find(const T1 &id) const {
+	const PNode *X = root.get();
+	while (X != NULL) {
+		int dir = compareID(id, X->ID);
+		if (dir == 0)
+			return &X->Rcd;
+		X = (dir < 0) ? X->Lft.get() : X->Rgt.get();
+	}
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: forEachInRange
+// DESCRIPTION: To call "visitor" on every node with lo <= ID < hi, in ID order.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor visitor - called as visitor(const T1 &id, const T2 &rcd),
+//				returns false to stop
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if the visitor stopped the walk
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+template<class Visitor>
+bool PersistentRBTree<T1, T2, Compare>::forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const {
+	return visitRange(root.get(), lo, hi, visitor);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: visitRange
+// DESCRIPTION: The walk of forEachInRange, skipping the subtrees out of range.
+//   ARGUMENTS: const PNode *node - the root of the subtree
+//				const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor &visitor - as in forEachInRange
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if the visitor stopped the walk
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+template<class Visitor>
+bool PersistentRBTree<T1, T2, Compare>::visitRange(const PNode *node, const T1 &lo, const T1 &hi, Visitor &visitor) const {
+	if (node == NULL)
+		return true;
+	bool aboveLo = compareID(node->ID, lo) >= 0, belowHi = compareID(node->ID, hi) < 0;
+	if (aboveLo && !visitRange(node->Lft.get(), lo, hi, visitor))
+		return false;
+	if (aboveLo && belowHi && !visitor(node->ID, node->Rcd))
+		return false;
+	if (belowHi)
+		return visitRange(node->Rgt.get(), lo, hi, visitor);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////Mapped Red-Black Tree////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class MappedRegion {	// a file or a shared memory object mapped into memory; it may move when it grows
+private:
+	char *base;	// where the region is mapped, NULL if it is not
+	size_t len;	// the bytes mapped
+	bool writable;
+	bool shared;	// a shared memory object rather than a file
+#ifdef _WIN32
+	HANDLE File;	// INVALID_HANDLE_VALUE for shared memory
+	HANDLE Map;
+#else
+	int fd;
+#endif
+
+	MappedRegion(const MappedRegion &New);	// a mapping has one owner
+	MappedRegion &operator=(const MappedRegion &b);
+
+public:
+	MappedRegion();
+	~MappedRegion() { close(); }
+
+	bool open(const string &name, bool shm, bool create, bool write, size_t bytes);
+	bool resize(size_t bytes);
+	bool sync();
+	void close();
+	static bool removeShared(const string &name);
+
+	char *getBase() const { return base; }
+	size_t getLen() const { return len; }
+	bool isWritable() const { return writable; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: MappedRegion
+// DESCRIPTION: Constructor of MappedRegion class. Nothing is mapped yet.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: base, len, writable, shared, the handles
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline MappedRegion::MappedRegion() : base(NULL), len(0), writable(false), shared(false) {
+#ifdef _WIN32
+	File = INVALID_HANDLE_VALUE;
+	Map = NULL;
+#else
+	fd = -1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: open
+// DESCRIPTION: To map a file, or a shared memory object (POSIX shm_open, or a
+//				named mapping on Windows), dropping what was mapped before.
+//   ARGUMENTS: const string &name - the path of the file, or the name of the
+//				shared memory object ("/name" on POSIX)
+//				bool shm - true for shared memory, false for a file
+//				bool create - true to create it anew, or cut it down to
+//				"bytes"; false to map it all as it is
+//				bool write - true to map it for reading and writing
+//				size_t bytes - the size to create it with
+// USES GLOBAL: none
+// MODIFIES GL: base, len, writable, shared, the handles
+//     RETURNS: bool - false if it could not be opened or mapped
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool MappedRegion::open(const string &name, bool shm, bool create, bool write, size_t bytes) {
+	close();
+	writable = write || create;
+	shared = shm;
+#ifdef _WIN32
+	DWORD access = writable ? FILE_MAP_WRITE : FILE_MAP_READ;
+	if (!shared) {
+		File = CreateFileA(name.c_str(), GENERIC_READ | (writable ? GENERIC_WRITE : 0), FILE_SHARE_READ | FILE_SHARE_WRITE,
+			NULL, create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (File == INVALID_HANDLE_VALUE)
+			return false;
+		if (!create) {
+			LARGE_INTEGER Size;
+			if (!GetFileSizeEx(File, &Size)) {
+				close();
+				return false;
+			}
+			bytes = (size_t)Size.QuadPart;
+		}
+		Map = CreateFileMappingA(File, NULL, writable ? PAGE_READWRITE : PAGE_READONLY, (DWORD)((uint64_t)bytes >> 32), (DWORD)bytes, NULL);
+	}
+	else if (create)	// backed by the paging file, gone with the last handle to it
+		Map = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32), (DWORD)bytes, name.c_str());
+	else {
+		Map = OpenFileMappingA(access, FALSE, name.c_str());
+		bytes = 0;	// the whole object
+	}
+	if ((Map == NULL) || ((base = (char *)MapViewOfFile(Map, access, 0, 0, bytes)) == NULL)) {
+		close();
+		return false;
+	}
+	if (bytes == 0) {
+		MEMORY_BASIC_INFORMATION Info;
+		VirtualQuery(base, &Info, sizeof(Info));
+		bytes = Info.RegionSize;
+	}
+#else
+	int flags = writable ? O_RDWR : O_RDONLY;
+	if (create)
+		flags |= O_CREAT | O_TRUNC;
+	fd = shared ? shm_open(name.c_str(), flags, 0644) : ::open(name.c_str(), flags, 0644);
+	if (fd < 0)
+		return false;
+	struct stat Info;
+	if (create ? (ftruncate(fd, (off_t)bytes) != 0) : (fstat(fd, &Info) != 0)) {
+		close();
+		return false;
+	}
+	if (!create)
+		bytes = (size_t)Info.st_size;
+	void *Tmp = (bytes == 0) ? MAP_FAILED : mmap(NULL, bytes, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+	if (Tmp == MAP_FAILED) {
+		close();
+		return false;
+	}
+	base = (char *)Tmp;
+#endif
+	len = bytes;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: resize
+// DESCRIPTION: To grow a writable region. The file or object is made longer
+//				and mapped again, so the region may now be somewhere else.
+//				A shared memory object on Windows lives in the paging file
+//				and cannot grow.
+//   ARGUMENTS: size_t bytes - the new size
+// USES GLOBAL: none
+// MODIFIES GL: base, len, the handles
+//     RETURNS: bool - false if it could not grow, with the old mapping kept
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool MappedRegion::resize(size_t bytes) {
+	if ((base == NULL) || !writable)
+		return false;
+	if (bytes <= len)
+		return true;
+#ifdef _WIN32
+	if (File == INVALID_HANDLE_VALUE)
+		return false;
+	HANDLE NewMap = CreateFileMappingA(File, NULL, PAGE_READWRITE, (DWORD)((uint64_t)bytes >> 32), (DWORD)bytes, NULL);
+	if (NewMap == NULL)
+		return false;
+	char *NewBase = (char *)MapViewOfFile(NewMap, FILE_MAP_WRITE, 0, 0, bytes);
+	if (NewBase == NULL) {
+		CloseHandle(NewMap);
+		return false;
+	}
+	UnmapViewOfFile(base);
+	CloseHandle(Map);
+	Map = NewMap;
+	base = NewBase;
+#else
+	if (ftruncate(fd, (off_t)bytes) != 0)
+		return false;
+	void *Tmp = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (Tmp == MAP_FAILED)
+		return false;
+	munmap(base, len);
+	base = (char *)Tmp;
+#endif
+	len = bytes;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: sync
+// DESCRIPTION: To write the changed pages of a file back to the disk. Other
+//				processes see the changes at once whether or not this is
+//				called; it only matters for a crash of the machine.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if the pages could not be written
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool MappedRegion::sync() {
+	if ((base == NULL) || !writable || shared)
+		return base != NULL;
+#ifdef _WIN32
+	return FlushViewOfFile(base, len) && FlushFileBuffers(File);
+#else
+	return msync(base, len, MS_SYNC) == 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: close
+// DESCRIPTION: To unmap the region and let go of the file or object, which
+//				keeps its content.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: base, len, the handles
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline void MappedRegion::close() {
+#ifdef _WIN32
+	if (base != NULL)
+		UnmapViewOfFile(base);
+	if (Map != NULL)
+		CloseHandle(Map);
+	if (File != INVALID_HANDLE_VALUE)
+		CloseHandle(File);
+	File = INVALID_HANDLE_VALUE;
+	Map = NULL;
+#else
+	if (base != NULL)
+		munmap(base, len);
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+#endif
+	base = NULL;
+	len = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: removeShared
+// DESCRIPTION: To remove a shared memory object by name. Those who have it
+//				mapped keep it until they close it. On Windows the object
+//				goes away by itself with the last handle to it.
+//   ARGUMENTS: const string &name - the name of the object
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if there was no such object
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline bool MappedRegion::removeShared(const string &name) {
+#ifdef _WIN32
+	return true;
+#else
+	return shm_unlink(name.c_str()) == 0;
+#endif
+}
+
+template<class T1, class T2 = NULLT, class Compare = CmpPtr<T1> >
+class MappedRBTree {	// an RBTree whose nodes link by offsets inside a mapped region, so it can be shared and reopened as it is
+private :
+	static_assert(is_trivially_copyable<T1>::value && is_trivially_copyable<T2>::value, "a mapped tree keeps its IDs and records as bytes");
+
+	struct MappedHead {	// at offset 0 of the region
+		char magic[4];	// "RBTM"
+		uint32_t version;
+		uint32_t idSize;	// sizeof(T1), to catch a region made by another type of tree
+		uint32_t rcdSize;	// sizeof(T2)
+		uint64_t root;	// the offset of the root, 0 for none
+		uint64_t size;	// the number of nodes
+		uint64_t used;	// the bytes handed out, the next node goes there
+	};
+	struct MNode {	// the offsets are from the start of the region, 0 for none
+		uint64_t Lft, Rgt, Par;
+		uint32_t color;	// 0 for black, 1 for red
+		T1 ID;
+		T2 Rcd;
+	};
+	static const uint32_t mappedVersion = 1;
+
+	MappedRegion region;
+	Compare cmp;
+
+	int compareID(const T1 &a, const T1 &b) const { return CmpTraits<Compare, T1>::threeWay(cmp, a, b); }
+	MappedHead *head() const { return (MappedHead *)region.getBase(); }
+	MNode *at(uint64_t off) const { return (off == 0) ? NULL : (MNode *)(region.getBase() + off); }
+	uint64_t offOf(const MNode *X) const { return (X == NULL) ? 0 : (uint64_t)((const char *)X - region.getBase()); }
+	static uint64_t headSize() { return (sizeof(MappedHead) + alignof(MNode) - 1) / alignof(MNode) * alignof(MNode); }
+	static uint64_t nodeSize() { return (sizeof(MNode) + alignof(MNode) - 1) / alignof(MNode) * alignof(MNode); }
+	bool attach(bool fresh);
+	bool reserve(uint64_t cnt);
+	uint64_t newNode(const T1 &id, const T2 &rcd);
+	void rotateLeft(MNode *X);
+	void rotateRight(MNode *X);
+	void fixInsert(MNode *X);
+	template<class It, class IsID>
+	uint64_t buildSorted(It &it, int n, int depth, int redDepth, IsID isID);
+	template<class V>
+	static const T1 &idOf(const V &item, true_type) { return item; }
+	template<class V>
+	static const T1 &idOf(const V &item, false_type) { return item.first; }
+	template<class V>
+	static T2 rcdOf(const V &item, true_type) { return T2(); }
+	template<class V>
+	static const T2 &rcdOf(const V &item, false_type) { return item.second; }
+
+public :
+	MappedRBTree() : cmp() {}
+	MappedRBTree(const Compare &compare) : cmp(compare) {}
+
+	// where the tree lives
+	bool create(const string &path, size_t bytes = 1 << 20);
+	bool open(const string &path, bool readOnly = true);
+	bool createShared(const string &name, size_t bytes = 1 << 20);
+	bool openShared(const string &name, bool readOnly = true);
+	static bool removeShared(const string &name) { return MappedRegion::removeShared(name); }
+	bool sync() { return region.sync(); }
+	void close() { region.close(); }
+
+	bool Insert(const T1 &id);
+	pair<T2 *, bool> insert(const T1 &id, const T2 &rcd);
+	template<class It>
+	bool buildFromSorted(It first, It last);
+
+	int getSize() const { return (region.getBase() == NULL) ? 0 : (int)head()->size; }
+	const T2 *find(const T1 &id) const;
+	template<class Visitor>
+	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: attach
+// DESCRIPTION: To start a new tree in a region just made, or to check that a
+//				region opened is one of this type of tree.
+//   ARGUMENTS: bool fresh - true for a new region
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: bool - false, with the region closed, if it is not of this type
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool MappedRBTree<T1, T2, Compare>::attach(bool fresh) {
+	MappedHead *Head = head();
+	if (fresh) {
+		memcpy(Head->magic, "RBTM", 4);
+		Head->version = mappedVersion;
+		Head->idSize = sizeof(T1);
+		Head->rcdSize = sizeof(T2);
+		Head->root = 0;
+		Head->size = 0;
+		Head->used = headSize();
+		return true;
+	}
+	if ((region.getLen() < headSize()) || (memcmp(Head->magic, "RBTM", 4) != 0) || (Head->version != mappedVersion)
+		|| (Head->idSize != sizeof(T1)) || (Head->rcdSize != sizeof(T2)) || (Head->used > region.getLen()) || (Head->root >= Head->used)) {
+		region.close();
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: create
+// DESCRIPTION: To make a new, empty tree in a file, replacing the file if it
+//				is there. The file grows as nodes are added.
+//   ARGUMENTS: const string &path - the file
+//				size_t bytes = 1 << 20 - the size to start with
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: bool - false if the file could not be made
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool MappedRBTree<T1, T2, Compare>::create(const string &path, size_t bytes) {
+	return region.open(path, false, true, true, (size_t)max((uint64_t)bytes, headSize())) && attach(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: open
+// DESCRIPTION: To map the tree in a file made by create. Nothing is read or
+//				rebuilt: the nodes are used right where they are mapped.
+//   ARGUMENTS: const string &path - the file
+//				bool readOnly = true - false to add nodes to it
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: bool - false if the file could not be mapped or is not a tree
+//				of this type
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool MappedRBTree<T1, T2, Compare>::open(const string &path, bool readOnly) {
+	return region.open(path, false, false, !readOnly, 0) && attach(false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: createShared
+// DESCRIPTION: As create, in a shared memory object. On Windows the object
+//				cannot grow past "bytes" and lasts while a handle to it is
+//				open, so the creator should stay until the others have it.
+//   ARGUMENTS: const string &name - the name of the object, "/name" on POSIX
+//				size_t bytes = 1 << 20 - the size to start with
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: bool - false if the object could not be made
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool MappedRBTree<T1, T2, Compare>::createShared(const string &name, size_t bytes) {
+	return region.open(name, true, true, true, (size_t)max((uint64_t)bytes, headSize())) && attach(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: openShared
+// DESCRIPTION: As open, for a shared memory object made by createShared.
+//   ARGUMENTS: const string &name - the name of the object
+//				bool readOnly = true - false to add nodes to it
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: bool - false if the object could not be mapped or is not a
+//				tree of this type
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool MappedRBTree<T1, T2, Compare>::openShared(const string &name, bool readOnly) {
+	return region.open(name, true, false, !readOnly, 0) && attach(false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: reserve
+// DESCRIPTION: To make sure the region has room for "cnt" more nodes, growing
+//				it to at least twice its size if it has not.
+//   ARGUMENTS: uint64_t cnt - the number of nodes
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: bool - false if the region could not grow
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool MappedRBTree<T1, T2, Compare>::reserve(uint64_t cnt) {
+	uint64_t need = head()->used + cnt * nodeSize();
+	if (need <= region.getLen())
+		return true;
+	return region.resize((size_t)max(need, 2 * (uint64_t)region.getLen()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: newNode
+// DESCRIPTION: To carve a red node out of the region. The region may move, so
+//				the node is known by its offset.
+//   ARGUMENTS: const T1 &id - the ID of the node
+//				const T2 &rcd - the record of the node
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: uint64_t - the offset of the node
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+uint64_t MappedRBTree<T1, T2, Compare>::newNode(const T1 &id, const T2 &rcd) {
+	if (!reserve(1))
+		throw RBERR("Out of space");
+	uint64_t off = head()->used;
+	MNode *X = new (region.getBase() + off) MNode;
+	X->Lft = X->Rgt = X->Par = 0;
+	X->color = 1;
+	X->ID = id;
+	X->Rcd = rcd;
+	head()->used += nodeSize();
+	return off;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateLeft
+// DESCRIPTION: To lift the right son of X into its place.
+//   ARGUMENTS: MNode *X - the node to rotate down, with a right son
+// USES GLOBAL: none
+// MODIFIES GL: the links of X, its right son and its father, the root
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void MappedRBTree<T1, T2, Compare>::rotateLeft(MNode *X) {
+	MNode *Y = at(X->Rgt);
+	X->Rgt = Y->Lft;
+	if (Y->Lft != 0)
+		at(Y->Lft)->Par = offOf(X);
+	Y->Par = X->Par;
+	if (X->Par == 0)
+		head()->root = offOf(Y);
+	else if (at(X->Par)->Lft == offOf(X))
+		at(X->Par)->Lft = offOf(Y);
+	else
+		at(X->Par)->Rgt = offOf(Y);
+	Y->Lft = offOf(X);
+	X->Par = offOf(Y);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateRight
+// DESCRIPTION: To lift the left son of X into its place.
+//   ARGUMENTS: MNode *X - the node to rotate down, with a left son
+// USES GLOBAL: none
+// MODIFIES GL: the links of X, its left son and its father, the root
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void MappedRBTree<T1, T2, Compare>::rotateRight(MNode *X) {
+	MNode *Y = at(X->Lft);
+	X->Lft = Y->Rgt;
+	if (Y->Rgt != 0)
+		at(Y->Rgt)->Par = offOf(X);
+	Y->Par = X->Par;
+	if (X->Par == 0)
+		head()->root = offOf(Y);
+	else if (at(X->Par)->Rgt == offOf(X))
+		at(X->Par)->Rgt = offOf(Y);
+	else
+		at(X->Par)->Lft = offOf(Y);
+	Y->Rgt = offOf(X);
+	X->Par = offOf(Y);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: fixInsert
+// DESCRIPTION: To mend the colors up from a red leaf just hung in the tree.
+//				A red uncle is pushed up by recoloring; a black one ends it
+//				with one or two rotations.
+//   ARGUMENTS: MNode *X - the new node
+// USES GLOBAL: none
+// MODIFIES GL: colors and links on the path up, the root
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void MappedRBTree<T1, T2, Compare>::fixInsert(MNode *X) {
+	while ((X->Par != 0) && (at(X->Par)->color == 1)) {
+		MNode *P = at(X->Par), *G = at(P->Par);	// a red father is not the root
+		if (G->Lft == offOf(P)) {
+			MNode *U = at(G->Rgt);
+			if ((U != NULL) && (U->color == 1)) {
+				P->color = U->color = 0;
+				G->color = 1;
+				X = G;
+				continue;
+			}
+			if (P->Rgt == offOf(X)) {
+				X = P;
+				rotateLeft(X);
+				P = at(X->Par);
+			}
+			P->color = 0;
+			G->color = 1;
+			rotateRight(G);
+		}
+		else {
+			MNode *U = at(G->Lft);
+			if ((U != NULL) && (U->color == 1)) {
+				P->color = U->color = 0;
+				G->color = 1;
+				X = G;
+				continue;
+			}
+			if (P->Lft == offOf(X)) {
+				X = P;
+				rotateRight(X);
+				P = at(X->Par);
+			}
+			P->color = 0;
+			G->color = 1;
+			rotateLeft(G);
+		}
+	}
+	at(head()->root)->color = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert
+// DESCRIPTION: To add a node, unless its ID is in the tree. The region may
+//				move as it grows, so the record pointer returned is good
+//				until the next insertion.
+//   ARGUMENTS: const T1 &id - the ID of the new node
+//				const T2 &rcd - its record
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: pair<T2*, bool> - the record under "id" and whether it is new;
+//				NULL and false if the tree is not open for writing
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+pair<T2 *, bool> MappedRBTree<T1, T2, Compare>::insert(const T1 &id, const T2 &rcd) {
+	if ((region.getBase() == NULL) || !region.isWritable())
+		return pair<T2 *, bool>((T2 *)NULL, false);
+
+	// find where it goes before the region can move
+	uint64_t P = 0, X = head()->root;
+	int c = 0;
+	while (X != 0) {
+		P = X;
+		c = compareID(id, at(X)->ID);
+		if (c == 0)
+			return pair<T2 *, bool>(&at(X)->Rcd, false);
+		X = (c < 0) ? at(X)->Lft : at(X)->Rgt;
+	}
+
+	// hang the new node there and mend the colors
+	X = newNode(id, rcd);
+	at(X)->Par = P;
+	if (P == 0)
+		head()->root = X;
+	else if (c < 0)
+		at(P)->Lft = X;
+	else
+		at(P)->Rgt = X;
+	fixInsert(at(X));
+	++head()->size;
+	return pair<T2 *, bool>(&at(X)->Rcd, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Insert
+// DESCRIPTION: To add a node with a default record, unless its ID is there.
+//   ARGUMENTS: const T1 &id - the ID of the new node
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: bool - true if the node is new
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool MappedRBTree<T1, T2, Compare>::Insert(const T1 &id) {
+	return insert(id, T2()).second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: buildFromSorted
+// DESCRIPTION: To replace the whole tree with the items in [first, last), IDs
+//				or pairs of an ID and a record, in increasing ID order. The
+//				region grows once, and the tree is built in O(n) with no
+//				rotation, as RBTree::buildFromSorted does; the old nodes' space
+//				is reused. Input that is not strictly increasing is inserted
+//				one by one instead.
+//   ARGUMENTS: It first - the first item
+//				It last - one past the last item
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: bool - true if built in O(n); false if it fell back on
+//				insertion or the tree is not open for writing
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+template<class It>
+bool MappedRBTree<T1, T2, Compare>::buildFromSorted(It first, It last) {
+	typedef typename iterator_traits<It>::value_type V;
+	typedef integral_constant<bool, is_convertible<V, T1>::value> IsID;
+	if ((region.getBase() == NULL) || !region.isWritable())
+		return false;
+	head()->root = 0;
+	head()->size = 0;
+	head()->used = headSize();
+
+	// count the items and check their order
+	int n = 0;
+	bool sorted = true;
+	for (It Prev = first, Cur = first; Cur != last; Prev = Cur++, n++)
+		if ((n > 0) && (compareID(idOf(*Prev, IsID()), idOf(*Cur, IsID())) >= 0)) {
+			sorted = false;
+			break;
+		}
+
+	if (!sorted) {
+		for (; first != last; ++first)
+			insert(idOf(*first, IsID()), rcdOf(*first, IsID()));
+		return false;
+	}
+	if (n == 0)
+		return true;
+
+	if (!reserve(n))
+		throw RBERR("Out of space");
+	int levels = 0;
+	while ((1LL << levels) - 1 < n)	// as RBTree::redDepthOf
+		++levels;
+	head()->root = buildSorted(first, n, 0, ((1LL << levels) - 1 == n) ? -1 : levels - 1, IsID());
+	head()->size = n;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: buildSorted
+// DESCRIPTION: To build a balanced subtree of the next "n" items, the left half
+//				first so that the nodes are laid out in ID order.
+//   ARGUMENTS: It &it - the next item, moved past the subtree
+//				int n - the number of items in the subtree
+//				int depth - the depth of the subtree's root
+//				int redDepth - the depth whose nodes are red, -1 for none
+//				IsID isID - true_type for plain IDs, false_type for pairs
+// USES GLOBAL: none
+// MODIFIES GL: region
+//     RETURNS: uint64_t - the offset of the root of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+template<class It, class IsID>
+uint64_t MappedRBTree<T1, T2, Compare>::buildSorted(It &it, int n, int depth, int redDepth, IsID isID) {
+	if (n == 0)
+		return 0;
+	uint64_t Lft = buildSorted(it, (n - 1) / 2, depth + 1, redDepth, isID);
+	uint64_t X = newNode(idOf(*it, isID), rcdOf(*it, isID));
+	++it;
+	uint64_t Rgt = buildSorted(it, n - 1 - (n - 1) / 2, depth + 1, redDepth, isID);
+	MNode *Nd = at(X);
+	Nd->color = (depth == redDepth) ? 1 : 0;
+	Nd->Lft = Lft;
+	Nd->Rgt = Rgt;
+	if (Lft != 0)
+		at(Lft)->Par = X;
+	if (Rgt != 0)
+		at(Rgt)->Par = X;
+	return X;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: find
+// DESCRIPTION: To find the record of a node, read straight out of the region.
+//   ARGUMENTS: const T1 &id - the ID of the node
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: const T2* - the record, NULL if there is no such node
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+const T2 *MappedRBTree<T1, T2, Compare>::find(const T1 &id) const {
+	if (region.getBase() == NULL)
+		return NULL;
+	const MNode *X = at(head()->root);
+	while (X != NULL) {
+		int c = compareID(id, X->ID);
+		if (c == 0)
+			return &X->Rcd;
+		X = at((c < 0) ? X->Lft : X->Rgt);
+	}
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: forEachInRange
+// DESCRIPTION: To call visitor(id, rcd) on every node with lo <= ID < hi, in
+//				ID order: a descent to the first one, then a walk through the
+//				fathers, O(log n + k).
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor visitor - returns false to stop the walk
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if the visitor stopped the walk
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+template<class Visitor>
+bool MappedRBTree<T1, T2, Compare>::forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const {
+	if (region.getBase() == NULL)
+		return true;
+
+	// the first node not below lo
+	const MNode *X = at(head()->root), *First = NULL;
+	while (X != NULL)
+		if (compareID(X->ID, lo) >= 0) {
+			First = X;
+			X = at(X->Lft);
+		}
+		else
+			X = at(X->Rgt);
+
+	for (X = First; (X != NULL) && (compareID(X->ID, hi) < 0); ) {
+		if (!visitor(X->ID, X->Rcd))
+			return false;
+		if (X->Rgt != 0) {	// the next one is the first of the right subtree
+			X = at(X->Rgt);
+			while (X->Lft != 0)
+				X = at(X->Lft);
+		}
+		else {	// or the first father we are left of
+			while ((X->Par != 0) && (at(X->Par)->Rgt == offOf(X)))
+				X = at(X->Par);
+			X = at(X->Par);
+		}
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////Journaled Red-Black Tree////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+enum SyncPolicy {	// when a JournaledRBTree forces its log to the disk
+	SYNC_EACH,	// before each change returns; changes made at the same time share a sync
+	SYNC_GROUP,	// once every "group" changes, and on commit
+	SYNC_NONE	// only on commit; the log is handed to the system every "group" changes
+};
+
+template<class T1, class T2 = NULLT, class S = RcdInline, class L = PlainLinks, class Compare = CmpPtr<T1> >
+class JournaledRBTree {	// an RBTree whose changes go to a log first, so that it comes back after a crash
+private :
+	RBTree<T1, T2, S, L, Compare> tree;
+	mutable shared_mutex lock;
+	condition_variable_any flushed;	// told when a write of the log ends
+	SyncedFile Log;	// path.log
+	string path;	// the snapshot is path.snap
+	BinaryOut Pending[2];	// records not yet written: one fills while the other is written
+	int cur;	// the one that fills
+	BinaryOut Rec;	// the record being framed
+	uint64_t appended;	// the records put in Pending so far
+	uint64_t written;	// the records written, and synced if the policy syncs
+	bool flushing;	// a thread is writing the log
+	bool broken;	// a write has failed, so the log no longer follows the tree
+	SyncPolicy policy;
+	int groupSize;
+	int checkpointEvery;
+	int sinceCheckpoint;	// records since the last checkpoint
+
+	// what the log holds ahead of the records
+	struct JournalHead {
+		char magic[4];	// "RBTJ"
+		uint32_t version;
+		uint32_t idSize;	// sizeof(T1)
+		uint32_t rcdSize;	// sizeof(T2), 0 if the tree keeps no records
+	};
+	static const uint32_t journalVersion = 1;
+	enum RecordType { SET = 1, DEL = 2 };	// a record is framed as its length, its checksum, then the type, the ID and the record
+	static JournalHead journalHead();
+	static uint32_t checksum(const char *data, size_t len);
+
+	bool replay(const string &logPath, uint64_t &end, int &cnt);
+	bool apply(BinaryIn &in);
+	bool applySet(const T1 &id, BinaryIn &in, true_type) { tree.Insert(id); return true; }
+	bool applySet(const T1 &id, BinaryIn &in, false_type) {
+		T2 Rcd;
+		if (!Serializer<T2>::load(in, Rcd))
+			return false;
+		tree.insert_or_assign(id, std::move(Rcd));
+		return true;
+	}
+	void log(RecordType type, const T1 &id, const T2 *rcd);
+	bool logged(unique_lock<shared_mutex> &guard);
+	bool writeOut(unique_lock<shared_mutex> &guard, uint64_t upto, bool sync);
+	bool drain(unique_lock<shared_mutex> &guard);
+	bool checkpointLocked(unique_lock<shared_mutex> &guard);
+
+	JournaledRBTree(const JournaledRBTree<T1, T2, S, L, Compare> &b);
+	JournaledRBTree<T1, T2, S, L, Compare> &operator=(const JournaledRBTree<T1, T2, S, L, Compare> &b);
+public :
+	JournaledRBTree() : cur(0), appended(0), written(0), flushing(false), broken(false), policy(SYNC_EACH), groupSize(1), checkpointEvery(1), sinceCheckpoint(0) {}
+	JournaledRBTree(const Compare &compare) : tree(compare), cur(0), appended(0), written(0), flushing(false), broken(false), policy(SYNC_EACH), groupSize(1), checkpointEvery(1), sinceCheckpoint(0) {}
+	~JournaledRBTree() { close(); }
+
+	bool open(const string &path, SyncPolicy policy = SYNC_EACH, int group = 64, int checkpointEvery = 1 << 20);
+	bool commit();
+	bool checkpoint();
+	bool close();
+
+	bool Insert(const T1 &id);
+	bool insert(const T1 &id, const T2 &rcd);
+	bool insert_or_assign(const T1 &id, const T2 &rcd);
+	bool Delete(const T1 &id);
+
+	int getSize() const;
+	bool contains(const T1 &id) const;
+	bool find(const T1 &id, T2 &rcd) const;
+	template<class Visitor>
+	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: journalHead
+// DESCRIPTION: The head of a log of this type of tree.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: JournalHead
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+typename JournaledRBTree<T1, T2, S, L, Compare>::JournalHead JournaledRBTree<T1, T2, S, L, Compare>::journalHead() {
+	JournalHead Head;
+	memcpy(Head.magic, "RBTJ", 4);
+	Head.version = journalVersion;
+	Head.idSize = sizeof(T1);
+	Head.rcdSize = is_empty<T2>::value ? 0 : sizeof(T2);
+	return Head;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: checksum
+// DESCRIPTION: The 32-bit FNV-1a hash of a record, to find one that was only
+//				partly written when the machine went down.
+//   ARGUMENTS: const char *data - the record
+//				size_t len - its length
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: uint32_t
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+uint32_t JournaledRBTree<T1, T2, S, L, Compare>::checksum(const char *data, size_t len) {
+	uint32_t Hash = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		Hash ^= (unsigned char)data[i];
+		Hash *= 16777619u;
+	}
+	return Hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: open
+// DESCRIPTION: To bring the tree back from "path": the snapshot path.snap is
+//				loaded if there is one, then the records of path.log are
+//				done again in order. A record cut short or garbled by a crash
+//				ends the log and is cut off. A missing log is made anew.
+//   ARGUMENTS: const string &path - the snapshot and the log, without the
+//				suffixes
+//				SyncPolicy policy - when the log is forced to the disk
+//				int group - the changes written at a time under SYNC_GROUP
+//				and SYNC_NONE
+//				int checkpointEvery - the changes after which a checkpoint is
+//				taken by itself
+// USES GLOBAL: none
+// MODIFIES GL: tree, Log, path, Pending, the counters, the settings
+//     RETURNS: bool - false, with the tree left empty, if a journal is open
+//				already, or the files could not be read or made, or are not
+//				of this type of tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::open(const string &path, SyncPolicy policy, int group, int checkpointEvery) {
+	unique_lock<shared_mutex> guard(lock);
+	if (Log.isOpen())
+		return false;
+	tree.empty();
+	this->path = path;
+	this->policy = policy;
+	groupSize = MAX(group, 1);
+	this->checkpointEvery = MAX(checkpointEvery, 1);
+	cur = 0;
+	appended = written = 0;
+	broken = false;
+	Pending[0].reset();
+	Pending[1].reset();
+
+	// the snapshot, less a copy left half made by a checkpoint
+	string Snap = path + ".snap", LogPath = path + ".log";
+	remove((Snap + ".tmp").c_str());
+	if (ifstream(Snap.c_str(), ios::in | ios::binary).is_open() && !tree.load(Snap))
+		return false;
+
+	// then the log
+	uint64_t End;
+	if (!replay(LogPath, End, sinceCheckpoint)) {
+		tree.empty();
+		return false;
+	}
+	if (End == 0) {	// made whole under another name, so a crash cannot leave half a head
+		SyncedFile Tmp;
+		JournalHead Head = journalHead();
+		bool good = Tmp.open(LogPath + ".tmp", true) && Tmp.append(&Head, sizeof(Head)) && Tmp.sync();
+		Tmp.close();
+		if (!good || !SyncedFile::replaceFile(LogPath + ".tmp", LogPath)) {
+			tree.empty();
+			return false;
+		}
+	}
+	if (!Log.open(LogPath, false) || ((End > 0) && (!Log.truncate(End) || !Log.sync()))) {
+		Log.close();
+		tree.empty();
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: replay
+// DESCRIPTION: To do again the records of a log, up to the first one that is
+//				cut short or does not match its checksum.
+//   ARGUMENTS: const string &logPath - the log
+//				uint64_t &end - set to the end of the last good record, or
+//				0 if there is no log
+//				int &cnt - set to the number of records done
+// USES GLOBAL: none
+// MODIFIES GL: tree
+//     RETURNS: bool - false if the log is not of this type of tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::replay(const string &logPath, uint64_t &end, int &cnt) {
+	end = 0;
+	cnt = 0;
+	BinaryIn In(logPath);
+	JournalHead Head, Want = journalHead();
+	if (!In.get(&Head, sizeof(Head)))
+		return true;
+	if ((memcmp(Head.magic, Want.magic, 4) != 0) || (Head.version != Want.version)
+		|| (Head.idSize != Want.idSize) || (Head.rcdSize != Want.rcdSize))
+		return false;
+	end = sizeof(Head);
+
+	vector<char> Payload;
+	uint32_t Frame[2];	// the length and the checksum
+	while (In.get(Frame, sizeof(Frame)) && (Frame[0] > 0)) {
+		Payload.clear();
+		bool good = true;
+		for (uint32_t left = Frame[0]; good && (left > 0); ) {	// a piece at a time, so a broken length cannot ask for all the memory
+			size_t piece = min(left, (uint32_t)1 << 20), old = Payload.size();
+			Payload.resize(old + piece);
+			good = In.get(&Payload[old], piece);
+			left -= (uint32_t)piece;
+		}
+		if (!good || (checksum(&Payload[0], Payload.size()) != Frame[1]))
+			break;
+		BinaryIn Rec(&Payload[0], Payload.size());
+		if (!apply(Rec))
+			break;
+		end += sizeof(Frame) + Frame[0];
+		cnt++;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: apply
+// DESCRIPTION: To do one record of the log to the tree. A record sets or
+//				deletes an ID outright, so doing it again over a snapshot
+//				that has it already changes nothing.
+//   ARGUMENTS: BinaryIn &in - the record
+// USES GLOBAL: none
+// MODIFIES GL: tree
+//     RETURNS: bool - false if the record could not be read
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::apply(BinaryIn &in) {
+	unsigned char Type;
+	T1 ID;
+	if (!in.get(&Type, 1) || !Serializer<T1>::load(in, ID))
+		return false;
+	if (Type == DEL) {
+		tree.Delete(ID);
+		return true;
+	}
+	if (Type == SET)
+		return applySet(ID, in, integral_constant<bool, is_empty<T2>::value>());
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: log
+// DESCRIPTION: To frame a record and put it after the others waiting to be
+//				written. The lock is held exclusively.
+//   ARGUMENTS: RecordType type - SET or DEL
+//				const T1 &id - the ID
+//				const T2 *rcd - the record of a SET, if the tree keeps them
+// USES GLOBAL: none
+// MODIFIES GL: Rec, Pending, appended, sinceCheckpoint
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+void JournaledRBTree<T1, T2, S, L, Compare>::log(RecordType type, const T1 &id, const T2 *rcd) {
+	unsigned char Type = (unsigned char)type;
+	Rec.reset();
+	Rec.put(&Type, 1);
+	Serializer<T1>::save(Rec, id);
+	if ((type == SET) && !is_empty<T2>::value)
+		Serializer<T2>::save(Rec, *rcd);
+	uint32_t Frame[2] = { (uint32_t)Rec.length(), checksum(Rec.data(), Rec.length()) };
+	Pending[cur].put(Frame, sizeof(Frame));
+	Pending[cur].put(Rec.data(), Rec.length());
+	appended++;
+	sinceCheckpoint++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: logged
+// DESCRIPTION: What follows a change once its record is in: the log is
+//				written as the policy asks, and a checkpoint is taken when
+//				it is due.
+//   ARGUMENTS: unique_lock<shared_mutex> &guard - the lock, held
+// USES GLOBAL: none
+// MODIFIES GL: Log, Pending, written, sinceCheckpoint
+//     RETURNS: bool - true
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::logged(unique_lock<shared_mutex> &guard) {
+	bool good = true;
+	if (policy == SYNC_EACH)
+		good = writeOut(guard, appended, true);
+	else if (!flushing && (appended - written >= (uint64_t)groupSize))	// if a write is under way, the next change will start one
+		good = writeOut(guard, appended, policy == SYNC_GROUP);
+	if (good && (sinceCheckpoint >= checkpointEvery))
+		checkpointLocked(guard);	// if it fails, the log just grows until the next one
+	if (!good)
+		throw RBERR("Journal write failed");
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: writeOut
+// DESCRIPTION: To see the records up to "upto" written. This is the group
+//				commit: one thread at a time writes, and takes everything
+//				that is waiting, with the lock let go so that others can
+//				go on changing the tree and add their records meanwhile;
+//				they wait here and the next of them writes all of those at
+//				once, with one sync.
+//   ARGUMENTS: unique_lock<shared_mutex> &guard - the lock, held
+//				uint64_t upto - the records that must be written
+//				bool sync - true to force them to the disk
+// USES GLOBAL: none
+// MODIFIES GL: Log, Pending, cur, written, flushing, broken
+//     RETURNS: bool - false if a write has failed
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::writeOut(unique_lock<shared_mutex> &guard, uint64_t upto, bool sync) {
+	while (!broken && (written < upto)) {
+		if (flushing) {
+			flushed.wait(guard);
+			continue;
+		}
+		flushing = true;
+		BinaryOut &Out = Pending[cur];
+		cur = 1 - cur;
+		uint64_t End = appended;
+		guard.unlock();
+		bool good = Log.append(Out.data(), Out.length()) && (!sync || Log.sync());
+		guard.lock();
+		Out.reset();
+		flushing = false;
+		if (good)
+			written = End;
+		else
+			broken = true;
+		flushed.notify_all();
+	}
+	return !broken;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: drain
+// DESCRIPTION: To write and sync every record, and wait for any write under
+//				way, so that the log is left to this thread.
+//   ARGUMENTS: unique_lock<shared_mutex> &guard - the lock, held
+// USES GLOBAL: none
+// MODIFIES GL: Log, Pending, cur, written, flushing, broken
+//     RETURNS: bool - false if a write has failed
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::drain(unique_lock<shared_mutex> &guard) {
+	while (!broken && (flushing || (written < appended)))
+		if (flushing)
+			flushed.wait(guard);
+		else
+			writeOut(guard, appended, true);
+	return !broken && ((policy != SYNC_NONE) || Log.sync());	// what SYNC_NONE wrote is not on the disk yet
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: checkpointLocked
+// DESCRIPTION: To save the tree as the new snapshot and empty the log. The
+//				snapshot is saved under another name and renamed over the
+//				old one, so a crash leaves the old snapshot or the new; a
+//				crash before the log is emptied only means its records are
+//				done again over a snapshot that has them.
+//   ARGUMENTS: unique_lock<shared_mutex> &guard - the lock, held
+// USES GLOBAL: none
+// MODIFIES GL: Log, sinceCheckpoint
+//     RETURNS: bool - false if the snapshot could not be saved
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::checkpointLocked(unique_lock<shared_mutex> &guard) {
+	string Snap = path + ".snap";
+	if (!drain(guard) || !tree.save(Snap + ".tmp") || !SyncedFile::syncPath(Snap + ".tmp")
+		|| !SyncedFile::replaceFile(Snap + ".tmp", Snap))
+		return false;
+	if (!Log.truncate(sizeof(JournalHead)) || !Log.sync())
+		return false;
+	sinceCheckpoint = 0;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: commit
+// DESCRIPTION: To write every change so far to the disk, whatever the policy.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: Log, Pending, written
+//     RETURNS: bool - false if no journal is open or a write has failed
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::commit() {
+	unique_lock<shared_mutex> guard(lock);
+	return Log.isOpen() && drain(guard);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: checkpoint
+// DESCRIPTION: To save the tree as the new snapshot and empty the log now,
+//				rather than after checkpointEvery changes. The tree is
+//				locked while it is saved.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: Log, sinceCheckpoint
+//     RETURNS: bool - false if no journal is open or the snapshot could not
+//				be saved
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::checkpoint() {
+	unique_lock<shared_mutex> guard(lock);
+	return Log.isOpen() && checkpointLocked(guard);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: close
+// DESCRIPTION: To commit the changes, close the log and empty the tree.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: tree, Log, Pending, written
+//     RETURNS: bool - false if no journal was open or a write has failed
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::close() {
+	unique_lock<shared_mutex> guard(lock);
+	if (!Log.isOpen())
+		return false;
+	bool good = drain(guard);
+	Log.close();
+	tree.empty();
+	return good;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Insert
+// DESCRIPTION: Inserting a node into the tree, and logging it. Under SYNC_EACH
+//				this returns once the record is on the disk; other threads
+//				may see the node a little before that.
+//   ARGUMENTS: const T1 &id - the id of the new node that is to be inserted
+// USES GLOBAL: none
+// MODIFIES GL: tree, the log
+//     RETURNS: bool - false if the ID was there, or no journal is open;
+//				throws RBERR if the log could not be written
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::Insert(const T1 &id) {
+	unique_lock<shared_mutex> guard(lock);
+	if (!Log.isOpen() || broken)
+		return false;
+	int Size = tree.getSize();
+	tree.Insert(id);
+	if (tree.getSize() == Size)	// it was there, so there is nothing to log
+		return false;
+	log(SET, id, tree.find(id));
+	return logged(guard);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert
+// DESCRIPTION: Inserting a node with its record, and logging it, as Insert.
+//   ARGUMENTS: const T1 &id - the id of the new node
+//				const T2 &rcd - its record
+// USES GLOBAL: none
+// MODIFIES GL: tree, the log
+//     RETURNS: bool - false if the ID was there, or no journal is open;
+//				throws RBERR if the log could not be written
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::insert(const T1 &id, const T2 &rcd) {
+	unique_lock<shared_mutex> guard(lock);
+	if (!Log.isOpen() || broken)
+		return false;
+	pair<T2 *, bool> Res = tree.insert(id, rcd);
+	if (!Res.second)
+		return false;
+	log(SET, id, Res.first);
+	return logged(guard);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insert_or_assign
+// DESCRIPTION: Inserting a node with its record, or setting the record of the
+//				node that has the ID, and logging it, as Insert.
+//   ARGUMENTS: const T1 &id - the id of the node
+//				const T2 &rcd - its record
+// USES GLOBAL: none
+// MODIFIES GL: tree, the log
+//     RETURNS: bool - true if a node was inserted, false if one was set or
+//				no journal is open; throws RBERR if the log could not be
+//				written
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::insert_or_assign(const T1 &id, const T2 &rcd) {
+	unique_lock<shared_mutex> guard(lock);
+	if (!Log.isOpen() || broken)
+		return false;
+	pair<T2 *, bool> Res = tree.insert_or_assign(id, rcd);
+	log(SET, id, Res.first);
+	logged(guard);
+	return Res.second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Delete
+// DESCRIPTION: Deleting a node from the tree, and logging it, as Insert.
+//   ARGUMENTS: const T1 &id - the id of the node that is to be deleted
+// USES GLOBAL: none
+// MODIFIES GL: tree, the log
+//     RETURNS: bool - false if the ID was not there, or no journal is open;
+//				throws RBERR if the log could not be written
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::Delete(const T1 &id) {
+	unique_lock<shared_mutex> guard(lock);
+	if (!Log.isOpen() || broken)
+		return false;
+	int Size = tree.getSize();
+	tree.Delete(id);
+	if (tree.getSize() == Size)	// it was not there, so there is nothing to log
+		return false;
+	log(DEL, id, NULL);
+	return logged(guard);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: getSize
+// DESCRIPTION: To get the number of nodes, with the lock shared.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+int JournaledRBTree<T1, T2, S, L, Compare>::getSize() const {
+	shared_lock<shared_mutex> guard(lock);
+	return tree.getSize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: contains
+// DESCRIPTION: To tell whether a node of a certain ID is in the tree, with the
+//				lock shared.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::contains(const T1 &id) const {
+	shared_lock<shared_mutex> guard(lock);
+	return tree.find(id) != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: find
+// DESCRIPTION: To copy out the record of a node of a certain ID, with the lock
+//				shared.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+//				T2 &rcd - where the record is copied to
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+bool JournaledRBTree<T1, T2, S, L, Compare>::find(const T1 &id, T2 &rcd) const {
+	shared_lock<shared_mutex> guard(lock);
+	const T2 *Tmp = tree.find(id);
+	if (Tmp == NULL)
+		return false;
+	rcd = *Tmp;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: forEachInRange
+// DESCRIPTION: To call "visitor" on every node with lo <= ID < hi, with the lock
+//				shared. The visitor must not call back into the tree.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor visitor - called as visitor(const T1 &id, T2 &rcd), returns
+//				false to stop
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - true if the whole range was visited, false if stopped
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare>
+template<class Visitor>
+bool JournaledRBTree<T1, T2, S, L, Compare>::forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const {
+	shared_lock<shared_mutex> guard(lock);
+	return tree.forEachInRange(lo, hi, visitor);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////Lock-Coupled Red-Black Tree///////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class SpinRWLock {	// a reader-writer lock in one word, for locks held over a few loads and stores; a waiting writer goes before new readers
+private:
+	static const unsigned int HELD = 1u << 31;	// a writer holds it
+	static const unsigned int PENDING = 1u << 30;	// a writer waits for it, so no new reader may come in
+	atomic<unsigned int> state;	// the two bits above, and the number of readers in the rest
+
+	SpinRWLock(const SpinRWLock &b);
+	SpinRWLock &operator=(const SpinRWLock &b);
+public:
+	SpinRWLock() : state(0) {}
+
+	void lock();
+	void unlock() { state.fetch_and(~HELD, memory_order_release); }	// another writer may have set PENDING meanwhile
+	void lock_shared();
+	void unlock_shared() { state.fetch_sub(1, memory_order_release); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: lock
+// DESCRIPTION: To hold the lock on its own. It spins while the lock is taken, and
+//				gives up the processor between tries after a while, in case the
+//				holder has been switched out. While it waits it sets PENDING, so
+//				that the readers inside drain and a stream of new ones cannot
+//				keep it out; taking the lock clears the bit, and a writer still
+//				waiting sets it again.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: state
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline void SpinRWLock::lock() {
+	int spins = 0;
+	while (true) {
+		unsigned int Tmp = state.load(memory_order_relaxed);
+		if (((Tmp & ~PENDING) == 0) && state.compare_exchange_weak(Tmp, HELD, memory_order_acquire, memory_order_relaxed))
+			return;
+		if ((Tmp & PENDING) == 0)
+			state.fetch_or(PENDING, memory_order_relaxed);
+		if (spins < 64)
+			++spins;
+		else
+			this_thread::yield();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: lock_shared
+// DESCRIPTION: To share the lock with other readers, spinning as lock does while
+//				a writer holds it or waits for it. A reader never asks again for
+//				a lock it holds, so waiting behind a writer cannot deadlock.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: state
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline void SpinRWLock::lock_shared() {
+	int spins = 0;
+	while (true) {
+		unsigned int Tmp = state.load(memory_order_relaxed);
+		if (((Tmp & (HELD | PENDING)) == 0) && state.compare_exchange_weak(Tmp, Tmp + 1, memory_order_acquire, memory_order_relaxed))
+			return;
+		if (spins < 64)
+			++spins;
+		else
+			this_thread::yield();
+	}
+}
+
+template<class T1, class T2 = NULLT, class Compare = CmpPtr<T1> >
+class LockCoupledRBTree {	// a top-down RBTree with a lock in every node, so that changes in different parts of it go on at once
+private :
+	class LNode {
+	public:
+		LNode(const T1 &id, const T2 &rcd) : ID(id), Rcd(rcd), Lft(NULL), Rgt(NULL), color(1) {}
+		const T1 ID;
+		T2 Rcd;
+		LNode *Lft, *Rgt;	// no father: a change writes only the nodes it holds, never the subtrees it moves
+		SpinRWLock lock;	// guards Lft and Rgt, and the colors of the sons
+		char color;	// 0 for black, 1 for red; read and written only while the father is held
+	};
+	class Cursor {	// where a descent is, as in RBTree
+	public:
+		LNode *X, *T, *P, *GP, *GGP;
+	};
+	static const int maxHeld = 512;	// more than a Delete can hold in a tree of INT_MAX nodes
+	class Held {	// the nodes a writer has locked, in no order
+	public:
+		Held() : cnt(0), head(false) {}
+		LNode *Nds[maxHeld];
+		int cnt;
+		bool head;	// whether the root pointer is held too
+	};
+
+	LNode *root;
+	mutable SpinRWLock headLock;	// guards the root pointer and the color of the root; taken before the root
+	atomic<int> size;
+	Compare cmp;
+
+	int compareID(const T1 &a, const T1 &b) const { return CmpTraits<Compare, T1>::threeWay(cmp, a, b); }
+	static bool isRed(const LNode * const node) { return (node != NULL) && (node->color == 1); }
+	static LNode *rotateLL(LNode *N1);
+	static LNode *rotateRR(LNode *N1);
+	static LNode *rotateLR(LNode *N1);
+	static LNode *rotateRL(LNode *N1);
+	void relink(LNode *father, LNode *oldSon, LNode *newSon);
+	void take(Held &H, LNode *node);
+	void keepOnly(Held &H, LNode * const *keep, int k);
+	void releaseAll(Held &H);
+	LNode *fatherOf(const Held &H, const LNode *node) const;
+	bool iHandleReorient(Cursor &C, Held &H);
+	bool dHandleReorient(Cursor &C, int dir, Held &H);
+	bool insertNode(const T1 &id, const T2 &rcd);
+	bool lookup(const T1 &id, T2 *rcd) const;
+	bool firstFrom(const T1 &from, bool inclusive, T1 &id, T2 &rcd) const;
+
+	LockCoupledRBTree(const LockCoupledRBTree<T1, T2, Compare> &b);
+	LockCoupledRBTree<T1, T2, Compare> &operator=(const LockCoupledRBTree<T1, T2, Compare> &b);
+public :
+	LockCoupledRBTree() : root(NULL), size(0) {}
+	LockCoupledRBTree(const Compare &compare) : root(NULL), size(0), cmp(compare) {}
+	~LockCoupledRBTree() { empty(); }
+
+	bool Insert(const T1 &id) { return insertNode(id, T2()); }
+	bool insert(const T1 &id, const T2 &rcd) { return insertNode(id, rcd); }
+	bool Delete(const T1 &id);
+	bool empty();
+
+	int getSize() const { return size.load(memory_order_relaxed); }
+	bool contains(const T1 &id) const { return lookup(id, NULL); }
+	bool find(const T1 &id, T2 &rcd) const { return lookup(id, &rcd); }
+	template<class Visitor>
+	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateLL
+// DESCRIPTION: The single rotation LL, as RBTree::rotateLL.
+//   ARGUMENTS: LNode *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: LNode* - the new top of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename LockCoupledRBTree<T1, T2, Compare>::LNode *LockCoupledRBTree<T1, T2, Compare>::rotateLL(LNode *N1) {
+	LNode *N2 = N1->Lft;
+	N1->Lft = N2->Rgt;
+	N2->Rgt = N1;
+	return N2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateRR
+// DESCRIPTION: The single rotation RR, as RBTree::rotateRR.
+//   ARGUMENTS: LNode *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: LNode* - the new top of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename LockCoupledRBTree<T1, T2, Compare>::LNode *LockCoupledRBTree<T1, T2, Compare>::rotateRR(LNode *N1) {
+	LNode *N2 = N1->Rgt;
+	N1->Rgt = N2->Lft;
+	N2->Lft = N1;
+	return N2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateLR
+// DESCRIPTION: The double rotation LR, as RBTree::rotateLR.
+//   ARGUMENTS: LNode *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: LNode* - the new top of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename LockCoupledRBTree<T1, T2, Compare>::LNode *LockCoupledRBTree<T1, T2, Compare>::rotateLR(LNode *N1) {
+	LNode *N2 = N1->Lft;
+	LNode *N3 = N2->Rgt;
+	N2->Rgt = N3->Lft;
+	N1->Lft = N3->Rgt;
+	N3->Lft = N2;
+	N3->Rgt = N1;
+	return N3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: rotateRL
+// DESCRIPTION: The double rotation RL, as RBTree::rotateRL.
+//   ARGUMENTS: LNode *N1 - the trouble finder node
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: LNode* - the new top of the subtree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename LockCoupledRBTree<T1, T2, Compare>::LNode *LockCoupledRBTree<T1, T2, Compare>::rotateRL(LNode *N1) {
+	LNode *N2 = N1->Rgt;
+	LNode *N3 = N2->Lft;
+	N2->Lft = N3->Rgt;
+	N1->Rgt = N3->Lft;
+	N3->Lft = N1;
+	N3->Rgt = N2;
+	return N3;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: relink
+// DESCRIPTION: To put "newSon" where "oldSon" was under "father". Both "father",
+//				or the root pointer if it is NULL, must be held.
+//   ARGUMENTS: LNode *father - the father of "oldSon", NULL for the root
+//				LNode *oldSon - the son to be replaced
+//				LNode *newSon - the son to take its place
 // USES GLOBAL: none
 // MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void LockCoupledRBTree<T1, T2, Compare>::relink(LNode *father, LNode *oldSon, LNode *newSon) {
+	if (father == NULL)
+		root = newSon;
+	else if (father->Lft == oldSon)
+		father->Lft = newSon;
+	else
+		father->Rgt = newSon;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: take
+// DESCRIPTION: To lock a node on its own, unless it is NULL or already held.
+//				A node is only ever taken while its father is held, so every
+//				thread waits for a thread below it, and none waits in a circle.
+//				A node is held to read or change its sons; their colors need
+//				only the node itself, so a son is taken only to be changed or
+//				gone down to.
+//   ARGUMENTS: Held &H - the nodes held so far
+//				LNode *node - the node to lock
+// USES GLOBAL: none
+// MODIFIES GL: H
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void LockCoupledRBTree<T1, T2, Compare>::take(Held &H, LNode *node) {
+	if (node == NULL)
+		return;
+	for (int i = 0; i < H.cnt; i++)
+		if (H.Nds[i] == node)
+			return;
+	if (H.cnt == maxHeld)
+		throw RBERR("Too many nodes held");
+	node->lock.lock();
+	H.Nds[H.cnt++] = node;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: keepOnly
+// DESCRIPTION: To let go of every held node that is not in "keep", as the window
+//				of a writer slides down.
+//   ARGUMENTS: Held &H - the nodes held
+//				LNode * const *keep - the nodes to keep, NULL ones are skipped
+//				int k - the length of "keep"
+// USES GLOBAL: none
+// MODIFIES GL: H
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void LockCoupledRBTree<T1, T2, Compare>::keepOnly(Held &H, LNode * const *keep, int k) {
+	for (int i = 0; i < H.cnt; ) {
+		bool kept = false;
+		for (int j = 0; (j < k) && !kept; j++)
+			kept = (H.Nds[i] == keep[j]);
+		if (kept)
+			i++;
+		else {
+			H.Nds[i]->lock.unlock();
+			H.Nds[i] = H.Nds[--H.cnt];
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: releaseAll
+// DESCRIPTION: To let go of every held node, and of the root pointer if held.
+//   ARGUMENTS: Held &H - the nodes held
+// USES GLOBAL: none
+// MODIFIES GL: H
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void LockCoupledRBTree<T1, T2, Compare>::releaseAll(Held &H) {
+	for (int i = 0; i < H.cnt; i++)
+		H.Nds[i]->lock.unlock();
+	H.cnt = 0;
+	if (H.head) {
+		headLock.unlock();
+		H.head = false;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: fatherOf
+// DESCRIPTION: To find the father of a held node among the held nodes. Delete
+//				holds every node from the father of its target down, and any node
+//				rotated in above the target is one it held, so the father is there.
+//   ARGUMENTS: const Held &H - the nodes held
+//				const LNode *node - the node whose father is wanted
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: LNode* - NULL if "node" is the root
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+typename LockCoupledRBTree<T1, T2, Compare>::LNode *LockCoupledRBTree<T1, T2, Compare>::fatherOf(const Held &H, const LNode *node) const {
+	for (int i = 0; i < H.cnt; i++)
+		if ((H.Nds[i]->Lft == node) || (H.Nds[i]->Rgt == node))
+			return H.Nds[i];
+	if (!H.head || (root != node))
+		throw RBERR("Father not held");
+	return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: iHandleReorient
+// DESCRIPTION: As RBTree::iHandleReorient. It changes the links of GGP, GP, P
+//				and X, which the descent holds, and the colors of their sons; the
+//				root is made black again only while the root pointer is held, as
+//				no other change can make it red.
+//   ARGUMENTS: Cursor &C - where the descent is
+//				Held &H - the nodes held
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), C
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool LockCoupledRBTree<T1, T2, Compare>::iHandleReorient(Cursor &C, Held &H) {
+	LNode *Top;
+
+	// recoloring
+	C.X->color = 1;
+	if (C.X->Lft != NULL)
+		C.X->Lft->color = 0;
+	if (C.X->Rgt != NULL)
+		C.X->Rgt->color = 0;
+
+	if (isRed(C.P)) {	// rotation
+		int Case = (C.P->Lft == C.X) + ((C.GP->Lft == C.P) << 1);
+		switch(Case) {
+		case 0:	// single rotate with right
+			Top = rotateRR(C.GP);
+			break;
+		case 1:	// double rotate right-left
+			Top = rotateRL(C.GP);
+			break;
+		case 2: // double rotate left-right
+			Top = rotateLR(C.GP);
+			break;
+		case 3: // single rotate with left
+			Top = rotateLL(C.GP);
+			break;
+		default:
+			throw RBERR("Case out of range");
+			return false;
+		}
+		C.GP->color = 1;
+		Top->color = 0;
+		relink(C.GGP, C.GP, Top);
+		if ((Case == 0) || (Case == 3))
+			C.GP = C.GGP;
+		else
+			C.P = C.GGP;
+	}
+
+	if (H.head)
+		root->color = 0;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: insertNode
+// DESCRIPTION: As RBTree::insertNode, with the locks coupled on the way down:
+//				the writer holds GGP, GP, P and X, takes the next X before it
+//				moves on, and then lets go of every node above the new GGP, so
+//				writers in different parts of the tree do not wait for each other.
+//   ARGUMENTS: const T1 &id - the ID of the new node
+//				const T2 &rcd - the record of the new node
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: bool - false if the ID is already in the tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool LockCoupledRBTree<T1, T2, Compare>::insertNode(const T1 &id, const T2 &rcd) {
+	Cursor C;
+	Held H;
+	int dir = 0;
+
+	headLock.lock();
+	H.head = true;
+	C.X = root;
+	C.P = C.GP = C.GGP = NULL;
+	take(H, C.X);
+	while (C.X != NULL) {
+		dir = compareID(id, C.X->ID);
+		if (dir == 0) {	// if the Node already exists
+			releaseAll(H);
+			return false;
+		}
+		if (isRed(C.X->Lft) && isRed(C.X->Rgt))
+			iHandleReorient(C, H);
+		C.GGP = C.GP;
+		C.GP = C.P;
+		C.P = C.X;
+		C.X = (dir < 0) ? C.X->Lft : C.X->Rgt;
+		take(H, C.X);
+
+		// once GGP and GP are real nodes, no rotation can reach the root pointer
+		if (H.head && (C.GGP != NULL) && (C.GP != NULL)) {
+			headLock.unlock();
+			H.head = false;
+		}
+		LNode * const keep[] = {C.GGP, C.GP, C.P, C.X, H.head ? root : NULL};
+		keepOnly(H, keep, 5);
+	}
+
+	// create a new Node and concatenate it on the tree
+	LNode *New = new (std::nothrow) LNode(id, rcd);
+	if (New == NULL) {
+		releaseAll(H);
+		throw NodeERR("Out of space");
+	}
+	take(H, New);
+	C.X = New;
+	if (C.P == NULL)
+		root = New;
+	else if (dir < 0)
+		C.P->Lft = New;
+	else
+		C.P->Rgt = New;
+	size.fetch_add(1, memory_order_relaxed);
+	if (isRed(C.P))
+		iHandleReorient(C, H);
+
+	if (H.head)
+		root->color = 0;
+	releaseAll(H);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: dHandleReorient
+// DESCRIPTION: As RBTree::dHandleReorient. T, and the son of X or of T that a
+//				rotation moves up, are taken here, only when they are needed.
+//   ARGUMENTS: Cursor &C - where the descent is
+//				int dir - indicate the direction X is moving towards (-1 left, 1 right)
+//				Held &H - the nodes held
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), C
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool LockCoupledRBTree<T1, T2, Compare>::dHandleReorient(Cursor &C, int dir, Held &H) {
+	LNode *Top;
+
+	// case 2B: the other son of X is red, turn it into X's father
+	if (isRed(dir < 0 ? C.X->Rgt : C.X->Lft)) {
+		take(H, (dir < 0) ? C.X->Rgt : C.X->Lft);
+		Top = (dir < 0) ? rotateRR(C.X) : rotateLL(C.X);
+		C.X->color = 1;
+		Top->color = 0;
+		relink(C.P, C.X, Top);
+		C.GP = C.P;
+		C.P = Top;
+		C.T = (dir < 0) ? Top->Rgt : Top->Lft;
+		return true;
+	}
+
+	// X is the root
+	if (C.T == NULL)
+		return true;
+
+	// case 2A1: both sons of T are black, flip the colors
+	take(H, C.T);
+	if (!isRed(C.T->Lft) && !isRed(C.T->Rgt)) {
+		C.P->color = 0;
+		C.X->color = 1;
+		C.T->color = 1;
+		return true;
+	}
+
+	// case 2A2 and 2A3: T has a red son, rotate at P
+	bool outer = isRed((C.P->Lft == C.X) ? C.T->Rgt : C.T->Lft);
+	if (!outer)
+		take(H, (C.P->Lft == C.X) ? C.T->Lft : C.T->Rgt);
+	if (C.P->Lft == C.X)	// T is on the right
+		Top = outer ? rotateRR(C.P) : rotateRL(C.P);
+	else	// T is on the left
+		Top = outer ? rotateLL(C.P) : rotateLR(C.P);
+	Top->color = 1;
+	Top->Lft->color = 0;
+	Top->Rgt->color = 0;
+	relink(C.GP, C.P, Top);
+	C.X->color = 1;
+	C.GP = Top;
+	C.T = (C.P->Lft == C.X) ? C.P->Rgt : C.P->Lft;
+
+	// a red root is made black at once, as the root pointer is let go of early
+	if (H.head)
+		root->color = 0;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Delete
+// DESCRIPTION: As RBTree::Delete, with the locks coupled on the way down: the
+//				writer holds GP, P and X, and the nodes dHandleReorient takes.
+//				Once the target is found nothing below its father is let go of,
+//				since the predecessor found at the bottom is hung in the
+//				target's place.
+//   ARGUMENTS: const T1 &id - the id of the node that is to be deleted
+// USES GLOBAL: none
+// MODIFIES GL: root (possible), size
+//     RETURNS: bool - false if the ID is not in the tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool LockCoupledRBTree<T1, T2, Compare>::Delete(const T1 &id) {
+	int dir = 0;
+	Cursor C;
+	Held H;
+	LNode *dp = NULL; // pointer to the target node
+	LNode *Son;
+
+	headLock.lock();
+	H.head = true;
+	if (root == NULL) {
+		releaseAll(H);
+		return false;
+	}
+
+	// find the Node, then its in-order predecessor
+	C.X = root;
+	C.T = C.P = C.GP = NULL;
+	take(H, C.X);
+	while (true) {
+		if (dp == NULL) {
+			dir = compareID(id, C.X->ID);
+			if (dir == 0) {
+				dp = C.X;
+				dir = -1;
+			}
+		}
+		else
+			dir = 1;
+		dir = (dir < 0) ? -1 : 1;
+
+		// reorientation
+		if (!isRed(C.X) && !isRed(dir < 0 ? C.X->Lft : C.X->Rgt))
+			dHandleReorient(C, dir, H);
+
+		Son = (dir < 0) ? C.X->Lft : C.X->Rgt;
+		if (Son == NULL)
+			break;
+		C.GP = C.P;
+		C.P = C.X;
+		C.X = Son;
+		C.T = (dir < 0) ? C.P->Rgt : C.P->Lft;
+		take(H, C.X);
+		if (dp == NULL) {
+			if (H.head && (C.GP != NULL)) {
+				headLock.unlock();
+				H.head = false;
+			}
+			LNode * const keep[] = {C.GP, C.P, C.X, H.head ? root : NULL};
+			keepOnly(H, keep, 4);
+		}
+	}
+
+	// delete
+	if (dp != NULL) {
+		relink(C.P, C.X, (C.X->Lft != NULL) ? C.X->Lft : C.X->Rgt);
+		if (dp != C.X) {	// the predecessor takes the place of the target, nothing is copied
+			C.X->color = dp->color;
+			C.X->Lft = dp->Lft;
+			C.X->Rgt = dp->Rgt;
+			relink(fatherOf(H, dp), dp, C.X);
+		}
+
+		// no one else can reach the target, as its father is held
+		for (int i = 0; i < H.cnt; i++)
+			if (H.Nds[i] == dp) {
+				H.Nds[i] = H.Nds[--H.cnt];
+				break;
+			}
+		delete dp;
+		size.fetch_sub(1, memory_order_relaxed);
+	}
+
+	if (H.head && (root != NULL))
+		root->color = 0;
+	releaseAll(H);
+	return dp != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: empty
+// DESCRIPTION: To delete all the nodes. The root pointer is held so that no one
+//				else gets in, and every node is locked before it is freed, so the
+//				writers already inside finish first.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: root, size
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool LockCoupledRBTree<T1, T2, Compare>::empty() {
+	vector<LNode *> Stack;
+	headLock.lock();
+	if (root != NULL) {
+		root->lock.lock();
+		Stack.push_back(root);
+	}
+	root = NULL;
+	while (!Stack.empty()) {
+		LNode *X = Stack.back();
+		Stack.pop_back();
+		if (X->Lft != NULL) {
+			X->Lft->lock.lock();
+			Stack.push_back(X->Lft);
+		}
+		if (X->Rgt != NULL) {
+			X->Rgt->lock.lock();
+			Stack.push_back(X->Rgt);
+		}
+		delete X;
+	}
+	size.store(0, memory_order_relaxed);
+	headLock.unlock();
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: lookup
+// DESCRIPTION: To look for a node of a certain ID, with the locks shared and
+//				coupled: the son is taken before the father is let go of.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+//				T2 *rcd - where the record is copied to, NULL for none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if not found
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool LockCoupledRBTree<T1, T2, Compare>::lookup(const T1 &id, T2 *rcd) const {
+	headLock.lock_shared();
+	LNode *X = root;
+	if (X != NULL)
+		X->lock.lock_shared();
+	headLock.unlock_shared();
+	while (X != NULL) {
+		int dir = compareID(id, X->ID);
+		if (dir == 0) {
+			if (rcd != NULL)
+				*rcd = X->Rcd;
+			X->lock.unlock_shared();
+			return true;
+		}
+		LNode *Son = (dir < 0) ? X->Lft : X->Rgt;
+		if (Son != NULL)
+			Son->lock.lock_shared();
+		X->lock.unlock_shared();
+		X = Son;
+	}
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: firstFrom
+// DESCRIPTION: To copy out the first node whose ID is not less than "from", or
+//				greater than it, with the locks shared and coupled as in lookup.
+//   ARGUMENTS: const T1 &from - where to start
+//				bool inclusive - whether a node with ID "from" counts
+//				T1 &id - where the ID is copied to
+//				T2 &rcd - where the record is copied to
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if there is no such node
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool LockCoupledRBTree<T1, T2, Compare>::firstFrom(const T1 &from, bool inclusive, T1 &id, T2 &rcd) const {
+	bool Found = false;
+	headLock.lock_shared();
+	LNode *X = root;
+	if (X != NULL)
+		X->lock.lock_shared();
+	headLock.unlock_shared();
+	while (X != NULL) {
+		int dir = compareID(X->ID, from);
+		LNode *Son;
+		if ((dir > 0) || (inclusive && (dir == 0))) {
+			id = X->ID;
+			rcd = X->Rcd;
+			Found = true;
+			Son = X->Lft;
+		}
+		else
+			Son = X->Rgt;
+		if (Son != NULL)
+			Son->lock.lock_shared();
+		X->lock.unlock_shared();
+		X = Son;
+	}
+	return Found;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: forEachInRange
+// DESCRIPTION: To call "visitor" on every node with lo <= ID < hi. Each node is
+//				found by a descent of its own after the one before it, so no lock
+//				is held while the visitor runs, and the walk is not a snapshot:
+//				a node put in or taken out meanwhile may or may not be seen.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor visitor - called as visitor(const T1 &id, T2 &rcd) on
+//				copies, returns false to stop
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - true if the whole range was visited, false if stopped
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+template<class Visitor>
+bool LockCoupledRBTree<T1, T2, Compare>::forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const {
+	T1 From = lo, Next = lo;
+	T2 Rcd = T2();
+	bool inclusive = true;
+	while (firstFrom(From, inclusive, Next, Rcd) && (compareID(Next, hi) < 0)) {
+		if (!visitor((const T1 &)Next, Rcd))
+			return false;
+		From = Next;
+		inclusive = false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////Epoch Red-Black Tree/////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+class EpochReaders {	// a small number for each thread that reads an EpochRBTree, given back when the thread ends
+public:
+	static const int maxReaders = 128;
+	static int index();
+private:
+	class Owner {
+	public:
+		Owner() : slot(-2) {}
+		~Owner() { if (slot >= 0) taken()[slot].store(false, memory_order_release); }
+		int slot;	// -2 before the first read, -1 if every number was taken
+	};
+	static atomic<bool> *taken() { static atomic<bool> Taken[maxReaders]; return Taken; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: index
+// DESCRIPTION: To get the number of the calling thread, claimed on its first
+//				read and kept until it ends. It is the same for every tree, so a
+//				thread needs no setup to read a new one.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: the numbers taken
+//     RETURNS: int - -1 if maxReaders threads already have one
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+inline int EpochReaders::index() {
+	thread_local Owner Me;
+	if (Me.slot == -2) {
+		Me.slot = -1;
+		for (int i = 0; i < maxReaders; i++) {
+			bool Free = false;
+			if (!taken()[i].load(memory_order_relaxed) && taken()[i].compare_exchange_strong(Free, true, memory_order_acq_rel)) {
+				Me.slot = i;
+				break;
+			}
+		}
+	}
+	return Me.slot;
+}
+
+template<class T1, class T2 = NULLT, class Compare = CmpPtr<T1> >
+class EpochRBTree {	// a PersistentRBTree read with no lock: a change publishes a new version, and old ones are freed once no reader can be in them
+public :
+	typedef PersistentRBTree<T1, T2, Compare> Version;
+private :
+	struct alignas(64) ReaderSlot {	// one cache line per reader, written by that reader only
+		atomic<uint64_t> epoch;	// the epoch the reader came in at, 0 while it is not reading
+	};
+
+	atomic<Version *> cur;	// the version readers see
+	atomic<uint64_t> epoch;	// moved on by the writer after each version it retires
+	mutable ReaderSlot slots[EpochReaders::maxReaders];
+	mutable mutex writeLock;	// one writer at a time; also taken by readers left without a slot
+	vector<pair<uint64_t, Version *> > retired;	// old versions, with the epoch they were replaced in
+	int reclaimEvery;
+
+	int enter() const;
+	void leave(int slot) const;
+	void retire(Version *old);
+	void reclaim();
+
+	EpochRBTree(const EpochRBTree<T1, T2, Compare> &b);
+	EpochRBTree<T1, T2, Compare> &operator=(const EpochRBTree<T1, T2, Compare> &b);
+public :
+	EpochRBTree(int reclaimEvery = 64);
+	EpochRBTree(const Compare &compare, int reclaimEvery = 64);
+	~EpochRBTree();
+
+	template<class Change>
+	bool update(Change change);
+	bool Insert(const T1 &id) { return update([&id](Version &V) { return V.insert(id, T2()); }); }
+	bool insert(const T1 &id, const T2 &rcd) { return update([&id, &rcd](Version &V) { return V.insert(id, rcd); }); }
+	bool Delete(const T1 &id);
+	bool empty();
+
+	int getSize() const;
+	bool contains(const T1 &id) const;
+	bool find(const T1 &id, T2 &rcd) const;
+	template<class Visitor>
+	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: EpochRBTree
+// DESCRIPTION: Constructor of EpochRBTree class, with an empty version.
+//   ARGUMENTS: int reclaimEvery - how many versions are retired between two
+//				looks at the readers to free them
+// USES GLOBAL: none
+// MODIFIES GL: cur, epoch, slots, reclaimEvery
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+EpochRBTree<T1, T2, Compare>::EpochRBTree(int reclaimEvery) : cur(new Version()), epoch(1), reclaimEvery(MAX(1, reclaimEvery)) {
+	for (int i = 0; i < EpochReaders::maxReaders; i++)
+		slots[i].epoch.store(0, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: EpochRBTree
+// DESCRIPTION: Constructor of EpochRBTree class with a compare function.
+//   ARGUMENTS: const Compare &compare - the compare function
+//				int reclaimEvery - as above
+// USES GLOBAL: none
+// MODIFIES GL: cur, epoch, slots, reclaimEvery
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+EpochRBTree<T1, T2, Compare>::EpochRBTree(const Compare &compare, int reclaimEvery) : cur(new Version(compare)), epoch(1), reclaimEvery(MAX(1, reclaimEvery)) {
+	for (int i = 0; i < EpochReaders::maxReaders; i++)
+		slots[i].epoch.store(0, memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: ~EpochRBTree
+// DESCRIPTION: Destructor of EpochRBTree class. No one may still be reading.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: cur, retired
+//     RETURNS: none
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+EpochRBTree<T1, T2, Compare>::~EpochRBTree() {
+	for (size_t i = 0; i < retired.size(); i++)
+		delete retired[i].second;
+	delete cur.load(memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: enter
+// DESCRIPTION: To start a read: the reader writes the epoch into its own slot,
+//				with a full fence before it loads the version, so that either
+//				the writer sees the slot or the reader sees the newer version.
+//				Nothing shared is locked or changed. A thread left without a
+//				slot takes the writer's lock instead.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: slots
+//     RETURNS: int - the slot to give to leave, -1 for the lock
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+int EpochRBTree<T1, T2, Compare>::enter() const {
+	int Slot = EpochReaders::index();
+	if (Slot < 0) {
+		writeLock.lock();
+		return -1;
+	}
+	slots[Slot].epoch.store(epoch.load(memory_order_acquire), memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	return Slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: leave
+// DESCRIPTION: To end a read, after which the version may be freed.
+//   ARGUMENTS: int slot - what enter returned
+// USES GLOBAL: none
+// MODIFIES GL: slots
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void EpochRBTree<T1, T2, Compare>::leave(int slot) const {
+	if (slot < 0)
+		writeLock.unlock();
+	else
+		slots[slot].epoch.store(0, memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: retire
+// DESCRIPTION: To put a replaced version aside with the current epoch, and move
+//				the epoch on. A reader that comes in at a later epoch has loaded
+//				the newer version, so only readers at this epoch or before can
+//				still be in the old one.
+//   ARGUMENTS: Version *old - the version replaced
+// USES GLOBAL: none
+// MODIFIES GL: epoch, retired
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void EpochRBTree<T1, T2, Compare>::retire(Version *old) {
+	uint64_t E = epoch.load(memory_order_relaxed);
+	retired.push_back(pair<uint64_t, Version *>(E, old));
+	epoch.store(E + 1, memory_order_release);
+	if ((int)retired.size() >= reclaimEvery)
+		reclaim();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: reclaim
+// DESCRIPTION: To free the retired versions that no reader can be in: those
+//				retired in an epoch before the oldest one a reader is in. The
+//				nodes they share with newer versions are kept by their counts.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: retired
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+void EpochRBTree<T1, T2, Compare>::reclaim() {
+	atomic_thread_fence(memory_order_seq_cst);
+	uint64_t Oldest = UINT64_MAX;
+	for (int i = 0; i < EpochReaders::maxReaders; i++) {
+		uint64_t E = slots[i].epoch.load(memory_order_acquire);
+		if ((E != 0) && (E < Oldest))
+			Oldest = E;
+	}
+	size_t Kept = 0;
+	for (size_t i = 0; i < retired.size(); i++)
+		if (retired[i].first < Oldest)
+			delete retired[i].second;
+		else
+			retired[Kept++] = retired[i];
+	retired.resize(Kept);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: update
+// DESCRIPTION: To make changes in a copy of the current version, which shares
+//				all its nodes, and publish it with one release store. Readers see
+//				the changes all at once, or not at all. Writers wait for each
+//				other; readers never wait for them.
+//   ARGUMENTS: Change change - called as change(Version &V), returns false if
+//				nothing changed, in which case nothing is published
+// USES GLOBAL: none
+// MODIFIES GL: cur, epoch, retired
+//     RETURNS: bool - what "change" returned
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+template<class Change>
+bool EpochRBTree<T1, T2, Compare>::update(Change change) {
+	lock_guard<mutex> guard(writeLock);
+	Version *Old = cur.load(memory_order_relaxed);
+	Version *New = new (std::nothrow) Version(*Old);
+	if (New == NULL)
+		throw NodeERR("Out of space");
+	if (!change(*New)) {
+		delete New;
+		return false;
+	}
+	cur.store(New, memory_order_release);
+	retire(Old);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: Delete
+// DESCRIPTION: Deleting a node, in a new version.
+//   ARGUMENTS: const T1 &id - the id of the node that is to be deleted
+// USES GLOBAL: none
+// MODIFIES GL: cur, epoch, retired
+//     RETURNS: bool - false if the ID is not in the tree
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool EpochRBTree<T1, T2, Compare>::Delete(const T1 &id) {
+	return update([&id](Version &V) {
+		int Before = V.getSize();
+		V.Delete(id);
+		return V.getSize() != Before;
+	});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: empty
+// DESCRIPTION: To publish an empty version. The nodes go with the old one.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: cur, epoch, retired
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool EpochRBTree<T1, T2, Compare>::empty() {
+	update([](Version &V) { return V.empty(); });
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: getSize
+// DESCRIPTION: To get the number of nodes of the current version.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+int EpochRBTree<T1, T2, Compare>::getSize() const {
+	int Slot = enter();
+	int Size = cur.load(memory_order_acquire)->getSize();
+	leave(Slot);
+	return Size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: contains
+// DESCRIPTION: To tell whether a node of a certain ID is in the current version,
+//				with no lock.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool EpochRBTree<T1, T2, Compare>::contains(const T1 &id) const {
+	int Slot = enter();
+	bool Found = cur.load(memory_order_acquire)->find(id) != NULL;
+	leave(Slot);
+	return Found;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: find
+// DESCRIPTION: To copy out the record of a node of a certain ID, with no lock.
+//				The record is copied before the read ends, as the version may be
+//				freed after it.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+//				T2 &rcd - where the record is copied to
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if not found
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+bool EpochRBTree<T1, T2, Compare>::find(const T1 &id, T2 &rcd) const {
+	int Slot = enter();
+	const T2 *Tmp = cur.load(memory_order_acquire)->find(id);
+	if (Tmp != NULL)
+		rcd = *Tmp;
+	leave(Slot);
+	return Tmp != NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: forEachInRange
+// DESCRIPTION: To call "visitor" on every node with lo <= ID < hi, with no lock.
+//				The whole walk is in one version, so it is a consistent snapshot;
+//				retired versions are not freed until it ends. The visitor must
+//				not call back into the tree.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor visitor - called as visitor(const T1 &id, const T2 &rcd),
+//				returns false to stop
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - true if the whole range was visited, false if stopped
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class Compare>
+template<class Visitor>
+bool EpochRBTree<T1, T2, Compare>::forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const {
+	int Slot = enter();
+	bool Done = cur.load(memory_order_acquire)->forEachInRange(lo, hi, visitor);
+	leave(Slot);
+	return Done;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////Sharded Red-Black Tree///////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////
+
+enum ShardRouting {	// how a ShardedRBTree picks the shard of a key
+	SHARD_BY_HASH,	// by Hash, so the load spreads whatever the keys are
+	SHARD_BY_RANGE	// by bounds in ID order, so a range lives in few shards and can be moved
+};
+
+template<class T1, class T2 = NULLT, class S = RcdInline, class L = PlainLinks, class Compare = CmpPtr<T1>, class Hash = std::hash<T1> >
+class ShardedRBTree {	// N independent RBTrees, each behind a lock of its own, with every ID in exactly one of them
+private :
+	class alignas(64) Shard {	// a tree with its own node pools and lock, on cache lines of its own
+	public:
+		Shard(const Compare &compare) : tree(compare) {}
+		RBTree<T1, T2, S, L, Compare> tree;
+		mutable shared_mutex lock;
+	};
+	class Routing {	// never changed once published; moveBound publishes a new one
+	public:
+		vector<T1> bounds;	// under SHARD_BY_RANGE, shard i holds [bounds[i - 1], bounds[i])
+	};
+	struct alignas(64) ReaderSlot {	// one cache line per thread, written by that thread only
+		atomic<uint64_t> epoch;	// the epoch the thread came in at, 0 while it is not routing
+	};
+
+	vector<unique_ptr<Shard> > shards;
+	ShardRouting mode;
+	atomic<const Routing *> routing;
+	atomic<uint64_t> epoch;	// moved on by moveBound after each table it retires
+	mutable ReaderSlot slots[EpochReaders::maxReaders];
+	mutable mutex moveLock;	// one moveBound at a time; also taken by threads left without a slot
+	vector<pair<uint64_t, const Routing *> > retired;	// old tables, with the epoch they were replaced in
+	Hash hash;
+	Compare cmp;
+
+	int compareID(const T1 &a, const T1 &b) const { return CmpTraits<Compare, T1>::threeWay(cmp, a, b); }
+	int shardOf(const Routing *R, const T1 &id) const;
+	template<class Op>
+	bool withShard(const T1 &id, bool exclusive, Op op) const;
+	int enter() const;
+	void leave(int slot) const;
+	void retire(const Routing *old);
+
+	ShardedRBTree(const ShardedRBTree<T1, T2, S, L, Compare, Hash> &b);
+	ShardedRBTree<T1, T2, S, L, Compare, Hash> &operator=(const ShardedRBTree<T1, T2, S, L, Compare, Hash> &b);
+public :
+	ShardedRBTree(int shardCnt = 0, const Compare &compare = Compare(), const Hash &h = Hash());
+	ShardedRBTree(const vector<T1> &bounds, const Compare &compare = Compare());
+	~ShardedRBTree();
+
+	bool Insert(const T1 &id);
+	bool insert(const T1 &id, const T2 &rcd);
+	bool Delete(const T1 &id);
+	bool empty();
+	bool moveBound(int i, const T1 &bound);
+
+	int getShardCnt() const { return (int)shards.size(); }
+	int getShardSize(int i) const;
+	int getSize() const;
+	bool contains(const T1 &id) const;
+	bool find(const T1 &id, T2 &rcd) const;
+	template<class Visitor>
+	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: ShardedRBTree
+// DESCRIPTION: Constructor of ShardedRBTree class, routing by hash.
+//   ARGUMENTS: int shardCnt - the number of shards, 0 for one per core
+//				const Compare &compare - the compare function of every shard
+//				const Hash &h - the hash of an ID
+// USES GLOBAL: none
+// MODIFIES GL: shards, mode, routing, epoch, slots, hash, cmp
+//     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-21
-//							KC 2015-02-21
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::rotateRL(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getRgt();
-	Node<T1, T2> *N3 = N2->getLft();
-	N2->AddLft(N3->getRgt());
-	N1->AddRgt(N3->getLft());
-	N3->AddLft(N1);
-	N3->AddRgt(N2);
-	return N3;
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+ShardedRBTree<T1, T2, S, L, Compare, Hash>::ShardedRBTree(int shardCnt, const Compare &compare, const Hash &h) : mode(SHARD_BY_HASH), routing(new Routing()), epoch(1), hash(h), cmp(compare) {
+	if (shardCnt <= 0)
+		shardCnt = MAX(1, (int)thread::hardware_concurrency());
+	for (int i = 0; i < shardCnt; i++)
+		shards.push_back(unique_ptr<Shard>(new Shard(compare)));
+	for (int i = 0; i < EpochReaders::maxReaders; i++)
+		slots[i].epoch.store(0, memory_order_relaxed);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: iRotateLL
-// DESCRIPTION: The single rotation LL and recoloring of RB tree used for Insertion.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: ShardedRBTree
+// DESCRIPTION: Constructor of ShardedRBTree class, routing by ID ranges: one
+//				shard more than there are bounds.
+//   ARGUMENTS: const vector<T1> &bounds - the least ID of each shard but the
+//				first, in increasing order
+//				const Compare &compare - the compare function of every shard
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: shards, mode, routing, epoch, slots, cmp
+//     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::iRotateLL(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getLft();
-	N1->setColor(1 - N1->getColor());
-	N2->setColor(1 - N2->getColor());
-	return rotateLL(N1);
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+ShardedRBTree<T1, T2, S, L, Compare, Hash>::ShardedRBTree(const vector<T1> &bounds, const Compare &compare) : mode(SHARD_BY_RANGE), routing(NULL), epoch(1), cmp(compare) {
+	for (size_t i = 1; i < bounds.size(); i++)
+		if (compareID(bounds[i - 1], bounds[i]) >= 0)
+			throw RBERR("Shard bounds out of order");
+	for (size_t i = 0; i <= bounds.size(); i++)
+		shards.push_back(unique_ptr<Shard>(new Shard(compare)));
+	for (int i = 0; i < EpochReaders::maxReaders; i++)
+		slots[i].epoch.store(0, memory_order_relaxed);
+	Routing *R = new Routing();
+	R->bounds = bounds;
+	routing.store(R, memory_order_release);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: iRotateRR
-// DESCRIPTION: The single rotation RR and recoloring of RB tree used for Insertion.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: ~ShardedRBTree
+// DESCRIPTION: Destructor of ShardedRBTree class. No one may still be using it.
+//   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: routing, retired
+//     RETURNS: none
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::iRotateRR(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getRgt();
-	N1->setColor(1 - N1->getColor());
-	N2->setColor(1 - N2->getColor());
-	return rotateRR(N1);
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+ShardedRBTree<T1, T2, S, L, Compare, Hash>::~ShardedRBTree() {
+	for (size_t i = 0; i < retired.size(); i++)
+		delete retired[i].second;
+	delete routing.load(memory_order_relaxed);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: iRotateLR
-// DESCRIPTION: The double rotation LR and recoloring of RB tree used for Insertion.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: shardOf
+// DESCRIPTION: To find the shard of an ID: its hash modulo the number of shards,
+//				or the number of bounds not greater than it.
+//   ARGUMENTS: const Routing *R - the routing table
+//				const T1 &id - the ID
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: none
+//     RETURNS: int
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::iRotateLR(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getLft();
-	Node<T1, T2> *N3 = N2->getRgt();
-	N1->setColor(1 - N1->getColor());
-	N3->setColor(1 - N3->getColor());
-	return rotateLR(N1);
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+int ShardedRBTree<T1, T2, S, L, Compare, Hash>::shardOf(const Routing *R, const T1 &id) const {
+	if (mode == SHARD_BY_HASH)
+		return (int)(hash(id) % shards.size());
+	int lo = 0, hi = (int)R->bounds.size();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (compareID(id, R->bounds[mid]) < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: iRotateRL
-// DESCRIPTION: The double rotation RL and recoloring of RB tree used for Insertion.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: withShard
+// DESCRIPTION: To call "op" on the tree of the shard of an ID, with its lock
+//				held. If the routing changed while the lock was waited for, the
+//				ID may have moved, so it is routed again. The table is kept from
+//				being freed by enter until the lock is held and it is checked.
+//   ARGUMENTS: const T1 &id - the ID
+//				bool exclusive - true to hold the lock on its own, false to share it
+//				Op op - called as op(RBTree &tree), returns bool
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: none
+//     RETURNS: bool - what "op" returned
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::iRotateRL(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getRgt();
-	Node<T1, T2> *N3 = N2->getLft();
-	N1->setColor(1 - N1->getColor());
-	N3->setColor(1 - N3->getColor());
-	return rotateRL(N1);
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+template<class Op>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::withShard(const T1 &id, bool exclusive, Op op) const {
+	while (true) {
+		int Slot = enter();
+		const Routing *R = routing.load(memory_order_acquire);
+		Shard &Sh = *shards[shardOf(R, id)];
+		if (exclusive) {
+			unique_lock<shared_mutex> guard(Sh.lock);
+			bool Same = (routing.load(memory_order_acquire) == R);
+			leave(Slot);
+			if (Same)
+				return op(Sh.tree);
+		}
+		else {
+			shared_lock<shared_mutex> guard(Sh.lock);
+			bool Same = (routing.load(memory_order_acquire) == R);
+			leave(Slot);
+			if (Same)
+				return op(Sh.tree);
+		}
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: dRotateLL
-// DESCRIPTION: The single rotation LL and recoloring of RB tree used for Deletion.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: enter
+// DESCRIPTION: To start routing: the thread writes the epoch into its own slot,
+//				with a full fence before it loads the table, so that either
+//				moveBound sees the slot or the thread sees the newer table. A
+//				thread left without a slot takes moveLock instead, which it may
+//				hold while it waits for a shard lock, as moveBound takes moveLock
+//				before the shard locks. Under SHARD_BY_HASH the table is never
+//				replaced, so nothing is done.
+//   ARGUMENTS: none
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: slots
+//     RETURNS: int - the slot to give to leave, -1 for the lock, -2 for nothing
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::dRotateLL(Node<T1, T2> *N1) {
-	Node<T1, T2> *NL = N1->getLft();
-	Node<T1, T2> *NR = N1->getRgt();
-	Node<T1, T2> *NLL = NL->getLft();
-
-	N1->setColor(1 - N1->getColor());
-	if (NL != NULL)
-		NL->setColor(1 - NL->getColor());
-	if (NR != NULL)
-		NR->setColor(1 - NR->getColor());
-	if (NLL != NULL)
-		NLL->setColor(1 - NLL->getColor());
-
-	return rotateLL(N1);
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+int ShardedRBTree<T1, T2, S, L, Compare, Hash>::enter() const {
+	if (mode != SHARD_BY_RANGE)
+		return -2;
+	int Slot = EpochReaders::index();
+	if (Slot < 0) {
+		moveLock.lock();
+		return -1;
+	}
+	slots[Slot].epoch.store(epoch.load(memory_order_acquire), memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	return Slot;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: leave
+// DESCRIPTION: To end routing, after which the table may be freed.
+//   ARGUMENTS: int slot - what enter returned
+// USES GLOBAL: none
+// MODIFIES GL: slots
+//     RETURNS: void
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+void ShardedRBTree<T1, T2, S, L, Compare, Hash>::leave(int slot) const {
+	if (slot == -1)
+		moveLock.unlock();
+	else if (slot >= 0)
+		slots[slot].epoch.store(0, memory_order_release);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: dRotateRR
-// DESCRIPTION: The single rotation RR and recoloring of RB tree used for Deletion.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: retire
+// DESCRIPTION: To put a replaced table aside with the current epoch, move the
+//				epoch on, and free the tables retired in an epoch before the
+//				oldest one a thread is routing in. moveLock must be held.
+//   ARGUMENTS: const Routing *old - the table replaced
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: epoch, retired
+//     RETURNS: void
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::dRotateRR(Node<T1, T2> *N1) {
-	Node<T1, T2> *NL = N1->getLft();
-	Node<T1, T2> *NR = N1->getRgt();
-	Node<T1, T2> *NRR = NR->getRgt();
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+void ShardedRBTree<T1, T2, S, L, Compare, Hash>::retire(const Routing *old) {
+	uint64_t E = epoch.load(memory_order_relaxed);
+	retired.push_back(pair<uint64_t, const Routing *>(E, old));
+	epoch.store(E + 1, memory_order_release);
 
-	N1->setColor(1 - N1->getColor());
-	if (NL != NULL)
-		NL->setColor(1 - NL->getColor());
-	if (NR != NULL)
-		NR->setColor(1 - NR->getColor());
-	if (NRR != NULL)
-		NRR->setColor(1 - NRR->getColor());
-	return rotateRR(N1);
+	atomic_thread_fence(memory_order_seq_cst);
+	uint64_t Oldest = UINT64_MAX;
+	for (int i = 0; i < EpochReaders::maxReaders; i++) {
+		uint64_t Tmp = slots[i].epoch.load(memory_order_acquire);
+		if ((Tmp != 0) && (Tmp < Oldest))
+			Oldest = Tmp;
+	}
+	size_t Kept = 0;
+	for (size_t i = 0; i < retired.size(); i++)
+		if (retired[i].first < Oldest)
+			delete retired[i].second;
+		else
+			retired[Kept++] = retired[i];
+	retired.resize(Kept);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: dRotateLR
-// DESCRIPTION: The double rotation LR and recoloring of RB tree used for Deletion.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: Insert
+// DESCRIPTION: Inserting a node into its shard.
+//   ARGUMENTS: const T1 &id - the id of the new node that is to be inserted
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: shards
+//     RETURNS: bool - false if the ID is already in the tree
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::dRotateLR(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2 = N1->getRgt();
-	N1->setColor(1 - N1->getColor());
-	if (N2 != NULL)
-		N2->setColor(1 - N2->getColor());
-	return rotateLR(N1);
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::Insert(const T1 &id) {
+	return withShard(id, true, [&id](RBTree<T1, T2, S, L, Compare> &tree) {
+		int Before = tree.getSize();
+		tree.Insert(id);
+		return tree.getSize() != Before;
+	});
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: dRotateRL
-// DESCRIPTION: The double rotation RL and recoloring of RB tree used for Deletion.
-//   ARGUMENTS: Node<T1, T2> *N1 - the trouble finder node
+//        NAME: insert
+// DESCRIPTION: Inserting a node with a record into its shard. An existing
+//				record is left as it is.
+//   ARGUMENTS: const T1 &id - the id of the new node
+//				const T2 &rcd - the record of the new node
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: shards
+//     RETURNS: bool - whether the node is new
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-28
-//							KC 2015-02-28
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-Node<T1, T2>* RBTree<T1, T2>::dRotateRL(Node<T1, T2> *N1) {
-	Node<T1, T2> *N2= N1->getLft();
-	N1->setColor(1 - N1->getColor());
-	if (N2 != NULL)
-		N2->setColor(1 - N2->getColor());
-	return rotateRL(N1);
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::insert(const T1 &id, const T2 &rcd) {
+	return withShard(id, true, [&id, &rcd](RBTree<T1, T2, S, L, Compare> &tree) {
+		return tree.insert(id, rcd).second;
+	});
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: iHandleReorient
-// DESCRIPTION: handle the reorientation including recoloring and rotation for insertion
-//   ARGUMENTS: none 
+//        NAME: Delete
+// DESCRIPTION: Deleting a node from its shard.
+//   ARGUMENTS: const T1 &id - the id of the node that is to be deleted
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: Node<T1, T2>*
+// MODIFIES GL: shards
+//     RETURNS: bool - false if the ID is not in the tree
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-23
-//							KC 2015-02-23
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::iHandleReorient() {
-
-	// recoloring
-	X->setColor(1);
-	if (X->getLft() != NULL)
-		X->getLft()->setColor(0);
-	if (X->getRgt() != NULL)
-		X->getRgt()->setColor(0);
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::Delete(const T1 &id) {
+	return withShard(id, true, [&id](RBTree<T1, T2, S, L, Compare> &tree) {
+		int Before = tree.getSize();
+		tree.Delete(id);
+		return tree.getSize() != Before;
+	});
+}
 
-	if ((P != X) && (P->getColor() == 1)) {	// rotation
-		int Case = (cmp(X->getID(), P->getID()) < 0) + ((cmp(P->getID(), GP->getID()) < 0) << 1);
-		switch(Case) {
-		case 0:	// single rotate with right
-			if (GP == GGP)
-				root = iRotateRR(GP);
-			else if (cmp(GP->getID(), GGP->getID()) < 0)
-				GGP->AddLft(iRotateRR(GP));
-			else
-				GGP->AddRgt(iRotateRR(GP));
-			break;
-		case 1:	// double rotate right-left
-			if (GP == GGP)
-				root = iRotateRL(GP);
-			else if (cmp(GP->getID(), GGP->getID()) < 0)
-				GGP->AddLft(iRotateRL(GP));
-			else
-				GGP->AddRgt(iRotateRL(GP));
-			break;
-		case 2: // double rotate left-right
-			if (GP == GGP)
-				root = iRotateLR(GP);
-			else if (cmp(GP->getID(), GGP->getID()) < 0)
-				GGP->AddLft(iRotateLR(GP));
-			else
-				GGP->AddRgt(iRotateLR(GP));
-			break;
-		case 3: // single rotate with right
-			if (GP == GGP)
-				root = iRotateLL(GP);
-			else if (cmp(GP->getID(), GGP->getID()) < 0)
-				GGP->AddLft(iRotateLL(GP));
-			else
-				GGP->AddRgt(iRotateLL(GP));
-			break;
-		default:
-			throw RBERR("Case out of range");
-			return false;
-		}
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: empty
+// DESCRIPTION: To delete all the nodes, one shard at a time.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: shards
+//     RETURNS: bool
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::empty() {
+	for (size_t i = 0; i < shards.size(); i++) {
+		unique_lock<shared_mutex> guard(shards[i]->lock);
+		shards[i]->tree.empty();
 	}
-
-	root->setColor(0);
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: Insert
-// DESCRIPTION: Inserting a node into the RB tree.
-//   ARGUMENTS: const T1 &id - the id of the new node that is to be inserted
+//        NAME: moveBound
+// DESCRIPTION: To move the bound between shard i and shard i + 1 while the
+//				tree is in use, and the IDs between the old and the new bound
+//				with it. Only these two shards are locked; the nodes are moved
+//				by split and join, not copied, which costs O(log n) under
+//				Counted<L> and a walk of the moved nodes otherwise. The new
+//				routing is published before the locks are let go of, and the
+//				old one retired.
+//   ARGUMENTS: int i - the shard on the left of the bound
+//				const T1 &bound - the new least ID of shard i + 1
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: bool
+// MODIFIES GL: shards, routing, epoch, retired
+//     RETURNS: bool - false if the tree routes by hash, "i" is out of range or
+//				"bound" is not between the bounds next to it
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-23
-//							KC 2015-02-23
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::Insert(const T1 &id) {
-	// special case (NULL tree) handling
-	if (root == NULL) {
-		root = new Node<T1, T2>(id);
-		if (root == NULL) {
-			throw RBERR("Out of space");
-			return false;
-		}
-		++size;
-		return true;
-	}
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::moveBound(int i, const T1 &bound) {
+	if ((mode != SHARD_BY_RANGE) || (i < 0) || (i + 1 >= (int)shards.size()))
+		return false;
+	lock_guard<mutex> guard(moveLock);
+	const Routing *R = routing.load(memory_order_acquire);
+	if ((i > 0) && (compareID(R->bounds[i - 1], bound) >= 0))
+		return false;
+	if ((i + 2 < (int)shards.size()) && (compareID(bound, R->bounds[i + 1]) >= 0))
+		return false;
 
-	// find the right place to insert
-	X = P = GP = GGP = root;
-	while ((X != NULL) && (cmp(X->getID(), id) != 0)) {
-		if (((X->getLft() != NULL) && (X->getLft()->getColor() == 1)) && ((X->getRgt() != NULL) && (X->getRgt()->getColor() == 1)))
-			iHandleReorient();
-		GGP = GP;
-		GP = P;
-		P = X;
-		if (cmp(X->getID(), id) > 0)
-			X = X->getLft();
-		else
-			X = X->getRgt();
+	unique_lock<shared_mutex> guardL(shards[i]->lock), guardR(shards[i + 1]->lock);	// in shard order, as forEachInRange takes them
+	RBTree<T1, T2, S, L, Compare> &Lft = shards[i]->tree, &Rgt = shards[i + 1]->tree;
+	RBTree<T1, T2, S, L, Compare> Mid(cmp);
+	int dir = compareID(bound, R->bounds[i]);
+	if (dir < 0) {	// [bound, old bound) goes right
+		Lft.split(bound, Lft, Mid);
+		Rgt.join(Mid, Rgt);
 	}
-
-	// if the Node already exists
-	if (X != NULL)
-		return true;
-
-	// create a new Node and concatenate it on the tree
-	X = new Node<T1, T2>(id);
-	if (X == NULL) {
-		throw RBERR("Out of space");
-		return false;
+	else if (dir > 0) {	// [old bound, bound) goes left
+		Rgt.split(bound, Mid, Rgt);
+		Lft.join(Lft, Mid);
 	}
-	X->setColor(1);
-	++size;
-	if (cmp(id, P->getID()) < 0)
-		P->AddLft(X);
-	else
-		P->AddRgt(X);
-	if (P->getColor() == 1)
-		iHandleReorient();
 
+	Routing *New = new Routing(*R);
+	New->bounds[i] = bound;
+	routing.store(New, memory_order_release);
+	guardR.unlock();
+	guardL.unlock();
+	retire(R);
 	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: dHandleReorient
-// DESCRIPTION: handle the reorientation including recoloring and rotation for deletion
-//   ARGUMENTS: int dir - indicate the direction X is moving towards 
+//        NAME: getShardSize
+// DESCRIPTION: To get the number of nodes in one shard, to decide on moveBound.
+//   ARGUMENTS: int i - the shard
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
-//     RETURNS: bool
+// MODIFIES GL: none
+//     RETURNS: int - -1 if "i" is out of range
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-26
-//							KC 2015-02-26
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::dHandleReorient(int dir) {
-	int Case = 0;
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+int ShardedRBTree<T1, T2, S, L, Compare, Hash>::getShardSize(int i) const {
+	if ((i < 0) || (i >= (int)shards.size()))
+		return -1;
+	shared_lock<shared_mutex> guard(shards[i]->lock);
+	return shards[i]->tree.getSize();
+}
 
-	// decide the cases
-	if (((X->getLft() != NULL) && (X->getLft()->getColor() == 1)) || ((X->getRgt() != NULL) && (X->getRgt()->getColor() == 1))) {
-		Case |= 4;
-		if ((dir == -1) && (X->getLft() != NULL) && (X->getLft()->getColor() == 1))
-			Case |= 1;
-		if ((dir == 1) && (X->getRgt() != NULL) && (X->getRgt()->getColor() == 1))
-			Case |= 1;
-	}
-	else {
-		if ((T->getLft() != NULL) && (T->getLft()->getColor() == 1))
-			Case |= 1;
-		else if ((T->getRgt() != NULL) && (T->getRgt()->getColor() == 1))
-			Case |= 2;
-	}
-
-	// execute with respect to case
-	switch(Case) {
-	case 0:	// case 2A1
-		P->setColor(0);
-		X->setColor(1);
-		T->setColor(1);
-		return true;
-	case 1:	// case 2A2
-		if (cmp(X->getID(), P->getID()) < 0) {	// T is on the right, double rotation
-			if (P == GP)
-				root = dRotateRL(P);
-			else if (cmp(P->getID(), GP->getID()) < 0)
-				GP->AddLft(dRotateRL(P));
-			else
-				GP->AddRgt(dRotateRL(P));
-		}
-		else {	// T is on the left, single rotation
-			if (P == GP)
-				root = dRotateLL(P);
-			else if (cmp(P->getID(), GP->getID()) < 0)
-				GP->AddLft(dRotateLL(P));
-			else
-				GP->AddRgt(dRotateLL(P));
-		}
-		X->setColor(1);
-		return true;
-	case 2:	// case 2A3
-		if (cmp(X->getID(), P->getID()) < 0) {	// T is on the right, single rotation
-			if (P == GP)
-				root = dRotateRR(P);
-			else if (cmp(P->getID(), GP->getID()) < 0)
-				GP->AddLft(dRotateRR(P));
-			else
-				GP->AddRgt(dRotateRR(P));
-		}
-		else {	// T is on the left, double rotation
-			if (P == GP)
-				root = dRotateLR(P);
-			else if (cmp(P->getID(), GP->getID()) < 0)
-				GP->AddLft(dRotateLR(P));
-			else
-				GP->AddRgt(dRotateLR(P));
-		}
-		X->setColor(1);
-		return true;
-	case 4:	// case 2B2
-		// move down
-		GP = P;
-		P = X;
-		if (dir < 0) {
-			X = P->getLft();
-			T = P->getRgt();
-			// rotate
-			if (P == GP)
-				root = dRotateRR(P);
-			else if (cmp(P->getID(), GP->getID()) < 0)
-				GP->AddLft(dRotateRR(P));
-			else
-				GP->AddRgt(dRotateRR(P));
-
-			// roll back
-			X = P;
-			P = T;
-			T = P->getRgt();
-		}
-		else {
-			X = P->getRgt();
-			T = P->getLft();
-			// rotate
-			if (P == GP)
-				root = dRotateLL(P);
-			if (cmp(P->getID(), GP->getID()) < 0)
-				GP->AddLft(dRotateLL(P));
-			else
-				GP->AddRgt(dRotateLL(P));
-
-			// roll back
-			X = P;
-			P = T;
-			T = P->getLft();
-		}
-		return true;
-	case 5:	// case 2B1
-		return true;
-	default:
-		throw RBERR("case out of range");
-		return false;
-	}
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: getSize
+// DESCRIPTION: To get the number of nodes, adding up the shards one at a time.
+//   ARGUMENTS: none
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: int
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+int ShardedRBTree<T1, T2, S, L, Compare, Hash>::getSize() const {
+	int Size = 0;
+	for (size_t i = 0; i < shards.size(); i++)
+		Size += getShardSize((int)i);
+	return Size;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: Delete
-// DESCRIPTION: Deleting a node from the RB tree.
-//   ARGUMENTS: const T1 &id - the id of the new node that is to be deleted
+//        NAME: contains
+// DESCRIPTION: To tell whether a node of a certain ID is in its shard, with the
+//				lock of the shard shared.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
 // USES GLOBAL: none
-// MODIFIES GL: root (possible)
+// MODIFIES GL: none
 //     RETURNS: bool
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-27
-//							KC 2015-02-27
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::Delete(const T1 &id) {
-	int Case = -1;
-	Node<T1, T2> *dp = NULL; // pointer to the target node's father
-
-	if (root == NULL)
-		return true;
-	
-	// find the Node
-	GP = P = X = T = root;
-	while ((X != NULL) && (cmp(id, X->getID()) != 0)) {
-		if (X->getColor() == 0)
-			dHandleReorient(cmp(id, X->getID()));
-		GP = P;
-		P = X;
-		if (cmp(id, X->getID()) < 0) {
-			X = X->getLft();
-			T = P->getRgt();
-		}
-		else {
-			X = X->getRgt();
-			T = P->getLft();
-		}
-	}
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::contains(const T1 &id) const {
+	return withShard(id, false, [&id](RBTree<T1, T2, S, L, Compare> &tree) {
+		return tree.find(id) != NULL;
+	});
+}
 
-	// not found
-	if (X == NULL)
+////////////////////////////////////////////////////////////////////////////////
+//        NAME: find
+// DESCRIPTION: To copy out the record of a node of a certain ID, with the lock
+//				of its shard shared.
+//   ARGUMENTS: const T1 &id - the ID of the node that we want to find
+//				T2 &rcd - where the record is copied to
+// USES GLOBAL: none
+// MODIFIES GL: none
+//     RETURNS: bool - false if not found
+//      AUTHOR: Kingston Chan
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
+////////////////////////////////////////////////////////////////////////////////
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::find(const T1 &id, T2 &rcd) const {
+	return withShard(id, false, [&id, &rcd](RBTree<T1, T2, S, L, Compare> &tree) {
+		const T2 *Tmp = tree.find(id);
+		if (Tmp == NULL)
+			return false;
+		rcd = *Tmp;
 		return true;
-	
-	dp = X;	// mark the target's father
-	
-	// delete
-	Case = ((X->getRgt() != NULL) << 1) + (X->getLft() != NULL);
-	switch(Case) {
-	case 0: // X is a leaf
-		// reorientation
-		if (X->getColor() == 0)
-			dHandleReorient(0);
-		// delete the node
-		if (cmp(X->getID(), P->getID()) < 0)
-			P->AddLft(NULL);
-		else
-			P->AddRgt(NULL);
-		// release the space
-		delete X;
-		X = NULL;
-		break;
-	case 1: // X has a left son
-		// reorientation
-		if (X->getColor() == 0)
-			dHandleReorient(-1);
-		// delete the root
-		if (cmp(X->getID(), P->getID()) < 0)
-			P->AddLft(X->getLft());
-		else
-			P->AddRgt(X->getLft());
-		// release the space
-		X->AddLft(NULL);
-		delete X;
-		X = NULL;
-		break;
-	case 2: // X has a right son
-		// reorientation
-		if (X->getColor() == 0)
-			dHandleReorient(1);
-		// delete the root
-		if (cmp(X->getID(), P->getID()) < 0)
-			P->AddLft(X->getRgt());
-		else
-			P->AddRgt(X->getRgt());
-		// release the space
-		X->AddRgt(NULL);
-		delete X;
-		X = NULL;
-		break;
-	case 3: // X has both left and right son
-		// reorientation
-		if (X->getColor() == 0)
-			dHandleReorient(-1);
-		// find the in-order predecessor
-		GP = P;
-		P = X;
-		X = X->getLft();
-		T = P->getRgt();
-		if (X->getColor() == 0)
-			dHandleReorient(1);
-		while (X->getRgt() != NULL) {
-			GP = P;
-			P = X;
-			X = X->getRgt();
-			T = P->getLft();
-			if (X->getColor() == 0)
-				dHandleReorient(1);
-		}
-		// delete
-		if (cmp(X->getID(), P->getID()) < 0)
-			P->AddLft(X->getLft());
-		else
-			P->AddRgt(X->getLft());
-		X->AddLft(NULL);
-		*dp = *X;
-		delete X;
-		break;
-	default:
-		throw RBERR("Case out of range");
-		return false;
-	}
-	if (root != NULL)
-		root->setColor(0);
-	return true;
+	});
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-//        NAME: print
-// DESCRIPTION: print a tree with inorder traversal.
-//   ARGUMENTS: none
+//        NAME: forEachInRange
+// DESCRIPTION: To call "visitor" on every node with lo <= ID < hi, in ID order,
+//				merging the ordered output of the shards: all of them under
+//				SHARD_BY_HASH, the ones the range falls in under SHARD_BY_RANGE.
+//				Their locks are shared, in shard order, for the whole walk, so
+//				it is a snapshot of them. The visitor must not call back into
+//				the tree.
+//   ARGUMENTS: const T1 &lo - the lowest ID of the range
+//				const T1 &hi - the first ID past the range
+//				Visitor visitor - called as visitor(const T1 &id, T2 &rcd), returns
+//				false to stop
 // USES GLOBAL: none
 // MODIFIES GL: none
-//     RETURNS: bool
+//     RETURNS: bool - true if the whole range was visited, false if stopped
 //      AUTHOR: Kingston Chan
-// AUTHOR/DATE: KC 2015-02-11
-//							KC 2015-02-11
+// AUTHOR/DATE: KC 2026-10-17
+//							KC 2026-10-17
 ////////////////////////////////////////////////////////////////////////////////
-template<class T1, class T2>
-bool RBTree<T1, T2>::print() const {
-	if (root != NULL) {
-		root->print();
+template<class T1, class T2, class S, class L, class Compare, class Hash>
+template<class Visitor>
+bool ShardedRBTree<T1, T2, S, L, Compare, Hash>::forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const {
+	typedef typename RBTree<T1, T2, S, L, Compare>::iterator Iter;
+	if (compareID(lo, hi) >= 0)
 		return true;
+
+	// lock the shards the range may be in, and route again if the bounds moved meanwhile
+	vector<shared_lock<shared_mutex> > Guards;
+	int first, last;
+	while (true) {
+		int Slot = enter();
+		const Routing *R = routing.load(memory_order_acquire);
+		first = 0;
+		last = (int)shards.size() - 1;
+		if (mode == SHARD_BY_RANGE) {
+			first = shardOf(R, lo);
+			last = shardOf(R, hi);
+		}
+		for (int i = first; i <= last; i++)
+			Guards.push_back(shared_lock<shared_mutex>(shards[i]->lock));
+		bool Same = (routing.load(memory_order_acquire) == R);
+		leave(Slot);
+		if (Same)
+			break;
+		Guards.clear();
 	}
-	else
-		return false;
+
+	// a heap of the next node of each shard, least ID on top
+	vector<pair<Iter, Iter> > Heap;	// the next node, and the end of its shard
+	for (int i = first; i <= last; i++) {
+		Iter it = shards[i]->tree.lower_bound(lo);
+		if ((it != shards[i]->tree.end()) && (compareID(it->getID(), hi) < 0))
+			Heap.push_back(pair<Iter, Iter>(it, shards[i]->tree.end()));
+	}
+	auto later = [this](const pair<Iter, Iter> &a, const pair<Iter, Iter> &b) { return compareID(a.first->getID(), b.first->getID()) > 0; };
+	make_heap(Heap.begin(), Heap.end(), later);
+	while (!Heap.empty()) {
+		pop_heap(Heap.begin(), Heap.end(), later);
+		pair<Iter, Iter> &Next = Heap.back();
+		if (!visitor(Next.first->getID(), *Next.first->getRcd()))
+			return false;
+		++Next.first;
+		if ((Next.first != Next.second) && (compareID(Next.first->getID(), hi) < 0))
+			push_heap(Heap.begin(), Heap.end(), later);
+		else
+			Heap.pop_back();
+	}
+	return true;
 }
 
 #endif
@@ -0,0 +1,922 @@
+#include "RBTree.h"
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <cstdio>
+#include <string_view>
+
+// build with optimization on, e.g. "cl /O2 /EHsc benchmark.cpp"
+
+// a small LCG, so that every run sees the same keys
+unsigned int nextRand(unsigned int &seed) {
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 8);
+}
+
+double msSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// a fat record, to see what it costs to drag it along the descent
+struct Fat {
+	char payload[120];
+};
+
+// build a tree of n shuffled keys, then descend to every key once more
+template<class S>
+void benchDescent(const char *name, int n) {
+	vector<int> keys(n);
+	unsigned int seed = 3;
+	for (int i = 0; i < n; i++)
+		keys[i] = i;
+	for (int i = n - 1; i > 0; i--)
+		swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+
+	RBTree<int, Fat, S> RBT1;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < n; i++)
+		RBT1.Insert(keys[i]);
+	double build = msSince(start);
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < n; i++)
+		RBT1.Insert(keys[n - 1 - i]);	// already there: the descent only
+	cout << name << ": node " << sizeof(Node<int, Fat, S>) << " bytes, build " << build * 1e6 / n
+		<< " ns/key, descent " << msSince(start) * 1e6 / n << " ns/key" << endl;
+}
+
+// the same as benchDescent, with int keys and no record under both link layouts
+template<class L>
+void benchLayout(const char *name, int n) {
+	vector<int> keys(n);
+	unsigned int seed = 5;
+	for (int i = 0; i < n; i++)
+		keys[i] = i;
+	for (int i = n - 1; i > 0; i--)
+		swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+
+	RBTree<int, NULLT, RcdInline, L> RBT1;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < n; i++)
+		RBT1.Insert(keys[i]);
+	double build = msSince(start);
+
+	start = chrono::steady_clock::now();
+	for (int i = 0; i < n; i++)
+		RBT1.Insert(keys[n - 1 - i]);
+	cout << name << ": node " << sizeof(Node<int, NULLT, RcdInline, L>) << " bytes, "
+		<< sizeof(Node<int, NULLT, RcdInline, L>) * (double)n / (1 << 20) << " MB, build " << build * 1e6 / n
+		<< " ns/key, descent " << msSince(start) * 1e6 / n << " ns/key" << endl;
+}
+
+// the descent to every key of a tree built from "keys", under one compare functor
+template<class K, class Compare>
+void benchCompare(const char *name, const vector<K> &keys, const Compare &compare) {
+	RBTree<K, NULLT, RcdInline, PlainLinks, Compare> RBT1(compare);
+	for (size_t i = 0; i < keys.size(); i++)
+		RBT1.Insert(keys[i]);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (size_t i = keys.size(); i > 0; i--)
+		RBT1.Insert(keys[i - 1]);	// already there: the descent only
+	cout << name << ": " << msSince(start) * 1e6 / keys.size() << " ns/lookup" << endl;
+}
+
+int strCmp(const string &a, const string &b) {
+	return a.compare(b);
+}
+
+// one private tree per thread: insert n keys, delete every other one, return false if the size is off
+bool churnOwnTree(int n, unsigned int seed) {
+	RBTree<int> RBT1;
+	vector<int> keys(n);
+	for (int i = 0; i < n; i++)
+		keys[i] = i;
+	for (int i = n - 1; i > 0; i--)
+		swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+	for (int i = 0; i < n; i++)
+		RBT1.Insert(keys[i]);
+	for (int i = 0; i < n; i += 2)
+		RBT1.Delete(keys[i]);
+	return RBT1.getSize() == n / 2;
+}
+
+// the same tree behind one plain mutex, so that readers wait for each other too
+class MutexTree {
+private:
+	RBTree<int> tree;
+	mutable mutex lock;
+public:
+	bool Insert(int id) { lock_guard<mutex> guard(lock); return tree.Insert(id); }
+	bool Delete(int id) { lock_guard<mutex> guard(lock); return tree.Delete(id); }
+	bool contains(int id) const { lock_guard<mutex> guard(lock); return tree.find(id) != NULL; }
+};
+
+// t threads, each doing "ops" operations on a shared tree of keys in [0, 2n): 95% contains, 5% Insert/Delete
+template<class Tree>
+double readHeavy(Tree &shared, int n, int ops, int t) {
+	vector<thread> workers;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < t; i++)
+		workers.push_back(thread([&shared, n, ops, i]() {
+			unsigned int seed = 101 + i;
+			int hits = 0;
+			for (int j = 0; j < ops; j++) {
+				unsigned int r = nextRand(seed);
+				int key = (int)(nextRand(seed) % (2 * n));
+				if (r % 100 < 95)
+					hits += shared.contains(key);
+				else if (r % 2 == 0)
+					shared.Insert(key);
+				else
+					shared.Delete(key);
+			}
+			if (hits < 0)	// keep the lookups alive
+				cout << hits;
+		}));
+	for (int i = 0; i < t; i++)
+		workers[i].join();
+	return t * (double)ops / msSince(start) * 1000;
+}
+
+// t threads, each doing "ops" changes on a shared tree of keys in [0, 2n): half Insert, half Delete
+template<class Tree>
+double writeOnly(Tree &shared, int n, int ops, int t) {
+	vector<thread> workers;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < t; i++)
+		workers.push_back(thread([&shared, n, ops, i]() {
+			unsigned int seed = 203 + i;
+			for (int j = 0; j < ops; j++) {
+				int key = (int)(nextRand(seed) % (2 * n));
+				if (j % 2 == 0)
+					shared.Insert(key);
+				else
+					shared.Delete(key);
+			}
+		}));
+	for (int i = 0; i < t; i++)
+		workers[i].join();
+	return t * (double)ops / msSince(start) * 1000;
+}
+
+// t readers doing "ops" finds each on a shared tree of keys in [0, 2n), while one writer does Insert/Delete until they end
+template<class Tree>
+double readsWithWriter(Tree &shared, int n, int ops, int t, double &writes) {
+	atomic<bool> stop(false);
+	long long changes = 0;
+	thread writer([&shared, &stop, &changes, n]() {
+		unsigned int seed = 307;
+		while (!stop.load(memory_order_relaxed)) {
+			int key = (int)(nextRand(seed) % (2 * n));
+			if (changes++ % 2 == 0)
+				shared.Insert(key);
+			else
+				shared.Delete(key);
+		}
+	});
+	vector<thread> readers;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int i = 0; i < t; i++)
+		readers.push_back(thread([&shared, n, ops, i]() {
+			unsigned int seed = 401 + i;
+			int hits = 0;
+			for (int j = 0; j < ops; j++)
+				hits += shared.contains((int)(nextRand(seed) % (2 * n)));
+			if (hits < 0)	// keep the lookups alive
+				cout << hits;
+		}));
+	for (int i = 0; i < t; i++)
+		readers[i].join();
+	double ms = msSince(start);
+	stop = true;
+	writer.join();
+	writes = changes / ms * 1000;
+	return t * (double)ops / ms * 1000;
+}
+
+int main() {
+	{ // NodePool: the cost of getting and giving back the memory of a node
+		cout << "==============node allocation===========" << endl;
+		const int n = 1000000, rounds = 5;
+		vector<void *> Nds(n);
+		vector<int> order(n);
+		unsigned int seed = 1;
+		for (int i = 0; i < n; i++)
+			order[i] = i;
+		for (int i = n - 1; i > 0; i--)
+			swap(order[i], order[nextRand(seed) % (i + 1)]);
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int r = 0; r < rounds; r++) {
+			for (int i = 0; i < n; i++)
+				Nds[i] = ::operator new(sizeof(Node<int>));
+			for (int i = 0; i < n; i++)
+				::operator delete(Nds[order[i]]);
+		}
+		cout << "new/delete:      " << msSince(start) * 1e6 / (n * rounds) << " ns/node" << endl;
+
+		NodePool<Node<int> > pool;
+		start = chrono::steady_clock::now();
+		for (int r = 0; r < rounds; r++) {
+			for (int i = 0; i < n; i++)
+				Nds[i] = pool.alloc();
+			for (int i = 0; i < n; i++)
+				pool.release(Nds[order[i]]);
+		}
+		cout << "NodePool:        " << msSince(start) * 1e6 / (n * rounds) << " ns/node" << endl;
+	}
+	{ // record storage policies
+		cout << "==============record storage============" << endl;
+		cout << "Node<int>: " << sizeof(Node<int>) << " bytes, Node<int, int>: " << sizeof(Node<int, int>) << " bytes" << endl;
+		benchDescent<RcdInline>("RcdInline", 1000000);
+		benchDescent<RcdCold>("RcdCold  ", 1000000);
+	}
+	{ // link layouts on 10M keys
+		cout << "==============link layout===============" << endl;
+		benchLayout<PlainLinks>("PlainLinks ", 10000000);
+		benchLayout<PackedLinks>("PackedLinks", 10000000);
+	}
+	{ // compare functors: the old function pointer against ones the compiler can inline
+		cout << "==============compare functor===========" << endl;
+		const int n = 1000000;
+		vector<int> keys(n);
+		vector<string> strs(n);
+		unsigned int seed = 9;
+		for (int i = 0; i < n; i++)
+			keys[i] = i;
+		for (int i = n - 1; i > 0; i--)
+			swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+		for (int i = 0; i < n; i++)
+			strs[i] = "key/" + to_string(keys[i]);
+		benchCompare("int,    CmpPtr      ", keys, CmpPtr<int>());
+		benchCompare("int,    DCmp        ", keys, DCmp<int>());
+		benchCompare("int,    less<int>   ", keys, less<int>());
+		benchCompare("int,    lambda      ", keys, [](const int &a, const int &b) { return (a > b) - (a < b); });
+		benchCompare("string, CmpPtr      ", strs, CmpPtr<string>());
+		benchCompare("string, CmpPtr(func)", strs, CmpPtr<string>(strCmp));
+		benchCompare("string, DCmp        ", strs, DCmp<string>());
+		benchCompare("string, lambda      ", strs, [](const string &a, const string &b) { return a.compare(b); });
+	}
+	{ // string keys probed out of a request buffer: a string made for every lookup, against a string_view with a transparent compare
+		cout << "==============string lookup=============" << endl;
+		const int n = 1000000, ops = 2000000;
+		RBTree<string, NULLT, RcdInline, PlainLinks, less<> > RBT1;
+		string buffer;	// the keys of the probes back to back, as a parser would see them
+		vector<pair<int, int> > probes(ops);	// offset and length in "buffer"
+		unsigned int seed = 17;
+		for (int i = 0; i < n; i++)
+			RBT1.Insert("/api/v2/objects/by-id/" + to_string(i * 2));	// longer than the small string buffer, so a copy allocates
+		for (int i = 0; i < ops; i++) {
+			string key = "/api/v2/objects/by-id/" + to_string(nextRand(seed) % (2 * n));
+			probes[i] = make_pair((int)buffer.size(), (int)key.size());
+			buffer += key;
+		}
+
+		int hits = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < ops; i++)
+			hits += RBT1.contains(string(buffer.data() + probes[i].first, probes[i].second));
+		cout << "string:      " << msSince(start) * 1e6 / ops << " ns/find (" << hits << " hits)" << endl;
+		hits = 0;
+		start = chrono::steady_clock::now();
+		for (int i = 0; i < ops; i++)
+			hits += RBT1.contains(string_view(buffer.data() + probes[i].first, probes[i].second));
+		cout << "string_view: " << msSince(start) * 1e6 / ops << " ns/find (" << hits << " hits)" << endl;
+	}
+	{ // filling a key->value map: Insert then find, against one descent with the record moved in
+		cout << "==============map fill==================" << endl;
+		const int n = 1000000;
+		vector<int> keys(n);
+		unsigned int seed = 13;
+		for (int i = 0; i < n; i++)
+			keys[i] = i;
+		for (int i = n - 1; i > 0; i--)
+			swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+
+		RBTree<int, string> RBT1;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++) {
+			RBT1.Insert(keys[i]);
+			*RBT1.find(keys[i]) = "value of some length " + to_string(i);
+		}
+		cout << "Insert + find:   " << msSince(start) * 1e6 / n << " ns/key" << endl;
+
+		RBTree<int, string> RBT2;
+		start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			RBT2.insert(keys[i], "value of some length " + to_string(i));
+		cout << "insert:          " << msSince(start) * 1e6 / n << " ns/key" << endl;
+
+		RBTree<int, string> RBT3;
+		start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			RBT3.try_emplace(keys[i], "value of some length " + to_string(i));
+		cout << "try_emplace:     " << msSince(start) * 1e6 / n << " ns/key" << endl;
+
+		start = chrono::steady_clock::now();
+		RBTree<int, string> RBT4(RBT3);
+		cout << "hand over, copy: " << msSince(start) << " ms" << endl;
+		start = chrono::steady_clock::now();
+		RBTree<int, string> RBT5(std::move(RBT3));
+		cout << "hand over, move: " << msSince(start) << " ms" << endl;
+	}
+	{ // in-order scans through the father links, against std::set
+		cout << "==============in-order scan=============" << endl;
+		const int n = 1000000, rounds = 10;
+		vector<int> keys(n);
+		unsigned int seed = 17;
+		for (int i = 0; i < n; i++)
+			keys[i] = i;
+		for (int i = n - 1; i > 0; i--)
+			swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+		RBTree<int> RBT1;
+		set<int> Set1;
+		for (int i = 0; i < n; i++) {
+			RBT1.Insert(keys[i]);
+			Set1.insert(keys[i]);
+		}
+
+		long long sum = 0;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int r = 0; r < rounds; r++)
+			for (RBTree<int>::iterator it = RBT1.begin(); it != RBT1.end(); ++it)
+				sum += it->getID();
+		double ms = msSince(start);
+		cout << "RBTree:   " << ms * 1e6 / (n * rounds) << " ns/node, "
+			<< sizeof(Node<int>) * (double)n * rounds / ms / 1e6 << " GB/s of nodes" << endl;
+		start = chrono::steady_clock::now();
+		for (int r = 0; r < rounds; r++)
+			for (set<int>::iterator it = Set1.begin(); it != Set1.end(); ++it)
+				sum -= *it;
+		cout << "std::set: " << msSince(start) * 1e6 / (n * rounds) << " ns/node" << (sum == 0 ? "" : "  WRONG SUM") << endl;
+
+		start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			sum += RBT1.lower_bound(keys[i])->getID();
+		cout << "lower_bound: " << msSince(start) * 1e6 / n << " ns" << endl;
+	}
+	{ // range queries: forEachInRange against a full scan that filters
+		cout << "==============range query===============" << endl;
+		const int n = 1000000, queries = 1000;
+		RBTree<int, int> RBT1;
+		for (int i = 0; i < n; i++)
+			RBT1.insert(i, i);
+		int widths[] = { 10, 1000, n / 10, n / 2 };
+		for (int w = 0; w < 4; w++) {
+			int width = widths[w];
+			int q = (width >= n / 10) ? 10 : queries;
+			unsigned int seed = 19;
+			long long sum1 = 0, sum2 = 0;
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int i = 0; i < q; i++) {
+				int lo = nextRand(seed) % (n - width);
+				RBT1.forEachInRange(lo, lo + width, [&sum1](const int &, int &rcd) { sum1 += rcd; return true; });
+			}
+			double range = msSince(start) / q;
+			seed = 19;
+			start = chrono::steady_clock::now();
+			for (int i = 0; i < q; i++) {
+				int lo = nextRand(seed) % (n - width);
+				for (RBTree<int, int>::iterator it = RBT1.begin(); it != RBT1.end(); ++it)
+					if ((it->getID() >= lo) && (it->getID() < lo + width))
+						sum2 += *it->getRcd();
+			}
+			cout << "width " << width << ": forEachInRange " << range * 1000 << " us, full scan "
+				<< msSince(start) / q * 1000 << " us" << (sum1 == sum2 ? "" : "  WRONG SUM") << endl;
+		}
+	}
+	{ // order statistics under Counted<L>: what keeping the counts costs, and what they buy
+		cout << "==============order statistics==========" << endl;
+		const int n = 1000000, queries = 1000;
+		vector<int> keys(n);
+		unsigned int seed = 23;
+		for (int i = 0; i < n; i++)
+			keys[i] = i;
+		for (int i = n - 1; i > 0; i--)
+			swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+
+		RBTree<int> RBT1;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			RBT1.Insert(keys[i]);
+		for (int i = 0; i < n; i += 2)
+			RBT1.Delete(keys[i]);
+		cout << "Insert + Delete, PlainLinks:          " << msSince(start) * 1e6 / (1.5 * n) << " ns/op" << endl;
+		RBTree<int, NULLT, RcdInline, Counted<PlainLinks> > RBT2;
+		start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			RBT2.Insert(keys[i]);
+		for (int i = 0; i < n; i += 2)
+			RBT2.Delete(keys[i]);
+		cout << "Insert + Delete, Counted<PlainLinks>: " << msSince(start) * 1e6 / (1.5 * n) << " ns/op" << endl;
+
+		// the 99th percentile and a page deep down, by walking and by select
+		long long sum1 = 0, sum2 = 0;
+		start = chrono::steady_clock::now();
+		for (int q = 0; q < 10; q++) {
+			RBTree<int>::iterator it = RBT1.begin();
+			advance(it, RBT1.getSize() * 99 / 100);
+			sum1 += it->getID();
+		}
+		double walk = msSince(start) / 10;
+		start = chrono::steady_clock::now();
+		for (int q = 0; q < queries; q++)
+			sum2 += RBT2.select(RBT2.getSize() * 99 / 100)->getID();
+		cout << "99th percentile: walk " << walk * 1000 << " us, select " << msSince(start) / queries * 1000 << " us"
+			<< (sum1 * (queries / 10) == sum2 ? "" : "  WRONG") << endl;
+
+		start = chrono::steady_clock::now();
+		for (int q = 0; q < 10; q++)
+			sum1 += RBT1.countInRange(n / 4, 3 * n / 4);
+		walk = msSince(start) / 10;
+		start = chrono::steady_clock::now();
+		for (int q = 0; q < queries; q++)
+			sum2 += RBT2.countRange(n / 4, 3 * n / 4);
+		cout << "count of half the keys: countInRange " << walk * 1000 << " us, countRange " << msSince(start) / queries * 1000 << " us" << endl;
+	}
+	{ // sorted input: one Insert per key against the O(n) bulk load
+		cout << "==============bulk load=================" << endl;
+		const int n = 5000000;
+		vector<int> keys(n);
+		for (int i = 0; i < n; i++)
+			keys[i] = i;
+
+		RBTree<int> RBT1;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			RBT1.Insert(keys[i]);
+		double build = msSince(start);
+		long long sum = 0;
+		start = chrono::steady_clock::now();
+		for (RBTree<int>::iterator it = RBT1.begin(); it != RBT1.end(); ++it)
+			sum += it->getID();
+		cout << "Insert:          " << build << " ms, scan " << msSince(start) << " ms, height " << RBT1.getHeight() << endl;
+
+		RBTree<int> RBT2;
+		start = chrono::steady_clock::now();
+		RBT2.buildFromSorted(keys.begin(), keys.end());
+		build = msSince(start);
+		start = chrono::steady_clock::now();
+		for (RBTree<int>::iterator it = RBT2.begin(); it != RBT2.end(); ++it)
+			sum -= it->getID();
+		cout << "buildFromSorted: " << build << " ms, scan " << msSince(start) << " ms, height " << RBT2.getHeight()
+			<< (sum == 0 ? "" : "  WRONG SUM") << endl;
+	}
+	{ // a batch of odd keys into a tree of even ones, one by one and by insertBatch/deleteBatch
+		cout << "==============batch update==============" << endl;
+		const int n = 1000000, m = 500000;
+		vector<int> base(n), batch(m);
+		for (int i = 0; i < n; i++)
+			base[i] = 2 * i;
+		unsigned int seed = 17;
+		for (int i = 0; i < m; i++)
+			batch[i] = 2 * (int)(nextRand(seed) % n) + 1;
+
+		RBTree<int> RBT1;
+		RBT1.buildFromSorted(base.begin(), base.end());
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < m; i++)
+			RBT1.Insert(batch[i]);
+		double ins = msSince(start);
+		start = chrono::steady_clock::now();
+		for (int i = 0; i < m; i++)
+			RBT1.Delete(batch[i]);
+		cout << "one by one:      insert " << ins << " ms, delete " << msSince(start) << " ms" << endl;
+
+		int maxThreads = MAX(1, (int)thread::hardware_concurrency());
+		for (int t = 1; t <= maxThreads; t *= 2) {
+			RBTree<int> RBT2;
+			RBT2.buildFromSorted(base.begin(), base.end());
+			start = chrono::steady_clock::now();
+			int inserted = RBT2.insertBatch(batch.begin(), batch.end(), t);
+			ins = msSince(start);
+			start = chrono::steady_clock::now();
+			int deleted = RBT2.deleteBatch(batch.begin(), batch.end(), t);
+			cout << "batch, " << t << " thread(s): insert " << ins << " ms, delete " << msSince(start) << " ms"
+				<< ((inserted == deleted) && (RBT2.getSize() == n) ? "" : "  WRONG SIZE") << endl;
+		}
+	}
+	{ // cutting a tree in two and putting it back, by split/join and by re-inserting every node
+		cout << "==============split and join============" << endl;
+		const int n = 2000000;
+		vector<int> keys(n);
+		for (int i = 0; i < n; i++)
+			keys[i] = i;
+		RBTree<int, NULLT, RcdInline, Counted<PlainLinks> > RBT1, RBT2, RBT3;
+		RBT1.buildFromSorted(keys.begin(), keys.end());
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 1; i <= 100; i++) {
+			RBT1.split(n / 101 * i, RBT2, RBT3);
+			RBT1.join(RBT2, RBT3);
+		}
+		cout << "100 split + join: " << msSince(start) << " ms" << (RBT1.getSize() == n ? "" : "  WRONG SIZE") << endl;
+
+		start = chrono::steady_clock::now();
+		RBTree<int> RBT4, RBT5;
+		for (RBTree<int, NULLT, RcdInline, Counted<PlainLinks> >::iterator it = RBT1.begin(); it != RBT1.end(); ++it)
+			if (it->getID() < n / 2)
+				RBT4.Insert(it->getID());
+			else
+				RBT5.Insert(it->getID());
+		cout << "1 split by Insert: " << msSince(start) << " ms" << endl;
+	}
+	{ // two trees of random keys, merged by unionWith and by inserting one into the other
+		cout << "==============set union=================" << endl;
+		const int n = 1000000;
+		vector<int> keysA(n), keysB(n);
+		unsigned int seed = 23;
+		for (int i = 0; i < n; i++) {
+			keysA[i] = (int)(nextRand(seed) % (4 * n));
+			keysB[i] = (int)(nextRand(seed) % (4 * n));
+		}
+		sort(keysA.begin(), keysA.end());
+		keysA.erase(unique(keysA.begin(), keysA.end()), keysA.end());
+		sort(keysB.begin(), keysB.end());
+		keysB.erase(unique(keysB.begin(), keysB.end()), keysB.end());
+
+		RBTree<int> RBT1, RBT2;
+		RBT1.buildFromSorted(keysA.begin(), keysA.end());
+		RBT2.buildFromSorted(keysB.begin(), keysB.end());
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (RBTree<int>::iterator it = RBT2.begin(); it != RBT2.end(); ++it)
+			RBT1.Insert(it->getID());
+		cout << "Insert one by one: " << msSince(start) << " ms, size " << RBT1.getSize() << endl;
+
+		int maxThreads = MAX(1, (int)thread::hardware_concurrency());
+		for (int t = 1; t <= maxThreads; t *= 2) {
+			RBT1.buildFromSorted(keysA.begin(), keysA.end());
+			RBT2.buildFromSorted(keysB.begin(), keysB.end());
+			start = chrono::steady_clock::now();
+			RBT1.unionWith(RBT2, t);
+			cout << "unionWith, " << t << " thread(s): " << msSince(start) << " ms, size " << RBT1.getSize() << endl;
+		}
+	}
+	{ // a consistent copy for a reader: deep copy against a persistent snapshot
+		cout << "==============snapshot==================" << endl;
+		const int n = 2000000;
+		RBTree<int> RBT1;
+		PersistentRBTree<int> PRBT1;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			RBT1.Insert(i);
+		double build = msSince(start);
+		start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			PRBT1.Insert(i);
+		cout << "Insert:           RBTree " << build << " ms, PersistentRBTree " << msSince(start) << " ms" << endl;
+
+		start = chrono::steady_clock::now();
+		RBTree<int> RBT2(RBT1);
+		double copy = msSince(start);
+		start = chrono::steady_clock::now();
+		PersistentRBTree<int> PRBT2 = PRBT1.snapshot();
+		cout << "copy:             RBTree " << copy << " ms, snapshot " << msSince(start) << " ms" << endl;
+
+		start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i += 10)
+			PRBT1.Delete(i);
+		cout << "Delete after snapshot: " << msSince(start) << " ms, sizes " << PRBT1.getSize() << ' ' << PRBT2.getSize()
+			<< (RBT2.getSize() == n ? "" : "  WRONG SIZE") << endl;
+	}
+	{ // tearing down a big tree, and a degenerate chain of Nodes too deep for a recursive walk
+		cout << "==============teardown==================" << endl;
+		const int n = 10000000;
+		RBTree<int, string> *RBT1 = new RBTree<int, string>;
+		for (int i = 0; i < n; i++)
+			RBT1->insert(i, "record");
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		RBTree<int, string> *RBT2 = new RBTree<int, string>(*RBT1);
+		cout << "copy the tree:      " << msSince(start) << " ms" << endl;
+		start = chrono::steady_clock::now();
+		delete RBT2;
+		cout << "destroy:            " << msSince(start) << " ms" << endl;
+		delete RBT1;
+
+		Node<int, string> *Top = new Node<int, string>(0), *Tmp = Top;
+		for (int i = 1; i < n; i++) {
+			Tmp->AddLft(i);
+			Tmp = Tmp->getLft();
+		}
+		Node<int, string> Chain;
+		start = chrono::steady_clock::now();
+		Chain.copy(Top);
+		cout << "copy a chain:       " << msSince(start) << " ms" << endl;
+		start = chrono::steady_clock::now();
+		int size = Chain.getCount();
+		cout << "count the chain:    " << msSince(start) << " ms, size " << size << endl;
+		start = chrono::steady_clock::now();
+		delete Top;
+		cout << "delete the chain:   " << msSince(start) << " ms" << endl;
+	}
+	{ // a restart from a saved file, against reading the same bytes and against inserting one by one
+		cout << "==============save and load=============" << endl;
+		const int n = 10000000;
+		vector<pair<int, int> > items(n);
+		for (int i = 0; i < n; i++)
+			items[i] = make_pair(i * 2, i);
+		RBTree<int, int> RBT1;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		RBT1.buildFromSorted(items.begin(), items.end());
+		cout << "buildFromSorted:    " << msSince(start) << " ms" << endl;
+		vector<pair<int, int> >().swap(items);
+
+		start = chrono::steady_clock::now();
+		bool saved = RBT1.save("rbtree.bin");
+		cout << "save:               " << msSince(start) << " ms" << (saved ? "" : "  FAILED") << endl;
+
+		start = chrono::steady_clock::now();
+		ifstream File("rbtree.bin", ios::in | ios::binary);
+		vector<char> buf(1 << 20);
+		long long bytes = 0;
+		while (File.read(&buf[0], buf.size()) || (File.gcount() > 0))
+			bytes += File.gcount();
+		File.close();
+		cout << "read the file:      " << msSince(start) << " ms, " << bytes / 1000000 << " MB" << endl;
+
+		RBTree<int, int> RBT2;
+		start = chrono::steady_clock::now();
+		bool loaded = RBT2.load("rbtree.bin");
+		cout << "load:               " << msSince(start) << " ms, size " << RBT2.getSize() << (loaded ? "" : "  FAILED") << endl;
+
+		RBTree<int, int> RBT3;
+		start = chrono::steady_clock::now();
+		for (RBTree<int, int>::iterator it = RBT2.begin(); it != RBT2.end(); ++it)
+			RBT3.insert(it->getID(), *it->getRcd());
+		cout << "Insert one by one:  " << msSince(start) << " ms" << endl;
+		remove("rbtree.bin");
+	}
+	{ // a restart that maps the tree where it is, against one that loads a saved file
+		cout << "==============mapped tree===============" << endl;
+		const int n = 10000000;
+		vector<pair<int, int> > items(n);
+		for (int i = 0; i < n; i++)
+			items[i] = make_pair(i * 2, i);
+		MappedRBTree<int, int> MRBT1;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		MRBT1.create("rbtree.tree");
+		MRBT1.buildFromSorted(items.begin(), items.end());
+		MRBT1.close();
+		cout << "build in a file:    " << msSince(start) << " ms" << endl;
+		RBTree<int, int> RBT1;
+		RBT1.buildFromSorted(items.begin(), items.end());
+		RBT1.save("rbtree.bin");
+		vector<pair<int, int> >().swap(items);
+
+		start = chrono::steady_clock::now();
+		MappedRBTree<int, int> MRBT2;
+		bool opened = MRBT2.open("rbtree.tree");
+		cout << "open:               " << msSince(start) << " ms, size " << MRBT2.getSize() << (opened ? "" : "  FAILED") << endl;
+		RBTree<int, int> RBT2;
+		start = chrono::steady_clock::now();
+		RBT2.load("rbtree.bin");
+		cout << "load:               " << msSince(start) << " ms" << endl;
+
+		vector<int> keys(1000000);
+		unsigned int seed = 29;
+		for (size_t i = 0; i < keys.size(); i++)
+			keys[i] = (int)(nextRand(seed) % (2 * n));
+		long long found = 0;
+		start = chrono::steady_clock::now();
+		for (size_t i = 0; i < keys.size(); i++)
+			found += (MRBT2.find(keys[i]) != NULL);
+		cout << "1M finds, mapped:   " << msSince(start) << " ms, found " << found << endl;
+		found = 0;
+		start = chrono::steady_clock::now();
+		for (size_t i = 0; i < keys.size(); i++)
+			found += (RBT2.find(keys[i]) != NULL);
+		cout << "1M finds, RBTree:   " << msSince(start) << " ms, found " << found << endl;
+		MRBT2.close();
+		remove("rbtree.tree");
+		remove("rbtree.bin");
+	}
+	{ // what the journal costs under each policy
+		cout << "==============journal===================" << endl;
+		const int n = 1000000;
+		unsigned int seed = 31;
+		vector<int> keys(n);
+		for (int i = 0; i < n; i++)
+			keys[i] = (int)nextRand(seed);
+		RBTree<int, int> RBT1;
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		for (int i = 0; i < n; i++)
+			RBT1.insert(keys[i], i);
+		double plain = msSince(start);
+		cout << "no journal:         " << n / plain << "K inserts/s" << endl;
+
+		const char *names[] = { "SYNC_EACH", "SYNC_GROUP", "SYNC_NONE" };
+		const int counts[] = { 2000, n, n };	// a sync each takes a disk round trip
+		for (int p = SYNC_EACH; p <= SYNC_NONE; p++) {
+			JournaledRBTree<int, int> JRBT1;
+			JRBT1.open("rbtree", (SyncPolicy)p, 256);
+			start = chrono::steady_clock::now();
+			for (int i = 0; i < counts[p]; i++)
+				JRBT1.insert(keys[i], i);
+			JRBT1.commit();
+			double ms = msSince(start);
+			cout << names[p] << ":" << string(19 - strlen(names[p]), ' ') << counts[p] / ms << "K inserts/s, " << ms / plain * n / counts[p] << "x the time" << endl;
+			start = chrono::steady_clock::now();
+			JRBT1.checkpoint();
+			cout << "  checkpoint:       " << msSince(start) << " ms" << endl;
+			JRBT1.close();
+			remove("rbtree.log");
+			remove("rbtree.snap");
+		}
+
+		// SYNC_EACH from many threads: the ones that wait share a sync
+		for (int t = 2; t <= 16; t *= 2) {
+			JournaledRBTree<int, int> JRBT1;
+			JRBT1.open("rbtree", SYNC_EACH);
+			vector<thread> workers;
+			start = chrono::steady_clock::now();
+			for (int w = 0; w < t; w++)
+				workers.push_back(thread([&JRBT1, &keys, w, t]() {
+					for (int i = w; i < 4000; i += t)
+						JRBT1.insert(keys[i], i);
+				}));
+			for (size_t w = 0; w < workers.size(); w++)
+				workers[w].join();
+			double ms = msSince(start);
+			cout << "SYNC_EACH, " << t << " threads:" << string(t < 10 ? 5 : 4, ' ') << 4000 / ms << "K inserts/s" << endl;
+			JRBT1.close();
+			remove("rbtree.log");
+			remove("rbtree.snap");
+		}
+	}
+	{ // what the rebalancing does for sequential and shuffled keys, and what counting it costs
+		cout << "==============operation counts==========" << endl;
+		const int n = 1000000;
+		vector<int> keys(n);
+		unsigned int seed = 37;
+		for (int i = 0; i < n; i++)
+			keys[i] = i;
+		for (int pass = 0; pass < 2; pass++) {
+			if (pass == 1)
+				for (int i = n - 1; i > 0; i--)
+					swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+			RBTree<int, NULLT, RcdInline, PlainLinks, DCmp<int>, OpStats> RBT1;
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int i = 0; i < n; i++)
+				RBT1.Insert(keys[i]);
+			double counted = msSince(start);
+			const OpStats &Stats = RBT1.stats();
+			cout << (pass == 0 ? "sequential" : "shuffled  ") << " insert: " << (double)Stats.visited[OpStats::INSERT] / n << " nodes/op, "
+				<< (double)(Stats.rotations[OpStats::I_LL] + Stats.rotations[OpStats::I_RR]) / n << " single and "
+				<< (double)(Stats.rotations[OpStats::I_LR] + Stats.rotations[OpStats::I_RL]) / n << " double rotations/op, "
+				<< (double)Stats.recolors / n << " recolors/op" << endl;
+			TreeShape Shape = RBT1.shape();
+			cout << "           shape: height " << Shape.height << ", black height " << Shape.blackHeight << ", average path " << Shape.avgPath << endl;
+			RBT1.resetStats();
+			for (int i = 0; i < n; i++)
+				RBT1.Delete(keys[i]);
+			cout << "           delete: " << (double)Stats.visited[OpStats::DELETE] / n << " nodes/op, case 2B "
+				<< (double)Stats.cases[OpStats::DEL_2B] / n << ", 2A1 " << (double)Stats.cases[OpStats::DEL_2A1] / n << ", 2A2/2A3 "
+				<< (double)(Stats.cases[OpStats::DEL_2A_OUTER] + Stats.cases[OpStats::DEL_2A_INNER]) / n << " per op" << endl;
+
+			RBTree<int, NULLT, RcdInline, PlainLinks, DCmp<int> > RBT2;
+			start = chrono::steady_clock::now();
+			for (int i = 0; i < n; i++)
+				RBT2.Insert(keys[i]);
+			cout << "           insert " << counted << " ms counted, " << msSince(start) << " ms not" << endl;
+		}
+	}
+	{ // independent trees on independent threads
+		cout << "==============one tree per thread=======" << endl;
+		const int n = 200000;
+		int maxThreads = MAX(1, (int)thread::hardware_concurrency());
+		double single = 0;
+		for (int t = 1; t <= maxThreads; t *= 2) {
+			vector<thread> workers;
+			vector<char> ok(t, 0);
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int i = 0; i < t; i++)
+				workers.push_back(thread([&ok, i]() { ok[i] = churnOwnTree(n, 11 + i); }));
+			for (int i = 0; i < t; i++)
+				workers[i].join();
+			double ms = msSince(start);
+			double opsPerMs = t * 1.5 * n / ms;
+			if (t == 1)
+				single = opsPerMs;
+			cout << t << " threads: " << opsPerMs * 1000 << " ops/s, " << opsPerMs / single / t * 100 << "% of linear";
+			cout << (count(ok.begin(), ok.end(), 1) == t ? "" : "  WRONG SIZE") << endl;
+		}
+	}
+	{ // one shared tree, 95% finds and 5% Insert/Delete
+		cout << "==============95/5 read-heavy===========" << endl;
+		const int n = 1000000, ops = 500000;
+		int maxThreads = MAX(1, (int)thread::hardware_concurrency());
+		ConcurrentRBTree<int> RBT1;
+		MutexTree RBT2;
+		for (int i = 0; i < 2 * n; i += 2) {
+			RBT1.Insert(i);
+			RBT2.Insert(i);
+		}
+		double single1 = 0, single2 = 0;
+		for (int t = 1; t <= maxThreads; t *= 2) {
+			double shared = readHeavy(RBT1, n, ops, t);
+			double exclusive = readHeavy(RBT2, n, ops, t);
+			if (t == 1) {
+				single1 = shared;
+				single2 = exclusive;
+			}
+			cout << t << " threads: shared_mutex " << shared << " ops/s (x" << shared / single1
+				<< "), mutex " << exclusive << " ops/s (x" << exclusive / single2 << ")" << endl;
+		}
+	}
+	{ // one shared tree, only Insert/Delete: node locks taken hand over hand against one lock for the tree
+		cout << "==============multi-writer=============" << endl;
+		const int n = 1000000, ops = 200000;
+		int maxThreads = MAX(1, (int)thread::hardware_concurrency());
+		LockCoupledRBTree<int> RBT1;
+		MutexTree RBT2;
+		for (int i = 0; i < 2 * n; i += 2) {
+			RBT1.Insert(i);
+			RBT2.Insert(i);
+		}
+		double single1 = 0, single2 = 0;
+		for (int t = 1; t <= maxThreads; t *= 2) {
+			double coupled = writeOnly(RBT1, n, ops, t);
+			double exclusive = writeOnly(RBT2, n, ops, t);
+			if (t == 1) {
+				single1 = coupled;
+				single2 = exclusive;
+			}
+			cout << t << " threads: lock-coupled " << coupled << " ops/s (x" << coupled / single1
+				<< "), mutex " << exclusive << " ops/s (x" << exclusive / single2 << ")" << endl;
+		}
+	}
+	{ // finds on every core while one writer runs: readers that take no lock against a reader-writer lock
+		cout << "==============readers with a writer=====" << endl;
+		const int n = 1000000, ops = 500000;
+		int maxThreads = MAX(1, (int)thread::hardware_concurrency());
+		EpochRBTree<int> RBT1;
+		ConcurrentRBTree<int> RBT2;
+		RBT1.update([n](EpochRBTree<int>::Version &V) {
+			for (int i = 0; i < 2 * n; i += 2)
+				V.Insert(i);
+			return true;
+		});
+		for (int i = 0; i < 2 * n; i += 2)
+			RBT2.Insert(i);
+		double single1 = 0, single2 = 0;
+		for (int t = 1; t <= maxThreads; t *= 2) {
+			double writes1, writes2;
+			double epoch = readsWithWriter(RBT1, n, ops, t, writes1);
+			double shared = readsWithWriter(RBT2, n, ops, t, writes2);
+			if (t == 1) {
+				single1 = epoch;
+				single2 = shared;
+			}
+			cout << t << " readers: epoch " << epoch << " finds/s (x" << epoch / single1 << ", writer " << writes1
+				<< " changes/s), shared_mutex " << shared << " finds/s (x" << shared / single2 << ", writer " << writes2 << " changes/s)" << endl;
+		}
+	}
+	{ // Insert/Delete on every core, spread over more and more shards, each with a lock of its own
+		cout << "==============sharded writers===========" << endl;
+		const int n = 1000000, ops = 200000;
+		int t = MAX(2, (int)thread::hardware_concurrency());
+		double single = 0;
+		for (int shardCnt = 1; shardCnt <= 16; shardCnt *= 2) {
+			ShardedRBTree<int> RBT1(shardCnt);
+			for (int i = 0; i < 2 * n; i += 2)
+				RBT1.Insert(i);
+			double sharded = writeOnly(RBT1, n, ops, t);
+			if (shardCnt == 1)
+				single = sharded;
+			cout << shardCnt << " shards, " << t << " threads: " << sharded << " ops/s (x" << sharded / single << ")" << endl;
+		}
+	}
+	{ // Insert/Delete churn on a tree that keeps its size
+		cout << "==============insert/delete churn=======" << endl;
+		for (int n = 100000; n <= 1000000; n *= 10) {
+			const int ops = 1000000;
+			vector<int> keys(n);
+			unsigned int seed = 7;
+			RBTree<int> RBT1;
+			for (int i = 0; i < n; i++)
+				keys[i] = i;
+			for (int i = n - 1; i > 0; i--)
+				swap(keys[i], keys[nextRand(seed) % (i + 1)]);
+			for (int i = 0; i < n; i++)
+				RBT1.Insert(keys[i]);
+
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			for (int i = 0; i < ops; i++) {
+				int j = nextRand(seed) % n;
+				RBT1.Delete(keys[j]);
+				keys[j] = n + i;
+				RBT1.Insert(keys[j]);
+			}
+			cout << "n = " << n << ": " << msSince(start) * 1e6 / ops << " ns per Delete+Insert" << endl;
+
+			start = chrono::steady_clock::now();
+			RBT1.empty();
+			cout << "n = " << n << ": empty() " << msSince(start) << " ms" << endl;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,342 @@
+#include "RBTree.h"
+#include <chrono>
+#include <vector>
+#include <set>
+#include <map>
+#include <string>
+#include <cmath>
+#include <cstdio>
+
+// RBTree against std::set and std::map: insert, find, delete, mixed and range-scan workloads,
+// over uniform, sequential, reverse and Zipfian keys, int, 64-bit and string keys, and sizes
+// from 1K up by tens. Every result is a row of a CSV or JSON file, to be compared run to run.
+//
+// build with optimization on, e.g. "cl /O2 /EHsc compare.cpp"
+// run as "compare [largest size, 1000000] [csv | json] [file, compare.csv or compare.json]";
+// 100000000 needs some tens of GB, most of it for the string keys
+
+// splitmix64: the LCG of benchmark.cpp gives 24 bits, too few for 100M keys
+uint64_t nextRand64(uint64_t &seed) {
+	uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+double msSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+enum Dist { UNIFORM, SEQUENTIAL, REVERSE, ZIPFIAN };
+const char *distNames[] = { "uniform", "sequential", "reverse", "zipfian" };
+
+// Zipfian ranks over [0, n) as in Gray et al., "Quickly Generating Billion-Record Synthetic
+// Databases", with theta 0.99 as in YCSB. The ranks are hashed onto the indices, so that the
+// hot keys are spread over the tree rather than packed at one end of it.
+class Zipf {
+private:
+	uint64_t n;
+	double theta, alpha, zetan, eta;
+public:
+	Zipf(uint64_t n, double theta = 0.99) : n(n), theta(theta) {
+		double zeta2 = 1 + pow(0.5, theta);
+		zetan = 0;
+		for (uint64_t i = 1; i <= n; i++)
+			zetan += 1 / pow((double)i, theta);
+		alpha = 1 / (1 - theta);
+		eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / zetan);
+	}
+	uint64_t next(uint64_t &seed) {
+		double u = (nextRand64(seed) >> 11) * (1.0 / 9007199254740992.0), uz = u * zetan;
+		uint64_t rank = (uz < 1) ? 0 : (uz < 1 + pow(0.5, theta)) ? 1 : (uint64_t)(n * pow(eta * u - eta + 1, alpha));
+		uint64_t hash = min(rank, n - 1);
+		return nextRand64(hash) % n;
+	}
+};
+
+// "cnt" indices in [0, n) drawn from "d"; a uniform fill (cnt == n, distinct) is a shuffle of them all
+vector<uint64_t> makeIndices(Dist d, uint64_t n, uint64_t cnt, bool distinct, uint64_t seed) {
+	vector<uint64_t> idx(cnt);
+	if (d == ZIPFIAN) {
+		Zipf Z(n);
+		for (uint64_t i = 0; i < cnt; i++)
+			idx[i] = Z.next(seed);
+	}
+	else if ((d == UNIFORM) && distinct) {
+		for (uint64_t i = 0; i < cnt; i++)
+			idx[i] = i;
+		for (uint64_t i = cnt - 1; i > 0; i--)
+			swap(idx[i], idx[nextRand64(seed) % (i + 1)]);
+	}
+	else
+		for (uint64_t i = 0; i < cnt; i++)
+			idx[i] = (d == UNIFORM) ? nextRand64(seed) % n : (d == SEQUENTIAL) ? i % n : n - 1 - i % n;
+	return idx;
+}
+
+// the key of an index: keys are in the order of their indices
+void makeKey(uint64_t i, int &key) { key = (int)i; }
+void makeKey(uint64_t i, int64_t &key) { key = (int64_t)i * 1000003 - ((int64_t)1 << 50); }
+void makeKey(uint64_t i, string &key) {	// past the small-string buffer, as most string keys are
+	char buf[32];
+	snprintf(buf, sizeof(buf), "key:%016llu", (unsigned long long)i);
+	key = buf;
+}
+
+template<class K>
+vector<K> makeKeys(const vector<uint64_t> &idx) {
+	vector<K> keys(idx.size());
+	for (size_t i = 0; i < idx.size(); i++)
+		makeKey(idx[i], keys[i]);
+	return keys;
+}
+
+// the keys of one size and distribution, made before anything is timed
+template<class K>
+struct Workload {
+	uint64_t n;
+	vector<K> fill;	// inserted, then deleted, in this order
+	vector<K> probe;	// looked up
+	vector<K> mixed;	// over twice the keys, so that about half the inserts are new
+	vector<unsigned char> mixOps;	// 0 and 1 find, 2 insert, 3 delete
+	vector<K> starts;	// where the range scans start
+};
+
+const uint64_t probeOps = 1 << 20, scanOps = 1 << 16;
+const int scanLen = 100;
+
+// what each container is asked to do, so that one timing loop serves them all;
+// the trees compare with DCmp, which inlines like std::less
+template<class K>
+class RBSet {
+private:
+	RBTree<K, NULLT, RcdInline, PlainLinks, DCmp<K> > tree;
+public:
+	static const char *name() { return "RBTree<K>"; }
+	void insert(const K &key) { tree.Insert(key); }
+	bool find(const K &key) const { return tree.find(key) != NULL; }
+	void erase(const K &key) { tree.Delete(key); }
+	long long scan(const K &lo) const {
+		long long cnt = 0;
+		for (typename RBTree<K, NULLT, RcdInline, PlainLinks, DCmp<K> >::iterator it = tree.lower_bound(lo); (it != tree.end()) && (cnt < scanLen); ++it)
+			cnt++;
+		return cnt;
+	}
+	long long size() const { return tree.getSize(); }
+};
+
+template<class K>
+class RBMap {
+private:
+	RBTree<K, int, RcdInline, PlainLinks, DCmp<K> > tree;
+public:
+	static const char *name() { return "RBTree<K,int>"; }
+	void insert(const K &key) { tree.try_emplace(key, 1); }
+	bool find(const K &key) const { return tree.find(key) != NULL; }
+	void erase(const K &key) { tree.Delete(key); }
+	long long scan(const K &lo) const {
+		long long sum = 0;
+		int cnt = 0;
+		for (typename RBTree<K, int, RcdInline, PlainLinks, DCmp<K> >::iterator it = tree.lower_bound(lo); (it != tree.end()) && (cnt < scanLen); ++it, cnt++)
+			sum += *it->getRcd();
+		return sum;
+	}
+	long long size() const { return tree.getSize(); }
+};
+
+template<class K>
+class StdSet {
+private:
+	set<K> tree;
+public:
+	static const char *name() { return "std::set<K>"; }
+	void insert(const K &key) { tree.insert(key); }
+	bool find(const K &key) const { return tree.find(key) != tree.end(); }
+	void erase(const K &key) { tree.erase(key); }
+	long long scan(const K &lo) const {
+		long long cnt = 0;
+		for (typename set<K>::const_iterator it = tree.lower_bound(lo); (it != tree.end()) && (cnt < scanLen); ++it)
+			cnt++;
+		return cnt;
+	}
+	long long size() const { return (long long)tree.size(); }
+};
+
+template<class K>
+class StdMap {
+private:
+	map<K, int> tree;
+public:
+	static const char *name() { return "std::map<K,int>"; }
+	void insert(const K &key) { tree.emplace(key, 1); }
+	bool find(const K &key) const { return tree.find(key) != tree.end(); }
+	void erase(const K &key) { tree.erase(key); }
+	long long scan(const K &lo) const {
+		long long sum = 0;
+		int cnt = 0;
+		for (typename map<K, int>::const_iterator it = tree.lower_bound(lo); (it != tree.end()) && (cnt < scanLen); ++it, cnt++)
+			sum += it->second;
+		return sum;
+	}
+	long long size() const { return (long long)tree.size(); }
+};
+
+// one result; "check" is what the workload found, which must be the same for every container
+struct Row {
+	string container, key, dist, workload;
+	uint64_t size, ops;
+	double ms;
+	long long check;
+};
+
+// the five workloads on one container; small sizes are filled again and again, so that
+// every timing covers about a million operations
+template<class C, class K>
+void runContainer(vector<Row> &rows, const char *keyName, const char *dist, const Workload<K> &w) {
+	Row R;
+	R.container = C::name();
+	R.key = keyName;
+	R.dist = dist;
+	R.size = w.n;
+	int rounds = (int)MAX(1, (int)(probeOps / w.n));
+	vector<C *> Trees(rounds);
+	for (int r = 0; r < rounds; r++)
+		Trees[r] = new C;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < w.fill.size(); i++)
+			Trees[r]->insert(w.fill[i]);
+	R.ms = msSince(start);
+	R.workload = "insert";
+	R.ops = rounds * (uint64_t)w.fill.size();
+	R.check = Trees[0]->size();
+	rows.push_back(R);
+	C &T = *Trees[0];
+
+	long long hits = 0;
+	start = chrono::steady_clock::now();
+	for (size_t i = 0; i < w.probe.size(); i++)
+		hits += T.find(w.probe[i]);
+	R.ms = msSince(start);
+	R.workload = "find";
+	R.ops = w.probe.size();
+	R.check = hits;
+	rows.push_back(R);
+
+	long long seen = 0;
+	start = chrono::steady_clock::now();
+	for (size_t i = 0; i < w.starts.size(); i++)
+		seen += T.scan(w.starts[i]);
+	R.ms = msSince(start);
+	R.workload = "range" + to_string(scanLen);
+	R.ops = w.starts.size();
+	R.check = seen;
+	rows.push_back(R);
+
+	hits = 0;
+	start = chrono::steady_clock::now();
+	for (size_t i = 0; i < w.mixed.size(); i++)
+		switch (w.mixOps[i]) {
+		case 2: T.insert(w.mixed[i]); break;
+		case 3: T.erase(w.mixed[i]); break;
+		default: hits += T.find(w.mixed[i]);
+		}
+	R.ms = msSince(start);
+	R.workload = "mixed";
+	R.ops = w.mixed.size();
+	R.check = hits * 1000003 + T.size();
+	rows.push_back(R);
+
+	start = chrono::steady_clock::now();
+	for (int r = 0; r < rounds; r++)
+		for (size_t i = 0; i < w.fill.size(); i++)
+			Trees[r]->erase(w.fill[i]);
+	R.ms = msSince(start);
+	R.workload = "delete";
+	R.ops = rounds * (uint64_t)w.fill.size();
+	R.check = T.size();
+	rows.push_back(R);
+
+	for (int r = 0; r < rounds; r++)
+		delete Trees[r];
+}
+
+// every distribution and container for one key type and size
+template<class K>
+void runKey(vector<Row> &rows, const char *keyName, uint64_t n) {
+	for (int d = UNIFORM; d <= ZIPFIAN; d++) {
+		Workload<K> w;
+		w.n = n;
+		w.fill = makeKeys<K>(makeIndices((Dist)d, n, n, true, 1));
+		w.probe = makeKeys<K>(makeIndices((Dist)d, n, probeOps, false, 2));
+		w.starts = makeKeys<K>(makeIndices((Dist)d, n, scanOps, false, 3));
+		w.mixed = makeKeys<K>(makeIndices((Dist)d, 2 * n, probeOps, false, 4));
+		w.mixOps.resize(probeOps);
+		uint64_t seed = 5;
+		for (uint64_t i = 0; i < probeOps; i++)
+			w.mixOps[i] = (unsigned char)(nextRand64(seed) & 3);
+
+		size_t first = rows.size();
+		runContainer<RBSet<K> >(rows, keyName, distNames[d], w);
+		runContainer<StdSet<K> >(rows, keyName, distNames[d], w);
+		runContainer<RBMap<K> >(rows, keyName, distNames[d], w);
+		runContainer<StdMap<K> >(rows, keyName, distNames[d], w);
+
+		// one line per workload: RBTree against std, set then map
+		for (size_t i = first; i < first + 5; i++) {
+			const Row &rs = rows[i], &ss = rows[i + 5], &rm = rows[i + 10], &sm = rows[i + 15];
+			printf("%-7s %10llu %-10s %-8s set %8.1f / %8.1f ns  map %8.1f / %8.1f ns%s\n", keyName, (unsigned long long)n,
+				distNames[d], rs.workload.c_str(), rs.ms * 1e6 / rs.ops, ss.ms * 1e6 / ss.ops, rm.ms * 1e6 / rm.ops, sm.ms * 1e6 / sm.ops,
+				((rs.check != ss.check) || (rm.check != sm.check)) ? "  MISMATCH" : "");
+		}
+	}
+}
+
+bool writeCSV(const string &path, const vector<Row> &rows) {
+	FILE *f = fopen(path.c_str(), "w");
+	if (f == NULL)
+		return false;
+	fprintf(f, "container,key,size,distribution,workload,ops,ms,ns_per_op,check\n");
+	for (size_t i = 0; i < rows.size(); i++)
+		fprintf(f, "%s,%s,%llu,%s,%s,%llu,%.3f,%.2f,%lld\n", rows[i].container.c_str(), rows[i].key.c_str(),
+			(unsigned long long)rows[i].size, rows[i].dist.c_str(), rows[i].workload.c_str(), (unsigned long long)rows[i].ops,
+			rows[i].ms, rows[i].ms * 1e6 / rows[i].ops, rows[i].check);
+	return fclose(f) == 0;
+}
+
+bool writeJSON(const string &path, const vector<Row> &rows) {
+	FILE *f = fopen(path.c_str(), "w");
+	if (f == NULL)
+		return false;
+	fprintf(f, "[\n");
+	for (size_t i = 0; i < rows.size(); i++)
+		fprintf(f, "  {\"container\": \"%s\", \"key\": \"%s\", \"size\": %llu, \"distribution\": \"%s\", \"workload\": \"%s\", "
+			"\"ops\": %llu, \"ms\": %.3f, \"ns_per_op\": %.2f, \"check\": %lld}%s\n", rows[i].container.c_str(), rows[i].key.c_str(),
+			(unsigned long long)rows[i].size, rows[i].dist.c_str(), rows[i].workload.c_str(), (unsigned long long)rows[i].ops,
+			rows[i].ms, rows[i].ms * 1e6 / rows[i].ops, rows[i].check, (i + 1 < rows.size()) ? "," : "");
+	fprintf(f, "]\n");
+	return fclose(f) == 0;
+}
+
+int main(int argc, char *argv[]) {
+	uint64_t maxSize = (argc > 1) ? strtoull(argv[1], NULL, 10) : 1000000;
+	string format = (argc > 2) ? argv[2] : "csv";
+	string path = (argc > 3) ? argv[3] : "compare." + format;
+	if ((format != "csv") && (format != "json")) {
+		cout << "usage: compare [largest size] [csv | json] [file]" << endl;
+		return 1;
+	}
+
+	cout << "times are RBTree / std, per operation" << endl;
+	vector<Row> rows;
+	for (uint64_t n = 1000; n <= maxSize; n *= 10) {
+		runKey<int>(rows, "int", n);
+		runKey<int64_t>(rows, "int64", n);
+		runKey<string>(rows, "string", n);
+	}
+
+	bool written = (format == "csv") ? writeCSV(path, rows) : writeJSON(path, rows);
+	cout << rows.size() << " results " << (written ? "written to " : "NOT written to ") << path << endl;
+	return written ? 0 : 1;
+}
@@ -1,4 +1,6 @@
 #include "RBTree.h"
+#include <thread>
+#include <string_view>
 
 // define a class
 class A {
@@ -108,7 +110,7 @@ int main() {
 	  	cout << "========================================" << endl;
 		int a = 1, b = 2;
 		RBTree<A, int> RBT1(1, &a, cmp);
-		RBTree<A, int> RBT3(3, NULL, cmp);
+		RBTree<A, int> RBT3(3, (const int *)NULL, cmp);
 		RBTree<A, int> RBT4(4, &b);
 		RBTree<A, int> RBT5(5);
 	}
@@ -117,5 +119,329 @@ int main() {
 		RBTree<A, int> RBT1(1, 2, cmp);
 		RBTree<A, int> RBT2(2, 3);
 	}
+	{ // template<class T1, class T2, class S>	RcdInline / RcdCold
+	  	cout << "========================================" << endl;
+		RBTree<A, int, RcdCold> RBT1(cmp);
+		for (int i = 1; i < 8; i++)
+			RBT1.Insert(i);
+		RBT1.Delete(4);
+		RBT1.print();
+		RBTree<A, int, RcdCold> RBT2(RBT1);
+		cout << sizeof(Node<int>) << ' ' << sizeof(Node<int, int, RcdCold>) << endl;
+	}
+	{ // template<class T1, class T2, class S, class L>	PlainLinks / PackedLinks
+	  	cout << "========================================" << endl;
+		RBTree<A, NULLT, RcdInline, PackedLinks> RBT1(cmp);
+		for (int i = 7; i > 0; i--)
+			RBT1.Insert(i);
+		RBT1.Delete(3);
+		RBT1.print();
+		cout << RBT1.getHeight() << ' ' << sizeof(Node<int, NULLT, RcdInline, PackedLinks>) << endl;
+	}
+	{ // template<class T1, class T2, class S, class L, class Compare>	DCmp / lambda / std::less-style
+	  	cout << "========================================" << endl;
+		RBTree<int, NULLT, RcdInline, PlainLinks, DCmp<int> > RBT1;
+		for (int i = 1; i < 8; i++)
+			RBT1.Insert(i);
+		RBT1.print();
+		cout << "----------------------------------------" << endl;
+		auto byX = [](const A &a, const A &b) { return a.x > b.x; };	// bool result: a std::less-style order, here descending
+		RBTree<A, NULLT, RcdInline, PlainLinks, decltype(byX)> RBT2(byX);
+		for (int i = 1; i < 8; i++)
+			RBT2.Insert(i);
+		RBT2.Delete(4);
+		RBT2.print();
+	}
+	{ // ConcurrentRBTree<T1, T2, S, L, Compare>	bool contains(const T1 &id) const;	T2 *find(const T1 &id) const;	bool insert_or_assign(const T1 &id, const T2 &rcd);
+	  	cout << "========================================" << endl;
+		ConcurrentRBTree<int> RBT1;
+		thread writer([&RBT1]() {
+			for (int i = 0; i < 1000; i++)
+				RBT1.Insert(i);
+		});
+		int seen = 0;
+		for (int i = 0; i < 1000; i++)
+			seen += RBT1.contains(i);
+		writer.join();
+		cout << RBT1.getSize() << ' ' << RBT1.contains(999) << ' ' << (seen <= 1000) << endl;
+		RBTree<int, int> RBT2;
+		RBT2.Insert(5);
+		const RBTree<int, int> &RBT3 = RBT2;
+		cout << (RBT3.find(5) != NULL) << ' ' << (RBT3.find(6) == NULL) << endl;
+		ConcurrentRBTree<int, int> RBT4;
+		int Rcd = 0;
+		cout << RBT4.insert(1, 10) << ' ' << RBT4.insert(1, 20) << ' ' << RBT4.find(1, Rcd) << ':' << Rcd;
+		cout << ' ' << RBT4.insert_or_assign(1, 30) << ' ' << RBT4.insert_or_assign(2, 40) << ' ' << RBT4.find(1, Rcd) << ':' << Rcd;
+		cout << ' ' << RBT4.Insert(3) << ' ' << RBT4.Insert(3) << ' ' << RBT4.Delete(3) << ' ' << RBT4.Delete(3) << endl;
+	}
+	{ // pair<T2 *, bool> insert(const T1 &id, const T2 &rcd);	pair<T2 *, bool> emplace(K &&id, Args &&...args);
+	  // pair<T2 *, bool> try_emplace(const T1 &id, Args &&...args);	pair<T2 *, bool> insert_or_assign(const T1 &id, R &&rcd);
+	  // RBTree(RBTree<T1, T2, S, L, Compare> &&Old);	bool operator=(RBTree<T1, T2, S, L, Compare> &&b);
+	  	cout << "========================================" << endl;
+		RBTree<A, string> RBT1;
+		cout << RBT1.insert(1, string("one")).second << ' ';
+		cout << RBT1.insert(1, string("uno")).second << ' ';
+		cout << *RBT1.emplace(2, 3, 'x').first << ' ';
+		cout << *RBT1.try_emplace(3, "three").first << ' ';
+		cout << RBT1.try_emplace(3, "tres").second << ' ';
+		pair<string *, bool> Res = RBT1.insert_or_assign(1, string("un"));
+		cout << *Res.first << ' ' << Res.second << endl;
+		RBTree<A, string> RBT2(std::move(RBT1));
+		cout << RBT1.getSize() << ' ' << RBT2.getSize() << ' ' << *RBT2.find(2) << endl;
+		RBT1 = std::move(RBT2);
+		cout << RBT1.getSize() << ' ' << RBT2.getSize() << endl;
+	}
+	{ // iterator begin() const;	iterator end() const;	reverse_iterator rbegin() const;	reverse_iterator rend() const;
+	  // iterator lower_bound(const T1 &id) const;	iterator upper_bound(const T1 &id) const;	pair<iterator, iterator> equal_range(const T1 &id) const;
+	  	cout << "========================================" << endl;
+		RBTree<int, int> RBT1;
+		for (int i = 10; i > 0; i--)
+			RBT1.insert(i * 10, i);
+		RBT1.Delete(50);
+		for (RBTree<int, int>::iterator it = RBT1.begin(); it != RBT1.end(); ++it)
+			cout << it->getID() << ':' << *it->getRcd() << ' ';
+		cout << endl;
+		for (RBTree<int, int>::reverse_iterator it = RBT1.rbegin(); it != RBT1.rend(); ++it)
+			cout << it->getID() << ' ';
+		cout << endl;
+		cout << RBT1.lower_bound(50)->getID() << ' ' << RBT1.upper_bound(60)->getID() << ' ' << (RBT1.upper_bound(100) == RBT1.end()) << ' ';
+		pair<RBTree<int, int>::iterator, RBTree<int, int>::iterator> Range = RBT1.equal_range(30);
+		cout << Range.first->getID() << ' ' << Range.second->getID() << endl;
+	}
+	{ // bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;	int countInRange(const T1 &lo, const T1 &hi) const;
+	  	cout << "========================================" << endl;
+		RBTree<int, int> RBT1;
+		for (int i = 0; i < 20; i++)
+			RBT1.insert(i * 5, i);
+		RBT1.forEachInRange(12, 40, [](const int &id, int &rcd) { cout << id << ':' << rcd << ' '; return true; });
+		cout << endl;
+		int seen = 0;
+		cout << RBT1.forEachInRange(0, 100, [&seen](const int &, int &) { return ++seen < 3; }) << ' ' << seen << ' ';
+		cout << RBT1.countInRange(12, 40) << ' ' << RBT1.countInRange(40, 12) << ' ' << RBT1.countInRange(-10, 1000) << endl;
+	}
+	{ // iterator select(int k) const;	int rank(const T1 &id) const;	int countRange(const T1 &lo, const T1 &hi) const;
+	  	cout << "========================================" << endl;
+		RBTree<int, NULLT, RcdInline, Counted<PlainLinks> > RBT1;
+		for (int i = 0; i < 100; i++)
+			RBT1.Insert(i * 2);
+		RBT1.Delete(10);
+		cout << RBT1.select(0)->getID() << ' ' << RBT1.select(5)->getID() << ' ' << (RBT1.select(99) == RBT1.end()) << ' ';
+		cout << RBT1.rank(11) << ' ' << RBT1.rank(12) << ' ' << RBT1.countRange(0, 20) << ' ' << RBT1.countRange(20, 0) << endl;
+	}
+	{ // template<class It> bool buildFromSorted(It first, It last);
+	  	cout << "========================================" << endl;
+		int ids[] = { 1, 2, 3, 5, 8, 13, 21, 34, 55, 89 };
+		RBTree<int> RBT1;
+		cout << RBT1.buildFromSorted(ids, ids + 10) << ' ' << RBT1.getSize() << endl;
+		RBT1.print();
+		cout << "----------------------------------------" << endl;
+		pair<int, string> rcds[] = { make_pair(1, string("one")), make_pair(2, string("two")), make_pair(4, string("four")) };
+		RBTree<int, string> RBT2;
+		cout << RBT2.buildFromSorted(rcds, rcds + 3) << ' ' << *RBT2.find(4) << ' ';
+		int unsorted[] = { 3, 1, 2 };
+		cout << RBT1.buildFromSorted(unsorted, unsorted + 3) << ' ' << RBT1.getSize() << endl;
+	}
+	{ // template<class It> int insertBatch(It first, It last, int threads = 0);	template<class It> int deleteBatch(It first, It last, int threads = 0);
+	  	cout << "========================================" << endl;
+		RBTree<int> RBT1;
+		for (int i = 0; i < 10; i++)
+			RBT1.Insert(i * 3);
+		int ids[] = { 20, 4, 7, 3, 4, 11, 1 };
+		cout << RBT1.insertBatch(ids, ids + 7) << ' ' << RBT1.getSize() << endl;
+		RBT1.print();
+		cout << "----------------------------------------" << endl;
+		int gone[] = { 27, 0, 5, 4, 21, 4 };
+		cout << RBT1.deleteBatch(gone, gone + 6, 2) << ' ' << RBT1.getSize() << endl;
+		RBT1.print();
+	}
+	{ // bool split(const T1 &key, RBTree &left, RBTree &right);	bool join(RBTree &left, const T1 &pivot, RBTree &right);	bool join(RBTree &left, RBTree &right);
+	  	cout << "========================================" << endl;
+		RBTree<int, string> RBT1, RBT2, RBT3;
+		for (int i = 0; i < 12; i++)
+			RBT1.insert(i * 2, to_string(i));
+		cout << RBT1.split(9, RBT2, RBT3) << ' ' << RBT1.getSize() << ' ' << RBT2.getSize() << ' ' << RBT3.getSize() << endl;
+		RBT2.print();
+		cout << "----------------------------------------" << endl;
+		cout << RBT1.join(RBT3, RBT2) << ' ' << RBT1.join(RBT2, 9, RBT3) << ' ' << RBT1.getSize() << ' ' << *RBT1.find(10) << endl;
+		RBT1.print();
+		RBT1.split(5, RBT1, RBT2);
+		cout << RBT1.join(RBT1, RBT2) << ' ' << RBT1.getSize() << endl;
+	}
+	{ // bool unionWith(RBTree &b, int threads = 0);	bool intersect(RBTree &b, int threads = 0);	bool difference(RBTree &b, int threads = 0);
+	  	cout << "========================================" << endl;
+		RBTree<int> RBT1, RBT2;
+		for (int i = 0; i < 10; i++) {
+			RBT1.Insert(i * 2);
+			RBT2.Insert(i * 3);
+		}
+		RBT1.unionWith(RBT2);
+		cout << RBT1.getSize() << ' ' << RBT2.getSize() << endl;
+		for (int i = 0; i < 30; i += 4)
+			RBT2.Insert(i);
+		RBT1.intersect(RBT2, 2);
+		cout << RBT1.getSize() << endl;
+		RBT1.print();
+		cout << "----------------------------------------" << endl;
+		RBT2.Insert(8);
+		RBT2.Insert(9);
+		RBT1.difference(RBT2);
+		cout << RBT1.getSize() << ' ' << RBT2.getSize() << endl;
+		RBT1.print();
+	}
+	{ // PersistentRBTree<T1, T2, Compare>	PersistentRBTree snapshot() const;
+	  	cout << "========================================" << endl;
+		PersistentRBTree<int, string> RBT1;
+		for (int i = 0; i < 10; i++)
+			RBT1.insert(i, to_string(i * i));
+		PersistentRBTree<int, string> RBT2 = RBT1.snapshot();
+		RBT1.Delete(3);
+		RBT1.insert(10, "100");
+		cout << RBT1.getSize() << ' ' << RBT2.getSize() << ' ' << (RBT1.find(3) == NULL) << ' ' << *RBT2.find(3) << ' ' << (RBT2.find(10) == NULL) << endl;
+		RBT2.forEachInRange(2, 6, [](const int &id, const string &rcd) { cout << id << ':' << rcd << ' '; return true; });
+		cout << endl;
+	}
+	{ // bool copy(const Node<T1, T2> * const b);	int getCount() const;	~Node();	on a chain too deep for a recursive walk
+	  	cout << "========================================" << endl;
+		Node<int> *Nd1 = new Node<int>(0), *Tmp = Nd1;
+		for (int i = 1; i < 1000000; i++) {
+			if (i % 2 == 0) {
+				Tmp->AddLft(i);
+				Tmp = Tmp->getLft();
+			}
+			else {
+				Tmp->AddRgt(i);
+				Tmp = Tmp->getRgt();
+			}
+		}
+		Node<int> Nd2;
+		Nd2.copy(Nd1);
+		cout << Nd1->getCount() << ' ' << Nd2.getCount() << ' ' << Nd2.getRgt()->getLft()->getID() << endl;
+		delete Nd1;
+	}
+	{ // bool save(const string &path) const;	bool load(const string &path);
+	  	cout << "========================================" << endl;
+		RBTree<int, string> RBT1, RBT2;
+		for (int i = 0; i < 10; i++)
+			RBT1.insert(i * 5, string(i, 'a' + i));
+		cout << RBT1.save("test.bin") << ' ' << RBT2.load("test.bin") << ' ' << RBT2.getSize() << ' ' << *RBT2.find(35) << endl;
+		RBT2.print();
+		RBTree<int> RBT3;
+		cout << RBT3.load("test.bin") << ' ' << RBT3.getSize() << ' ';
+		{	// cut the file short: nothing past the cut is believed
+			ifstream In("test.bin", ios::binary);
+			string Bytes((istreambuf_iterator<char>(In)), istreambuf_iterator<char>());
+			In.close();
+			ofstream Out("test.bin", ios::binary | ios::trunc);
+			Out.write(Bytes.data(), Bytes.size() - 20);
+		}
+		cout << RBT2.load("test.bin") << ' ' << RBT2.getSize() << endl;
+		remove("test.bin");
+	}
+	{ // MappedRBTree<T1, T2, Compare>	bool create(const string &path, size_t bytes = 1 << 20);	bool open(const string &path, bool readOnly = true);
+	  	cout << "========================================" << endl;
+		MappedRBTree<int, double> MRBT1, MRBT2;
+		cout << MRBT1.create("test.tree", 64) << ' ';
+		for (int i = 0; i < 10; i++)
+			MRBT1.insert(i * 7 % 10, i / 2.0);
+		MRBT1.close();
+		cout << MRBT2.open("test.tree") << ' ' << MRBT2.getSize() << ' ' << *MRBT2.find(3) << ' ' << MRBT2.Insert(11) << endl;
+		MRBT2.forEachInRange(2, 7, [](const int &id, const double &rcd) { cout << id << ':' << rcd << ' '; return true; });
+		cout << endl;
+		MRBT2.close();
+		remove("test.tree");
+	}
+	{ // RBTree<T1, T2, S, L, Compare, OpStats>	const I &stats() const;	TreeShape shape() const;
+	  	cout << "========================================" << endl;
+		RBTree<int, NULLT, RcdInline, PlainLinks, CmpPtr<int>, OpStats> RBT1;
+		for (int i = 0; i < 100; i++)
+			RBT1.Insert(i);
+		cout << RBT1.stats().rotations[OpStats::I_RR] << ' ' << RBT1.stats().ops[OpStats::INSERT] << ' ' << RBT1.stats().allocs << endl;
+		RBT1.resetStats();
+		RBT1.find(50);
+		cout << RBT1.stats().visited[OpStats::FIND] << ' ' << RBT1.stats().compares << endl;
+		TreeShape Shape = RBT1.shape();
+		cout << Shape.size << ' ' << Shape.height << ' ' << Shape.blackHeight << ' ' << Shape.avgPath << endl;
+		cout << Shape.report();
+		vector<int> Batch;
+		for (int i = 50; i < 2050; i++)
+			Batch.push_back(i);
+		RBT1.resetStats();
+		cout << RBT1.insertBatch(Batch.begin(), Batch.end(), 4) << ' ' << RBT1.deleteBatch(Batch.begin() + 1000, Batch.end(), 4) << ' ' << RBT1.getSize() << ' ' << (RBT1.stats().compares > 0) << endl;
+	}
+	{ // JournaledRBTree<T1, T2, S, L, Compare>	bool open(const string &path, SyncPolicy policy = SYNC_EACH, int group = 64, int checkpointEvery = 1 << 20);	bool checkpoint();
+	  	cout << "========================================" << endl;
+		JournaledRBTree<int, double> JRBT1, JRBT2;
+		double Rcd;
+		cout << JRBT1.open("test", SYNC_GROUP, 4) << ' ';
+		for (int i = 0; i < 10; i++)
+			JRBT1.insert(i * 7 % 10, i / 2.0);
+		cout << JRBT1.checkpoint() << ' ' << JRBT1.Delete(3) << ' ' << JRBT1.insert_or_assign(4, 9.5) << endl;
+		JRBT1.close();
+		cout << JRBT2.open("test") << ' ' << JRBT2.getSize() << ' ' << JRBT2.contains(3) << ' ' << JRBT2.find(4, Rcd) << ':' << Rcd << endl;
+		JRBT2.close();
+		remove("test.log");
+		remove("test.snap");
+	}
+	{ // LockCoupledRBTree<T1, T2, Compare>	bool insert(const T1 &id, const T2 &rcd);	bool Delete(const T1 &id);
+	  	cout << "========================================" << endl;
+		LockCoupledRBTree<int, int> RBT1;
+		vector<thread> writers;
+		for (int t = 0; t < 4; t++)
+			writers.push_back(thread([&RBT1, t]() {
+				for (int i = t; i < 1000; i += 4)
+					RBT1.insert(i, i * i);
+				for (int i = t; i < 1000; i += 8)
+					RBT1.Delete(i);
+			}));
+		for (int t = 0; t < 4; t++)
+			writers[t].join();
+		int Rcd = 0;
+		cout << RBT1.getSize() << ' ' << RBT1.contains(8) << ' ' << RBT1.find(12, Rcd) << ':' << Rcd << ' ' << RBT1.Delete(13) << endl;
+		RBT1.forEachInRange(10, 20, [](const int &id, int &rcd) { cout << id << ':' << rcd << ' '; return true; });
+		cout << endl;
+	}
+	{ // EpochRBTree<T1, T2, Compare>	bool update(Change change);	bool find(const T1 &id, T2 &rcd) const;
+	  	cout << "========================================" << endl;
+		EpochRBTree<int, int> RBT1;
+		RBT1.update([](EpochRBTree<int, int>::Version &V) {
+			for (int i = 0; i < 10; i++)
+				V.insert(i, i * 10);
+			return true;
+		});
+		int Sum = 0;
+		thread reader([&RBT1, &Sum]() {
+			for (int i = 0; i < 1000; i++)
+				RBT1.forEachInRange(0, 10, [&Sum](const int &, const int &rcd) { Sum += rcd; return true; });
+		});
+		for (int i = 10; i < 20; i++)
+			RBT1.insert(i, i * 10);
+		reader.join();
+		int Rcd = 0;
+		cout << RBT1.getSize() << ' ' << Sum << ' ' << RBT1.Delete(3) << ' ' << RBT1.Delete(3) << ' ' << RBT1.find(15, Rcd) << ':' << Rcd << endl;
+	}
+	{ // ShardedRBTree<T1, T2, S, L, Compare, Hash>	bool moveBound(int i, const T1 &bound);	bool forEachInRange(const T1 &lo, const T1 &hi, Visitor visitor) const;
+	  	cout << "========================================" << endl;
+		ShardedRBTree<int, int> RBT1(vector<int>{10, 20});
+		vector<thread> writers;
+		for (int t = 0; t < 3; t++)
+			writers.push_back(thread([&RBT1, t]() {
+				for (int i = t; i < 30; i += 3)
+					RBT1.insert(i, i * i);
+			}));
+		for (int t = 0; t < 3; t++)
+			writers[t].join();
+		cout << RBT1.getSize() << ' ' << RBT1.moveBound(0, 5) << ' ' << RBT1.moveBound(1, 5) << ' ' << RBT1.getShardSize(0) << ' ' << RBT1.getShardSize(1) << ' ' << RBT1.Delete(7) << endl;
+		RBT1.forEachInRange(4, 12, [](const int &id, int &rcd) { cout << id << ':' << rcd << ' '; return true; });
+		cout << endl;
+	}
+	{ // RBTree<T1, T2, S, L, Compare, I>	T2 *find(const K &key) const;	iterator lower_bound(const K &key) const;	bool Delete(const K &key);
+	  	cout << "========================================" << endl;
+		RBTree<string, int, RcdInline, PlainLinks, less<> > RBT1;
+		for (int i = 0; i < 10; i++)
+			RBT1.insert("item" + to_string(i), i);
+		const char Request[] = "GET item7 item3x";
+		string_view Key(Request + 4, 5), Next(Request + 10, 6);
+		cout << *RBT1.find(Key) << ' ' << RBT1.contains(Next) << ' ' << RBT1.lower_bound(Next)->getID() << ' ' << RBT1.Delete(Key) << ' ' << RBT1.contains(Key) << ' ' << RBT1.getSize() << endl;
+	}
 	system("pause");
 }